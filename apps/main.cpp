@@ -1,9 +1,16 @@
 #include "application/Application.hpp"
 
-int main() {
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
   Application app{};
 
+  if (argc > 1) {
+    return app.runArguments(std::vector<std::string>(argv + 1, argv + argc));
+  }
+
   app.run();
 
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,112 @@
+#include "scaling/Scaling.hpp"
+
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> _split(std::string const &text, char separator) {
+  std::vector<std::string> parts;
+  std::stringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, separator)) {
+    parts.push_back(part);
+  }
+  return parts;
+}
+
+// "10000:20000000:8", count face counts spaced evenly on a log scale
+bool _parseSizes(std::string const &text, std::vector<size_t> &faceCounts) {
+  std::vector<std::string> const fields = _split(text, ':');
+  if (fields.size() != 3) {
+    return false;
+  }
+  double min = 0.0, max = 0.0;
+  size_t count = 0;
+  std::stringstream(fields[0]) >> min;
+  std::stringstream(fields[1]) >> max;
+  std::stringstream(fields[2]) >> count;
+  faceCounts = Scaling::logSpaced(static_cast<size_t>(min), static_cast<size_t>(max), count);
+  return !faceCounts.empty();
+}
+
+void _printUsage() {
+  std::cerr << "Usage: scaling [--families sphere,terrain,defects] [--operations sim,rem,rep,chk]"
+            << std::endl;
+  std::cerr << "               [--sizes min:max:count] [--threads 1,2,4,8] [--repetitions n] "
+               "[--seed n]"
+            << std::endl;
+  std::cerr << "               [--csv path] [--json path], - as a path writes no file"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> const arguments(argv + 1, argv + argc);
+  if (arguments.size() % 2 != 0) {
+    _printUsage();
+    return 1;
+  }
+
+  Scaling::Options options;
+  for (size_t i = 0; i < arguments.size(); i += 2) {
+    std::string const &option = arguments[i];
+    std::string const &value  = arguments[i + 1];
+    bool valid                = true;
+    if (option == "--families") {
+      options.families.clear();
+      for (auto const &name : _split(value, ',')) {
+        auto family = Synthetic::familyFromName(name);
+        valid       = valid && family != std::nullopt;
+        if (family != std::nullopt) {
+          options.families.push_back(family.value());
+        }
+      }
+    } else if (option == "--operations") {
+      options.operations.clear();
+      for (auto const &name : _split(value, ',')) {
+        auto operation = Scaling::operationFromName(name);
+        valid          = valid && operation != std::nullopt;
+        if (operation != std::nullopt) {
+          options.operations.push_back(operation.value());
+        }
+      }
+    } else if (option == "--sizes") {
+      valid = _parseSizes(value, options.faceCounts);
+    } else if (option == "--threads") {
+      options.threadCounts.clear();
+      for (auto const &text : _split(value, ',')) {
+        size_t threadCount = 0;
+        std::stringstream(text) >> threadCount;
+        valid = valid && threadCount != 0;
+        options.threadCounts.push_back(threadCount);
+      }
+    } else if (option == "--repetitions") {
+      std::stringstream stream(value);
+      stream >> options.repetitionCount;
+      valid = !stream.fail();
+    } else if (option == "--seed") {
+      std::stringstream stream(value);
+      stream >> options.seed;
+      valid = !stream.fail();
+    } else if (option == "--csv") {
+      options.csvFilePath = value == "-" ? "" : value;
+    } else if (option == "--json") {
+      options.jsonFilePath = value == "-" ? "" : value;
+    } else {
+      std::cerr << "Unknown option (" << option << ")" << std::endl;
+      _printUsage();
+      return 1;
+    }
+    if (!valid) {
+      std::cerr << "Invalid value for option (" << option << ")" << std::endl;
+      return 1;
+    }
+  }
+
+  return Scaling::run(options) ? 0 : 1;
+}
@@ -1,23 +1,79 @@
 #include "Application.hpp"
 
+#include "batch/Batch.hpp"
 #include "benchmark/Benchmark.hpp"
+#include "benchmark/Harness.hpp"
+#include "common/Instrument.hpp"
+#include "deform/Deform.hpp"
+#include "deform/Proxy.hpp"
+#include "io/Compressed.hpp"
+#include "io/Io.hpp"
+#include "io/ResultCache.hpp"
+#include "metrics/Metrics.hpp"
 #include "mesh-simplification/MeshSimplification.hpp"
+#include "mesh-simplification/OutOfCore.hpp"
+#include "pipeline/Pipeline.hpp"
 #include "remesh/Remesh.hpp"
+#include "reorder/Reorder.hpp"
 #include "repair/Repair.hpp"
+#include "server/Server.hpp"
 
 #include <chrono>
 #include <iostream>
+#include <optional>
 #include <sstream>
+#include <vector>
 
 Application::Application()  = default;
 Application::~Application() = default;
 
 static std::string const kRemeshCmd    = "rem";
+static std::string const kLocalCmd     = "lrm";
 static std::string const kSimplifyCmd  = "sim";
+static std::string const kParallelCmd  = "psi";
+static std::string const kStreamingCmd = "ooc";
+static std::string const kPolicyCmd    = "gpm";
+static std::string const kLodCmd       = "lod";
+static std::string const kReplayCmd    = "rpl";
 static std::string const kRepairCmd    = "rep";
+static std::string const kDeformCmd    = "arp";
 static std::string const kBenchmarkCmd = "ben";
+static std::string const kMetricsCmd   = "met";
+static std::string const kIoBenchCmd   = "iob";
+static std::string const kHarnessCmd   = "bch";
+static std::string const kTraceCmd     = "trc";
+static std::string const kPipelineCmd  = "pip";
+static std::string const kServerCmd    = "srv";
 static std::string const kCustomCmd    = "cus";
 
+namespace {
+
+// one case per file, each runs the same stages, curve reorders every input after loading
+std::optional<std::vector<Benchmark::HarnessCase>>
+_harnessCases(std::string const &filenames, std::string const &stageSpec,
+              std::optional<Reorder::Curve> curve) {
+  auto stages = Pipeline::parseStages(stageSpec);
+  if (stages == std::nullopt) {
+    return std::nullopt;
+  }
+
+  std::vector<Benchmark::HarnessCase> cases;
+  std::stringstream filenameStream(filenames);
+  std::string filename;
+  while (std::getline(filenameStream, filename, ',')) {
+    Benchmark::HarnessCase benchCase{
+        filename + ":" + stageSpec, filename,
+        [stages = stages.value()](Mesh &mesh) { Pipeline::run(mesh, stages, ""); }, nullptr};
+    if (curve != std::nullopt) {
+      benchCase.prepare = [curve = curve.value()](Mesh &mesh) { Reorder::reorder(mesh, curve); };
+    }
+    cases.push_back(std::move(benchCase));
+  }
+  return cases;
+}
+
+} // namespace
+
 void Application::run() {
   for (;;) {
     static std::string usingCommand = kRemeshCmd;
@@ -36,15 +92,185 @@ void Application::run() {
   }
 }
 
+int Application::runArguments(std::vector<std::string> const &rawArguments) {
+  // --trace <path> may come anywhere and records the whole command, so may --format and --bits
+  // which pick how every mesh the command writes is stored
+  std::vector<std::string> arguments;
+  std::string traceFilePath;
+  for (size_t i = 0; i < rawArguments.size(); i++) {
+    if (rawArguments[i] == "--trace" && i + 1 < rawArguments.size()) {
+      traceFilePath = rawArguments[++i];
+    } else if (rawArguments[i] == "--format" && i + 1 < rawArguments.size()) {
+      std::string const &format = rawArguments[++i];
+      if (format != "obj" && format != "ply" && "." + format != Io::kCompressedExtension) {
+        std::cerr << "Unknown output format (" << format << ")" << std::endl;
+        return 1;
+      }
+      Io::setOutputMeshExtension("." + format);
+    } else if (rawArguments[i] == "--bits" && i + 1 < rawArguments.size()) {
+      std::stringstream value(rawArguments[++i]);
+      unsigned int positionBits = 0;
+      value >> positionBits;
+      if (value.fail() || positionBits < 1 || positionBits > 31) {
+        std::cerr << "Invalid value for option (--bits)" << std::endl;
+        return 1;
+      }
+      Io::setCompressedPositionBits(positionBits);
+    } else {
+      arguments.push_back(rawArguments[i]);
+    }
+  }
+
+  if (traceFilePath.empty()) {
+    return _runArguments(arguments);
+  }
+
+  Instrument::setEnabled(true);
+  int const exitCode = _runArguments(arguments);
+  Instrument::setEnabled(false);
+  Instrument::printSummary();
+  return Instrument::writeChromeTrace(traceFilePath) ? exitCode : 1;
+}
+
+int Application::_runArguments(std::vector<std::string> const &arguments) {
+  // run pip <filename> <stages> [--debug] [--no-cache]
+  if (arguments.size() >= 3 && arguments.size() <= 5 && arguments[0] == kPipelineCmd) {
+    bool writeIntermediates = false;
+    for (size_t i = 3; i < arguments.size(); i++) {
+      if (arguments[i] == "--debug") {
+        writeIntermediates = true;
+      } else if (arguments[i] == "--no-cache") {
+        Io::setResultCacheEnabled(false);
+      } else {
+        std::cerr << "Unknown option (" << arguments[i] << ")" << std::endl;
+        return 1;
+      }
+    }
+
+    auto stages = Pipeline::parseStages(arguments[2]);
+    if (stages == std::nullopt) {
+      return 1;
+    }
+    return Pipeline::run(arguments[1], stages.value(), writeIntermediates) ? 0 : 1;
+  }
+
+  // run bch <stages> <filename>[,<filename>...] [--warmup n] [--repetitions n] [--json path]
+  //         [--baseline path] [--threshold fraction] [--reorder curve]
+  if (arguments.size() >= 3 && arguments.size() % 2 == 1 && arguments[0] == kHarnessCmd) {
+    Benchmark::HarnessOptions options;
+    std::optional<Reorder::Curve> curve;
+    for (size_t i = 3; i < arguments.size(); i += 2) {
+      std::string const &option = arguments[i];
+      std::stringstream value(arguments[i + 1]);
+      if (option == "--warmup") {
+        value >> options.warmupCount;
+      } else if (option == "--repetitions") {
+        value >> options.repetitionCount;
+      } else if (option == "--json") {
+        options.jsonFilePath = arguments[i + 1];
+      } else if (option == "--baseline") {
+        options.baselineFilePath = arguments[i + 1];
+      } else if (option == "--threshold") {
+        value >> options.regressionThreshold;
+      } else if (option == "--reorder") {
+        curve = Reorder::curveFromName(arguments[i + 1]);
+        if (curve == std::nullopt) {
+          value.setstate(std::ios::failbit);
+        } else {
+          options.prepareName = "reorder:" + arguments[i + 1];
+        }
+      } else {
+        std::cerr << "Unknown option (" << option << ")" << std::endl;
+        return 1;
+      }
+      if (value.fail()) {
+        std::cerr << "Invalid value for option (" << option << ")" << std::endl;
+        return 1;
+      }
+    }
+
+    auto cases = _harnessCases(arguments[2], arguments[1], curve);
+    if (cases == std::nullopt) {
+      return 1;
+    }
+    return Benchmark::runHarness(cases.value(), options) ? 0 : 1;
+  }
+
+  // run srv <socket> [--threads n] [--cache-mib n]
+  if (arguments.size() >= 2 && arguments.size() % 2 == 0 && arguments[0] == kServerCmd) {
+    Server::Options options;
+    options.socketPath = arguments[1];
+    for (size_t i = 2; i < arguments.size(); i += 2) {
+      std::string const &option = arguments[i];
+      std::stringstream value(arguments[i + 1]);
+      if (option == "--threads") {
+        value >> options.threadCount;
+      } else if (option == "--cache-mib") {
+        size_t cacheMib = 0;
+        value >> cacheMib;
+        options.cacheBytes = cacheMib << 20;
+      } else {
+        std::cerr << "Unknown option (" << option << ")" << std::endl;
+        return 1;
+      }
+      if (value.fail()) {
+        std::cerr << "Invalid value for option (" << option << ")" << std::endl;
+        return 1;
+      }
+    }
+    return Server::serve(options) ? 0 : 1;
+  }
+
+  std::cerr << "Usage: run [" << kPipelineCmd << " <filename> <stages> [--debug] [--no-cache]]"
+            << std::endl;
+  std::cerr << "       run [" << kHarnessCmd
+            << " <stages> <filename>[,<filename>...] [--warmup n] [--repetitions n] [--json path] "
+               "[--baseline path] [--threshold fraction] [--reorder curve]]"
+            << std::endl;
+  std::cerr << "       run [" << kServerCmd << " <socket> [--threads n] [--cache-mib n]]"
+            << std::endl;
+  std::cerr << "       --trace <path> writes a Chrome trace of any of them" << std::endl;
+  std::cerr << "       --format <obj|ply|qmsh> writes their meshes in that format, --bits <n> "
+               "quantizes qmsh positions to n bits, 16 by default"
+            << std::endl;
+  return 1;
+}
+
 Application::ReturnCode Application::_commandKernal(std::string const &command) {
   if (command == kRemeshCmd) {
     return _remeshKernal();
+  } else if (command == kLocalCmd) {
+    return _localRemeshKernal();
   } else if (command == kSimplifyCmd) {
     return _simplifyKernal();
+  } else if (command == kParallelCmd) {
+    return _parallelSimplifyKernal();
+  } else if (command == kStreamingCmd) {
+    return _streamingSimplifyKernal();
+  } else if (command == kPolicyCmd) {
+    return _policyMatrixKernal();
+  } else if (command == kLodCmd) {
+    return _lodKernal();
+  } else if (command == kReplayCmd) {
+    return _replayKernal();
   } else if (command == kRepairCmd) {
     return _repairKernal();
+  } else if (command == kDeformCmd) {
+    return _deformKernal();
   } else if (command == kBenchmarkCmd) {
     return _benchmarkKernal();
+  } else if (command == kMetricsCmd) {
+    return _metricsKernal();
+  } else if (command == kPipelineCmd) {
+    return _pipelineKernal();
+  } else if (command == kServerCmd) {
+    return _serverKernal();
+  } else if (command == kHarnessCmd) {
+    return _harnessKernal();
+  } else if (command == kTraceCmd) {
+    return _traceKernal();
+  } else if (command == kIoBenchCmd) {
+    return _ioBenchmarkKernal();
   } else if (command == kCustomCmd) {
     return _customKernal();
   } else {
@@ -81,9 +307,71 @@ Application::ReturnCode Application::_remeshKernal() {
     std::stringstream(inputLine) >> usingNbIter; // Convert to unsigned int
   }
 
+  // 1 is the serial remesh, 0 all hardware threads
+  static size_t usingThreadCount = 1;
+  std::cout << "Enter the thread count /[" << usingThreadCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingThreadCount; // Convert to size_t
+  }
+
+  // record time
+  auto start = std::chrono::high_resolution_clock::now();
+  Remesh::isoRemesh(usingFileName, usingTargetEdgeLength, usingNbIter, usingThreadCount);
+  auto end                              = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end - start;
+  std::cout << "Time taken: " << elapsed.count() << "s" << std::endl;
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_localRemeshKernal() {
+  static std::string usingFileName = "test.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filename
+  std::cout << "Enter the filename /[" << usingFileName << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileName = inputLine;
+  }
+
+  if (usingFileName == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static double usingTargetEdgeLength = 0.04;
+  std::cout << "Enter the target edge length /[" << usingTargetEdgeLength << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingTargetEdgeLength; // Convert to double
+  }
+
+  static unsigned int usingNbIter = 10;
+  std::cout << "Enter the number of iterations /[" << usingNbIter << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingNbIter; // Convert to unsigned int
+  }
+
+  static float usingThresholdAngle = 130;
+  std::cout << "Enter the cap threshold angle /[" << usingThresholdAngle << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingThresholdAngle; // Convert to float
+  }
+
+  static unsigned int usingRingCount = 2;
+  std::cout << "Enter the number of rings around defects /[" << usingRingCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingRingCount; // Convert to unsigned int
+  }
+
   // record time
   auto start = std::chrono::high_resolution_clock::now();
-  Remesh::isoRemesh(usingFileName, usingTargetEdgeLength, usingNbIter);
+  Remesh::isoRemeshDefects(usingFileName, usingTargetEdgeLength, usingNbIter, usingThresholdAngle,
+                           usingRingCount);
   auto end                              = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> elapsed = end - start;
   std::cout << "Time taken: " << elapsed.count() << "s" << std::endl;
@@ -120,6 +408,21 @@ Application::ReturnCode Application::_simplifyKernal() {
     std::stringstream(inputLine) >> usingOutputFaceCount; // Convert to size_t
   }
 
+  // 0 stops at the face count, anything above stops at the first collapse past the tolerance
+  static double usingMaxError = 0.0;
+  std::cout << "Enter the error tolerance /[" << usingMaxError << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingMaxError; // Convert to double
+  }
+
+  static std::string usingCompact = "n";
+  std::cout << "Use float storage (y/n) /[" << usingCompact << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingCompact = inputLine;
+  }
+
   // select policy here
   MeshSimplification::GarlandHeckbertPolicy policy =
       MeshSimplification::GarlandHeckbertPolicy::kClassicPlane;
@@ -142,7 +445,212 @@ Application::ReturnCode Application::_simplifyKernal() {
 
   // record time
   auto start = std::chrono::high_resolution_clock::now();
-  MeshSimplification::edgeCollapse(usingFileName, usingOutputFaceCount, policy);
+  MeshSimplification::edgeCollapse(usingFileName, usingOutputFaceCount, policy,
+                                   usingCompact == "y", usingMaxError);
+  auto end                              = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end - start;
+  std::cout << "Time taken: " << elapsed.count() << "s" << std::endl;
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_parallelSimplifyKernal() {
+  static std::string usingFileName = "1.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filename
+  std::cout << "Enter the filename /[" << usingFileName << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileName = inputLine;
+  }
+
+  if (usingFileName == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static std::string usingPolicy = "none";
+  std::cout << "Enter the policy /[" << usingPolicy << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingPolicy = inputLine;
+  }
+
+  static size_t usingOutputFaceCount = 6050;
+  std::cout << "Enter the output face count /[" << usingOutputFaceCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingOutputFaceCount; // Convert to size_t
+  }
+
+  static std::string usingThreadCounts = "1,2,4,8";
+  std::cout << "Enter the thread counts /[" << usingThreadCounts << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingThreadCounts = inputLine;
+  }
+
+  auto policy = MeshSimplification::policyFromName(usingPolicy);
+  if (policy == std::nullopt) {
+    std::cerr << "Unknown policy (" << usingPolicy << ")" << std::endl;
+    return ReturnCode::kFailure;
+  }
+
+  std::vector<size_t> threadCounts;
+  std::stringstream threadCountStream(usingThreadCounts);
+  std::string threadCountToken;
+  while (std::getline(threadCountStream, threadCountToken, ',')) {
+    size_t threadCount = 0;
+    std::stringstream(threadCountToken) >> threadCount; // Convert to size_t
+    threadCounts.push_back(threadCount);
+  }
+
+  MeshSimplification::reportParallelScaling(usingFileName, usingOutputFaceCount, policy.value(),
+                                            threadCounts);
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_streamingSimplifyKernal() {
+  static std::string usingFileName = "1.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filename
+  std::cout << "Enter the filename /[" << usingFileName << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileName = inputLine;
+  }
+
+  if (usingFileName == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static std::string usingPolicy = "cp";
+  std::cout << "Enter the policy /[" << usingPolicy << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingPolicy = inputLine;
+  }
+
+  static size_t usingOutputFaceCount = 6050;
+  std::cout << "Enter the output face count /[" << usingOutputFaceCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingOutputFaceCount; // Convert to size_t
+  }
+
+  static size_t usingMemoryBudgetMiB = 1024;
+  std::cout << "Enter the memory budget in MiB /[" << usingMemoryBudgetMiB << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingMemoryBudgetMiB; // Convert to size_t
+  }
+
+  auto policy = MeshSimplification::policyFromName(usingPolicy);
+  if (policy == std::nullopt) {
+    std::cerr << "Unknown policy (" << usingPolicy << ")" << std::endl;
+    return ReturnCode::kFailure;
+  }
+
+  // record time
+  auto start = std::chrono::high_resolution_clock::now();
+  MeshSimplification::streamingCollapse(usingFileName, usingOutputFaceCount, policy.value(),
+                                        usingMemoryBudgetMiB);
+  auto end                              = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end - start;
+  std::cout << "Time taken: " << elapsed.count() << "s" << std::endl;
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_lodKernal() {
+  static std::string usingFileName = "1.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filename
+  std::cout << "Enter the filename /[" << usingFileName << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileName = inputLine;
+  }
+
+  if (usingFileName == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static std::string usingPolicy = "cp";
+  std::cout << "Enter the policy /[" << usingPolicy << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingPolicy = inputLine;
+  }
+
+  static std::string usingFaceCounts = "24200,12100,6050,3025";
+  std::cout << "Enter the LOD face counts /[" << usingFaceCounts << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFaceCounts = inputLine;
+  }
+
+  static std::string usingWriteStream = "y";
+  std::cout << "Write the collapse stream (y/n) /[" << usingWriteStream << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingWriteStream = inputLine;
+  }
+
+  auto policy = MeshSimplification::policyFromName(usingPolicy);
+  if (policy == std::nullopt) {
+    std::cerr << "Unknown policy (" << usingPolicy << ")" << std::endl;
+    return ReturnCode::kFailure;
+  }
+
+  std::vector<size_t> faceCounts;
+  std::stringstream faceCountStream(usingFaceCounts);
+  std::string faceCountToken;
+  while (std::getline(faceCountStream, faceCountToken, ',')) {
+    size_t faceCount = 0;
+    std::stringstream(faceCountToken) >> faceCount; // Convert to size_t
+    faceCounts.push_back(faceCount);
+  }
+
+  // record time
+  auto start = std::chrono::high_resolution_clock::now();
+  MeshSimplification::generateLods(usingFileName, faceCounts, policy.value(),
+                                   usingWriteStream == "y");
+  auto end                              = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end - start;
+  std::cout << "Time taken: " << elapsed.count() << "s" << std::endl;
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_replayKernal() {
+  static std::string usingFileName = "1.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filename
+  std::cout << "Enter the filename /[" << usingFileName << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileName = inputLine;
+  }
+
+  if (usingFileName == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static size_t usingOutputFaceCount = 6050;
+  std::cout << "Enter the output face count /[" << usingOutputFaceCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingOutputFaceCount; // Convert to size_t
+  }
+
+  // record time
+  auto start = std::chrono::high_resolution_clock::now();
+  MeshSimplification::reconstructLod(usingFileName, usingOutputFaceCount);
   auto end                              = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> elapsed = end - start;
   std::cout << "Time taken: " << elapsed.count() << "s" << std::endl;
@@ -150,6 +658,33 @@ Application::ReturnCode Application::_simplifyKernal() {
   return ReturnCode::kContinue;
 }
 
+Application::ReturnCode Application::_policyMatrixKernal() {
+  static std::string usingFileName = "1.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filename
+  std::cout << "Enter the filename /[" << usingFileName << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileName = inputLine;
+  }
+
+  if (usingFileName == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static size_t usingOutputFaceCount = 6050;
+  std::cout << "Enter the output face count /[" << usingOutputFaceCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingOutputFaceCount; // Convert to size_t
+  }
+
+  MeshSimplification::reportPolicyMatrix(usingFileName, usingOutputFaceCount);
+
+  return ReturnCode::kContinue;
+}
+
 Application::ReturnCode Application::_repairKernal() {
   static std::string usingFileName = "test.obj";
   std::string inputLine; // Use to read the whole line
@@ -177,6 +712,114 @@ Application::ReturnCode Application::_repairKernal() {
   return ReturnCode::kContinue;
 }
 
+Application::ReturnCode Application::_deformKernal() {
+  static std::string usingFileName = "1.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filename
+  std::cout << "Enter the filename /[" << usingFileName << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileName = inputLine;
+  }
+
+  if (usingFileName == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static std::string usingAnchors = "0";
+  std::cout << "Enter the anchor vertices /[" << usingAnchors << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingAnchors = inputLine;
+  }
+
+  static std::string usingHandles = "1";
+  std::cout << "Enter the handle vertices /[" << usingHandles << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingHandles = inputLine;
+  }
+
+  static std::string usingOffset = "0 0.1 0";
+  std::cout << "Enter the handle offset /[" << usingOffset << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingOffset = inputLine;
+  }
+
+  static size_t usingStepCount = 30;
+  std::cout << "Enter the drag step count /[" << usingStepCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingStepCount; // Convert to size_t
+  }
+
+  // 0 solves on the full mesh
+  static size_t usingProxyFaceCount = 0;
+  std::cout << "Enter the proxy face count /[" << usingProxyFaceCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingProxyFaceCount; // Convert to size_t
+  }
+
+  // 0 keeps to the local/global iterations
+  static int usingRefineIterations = 0;
+  std::cout << "Enter the Ceres refine iterations /[" << usingRefineIterations << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingRefineIterations; // Convert to int
+  }
+
+  // 0 means one per hardware thread
+  static size_t usingThreadCount = 0;
+  if (usingRefineIterations > 0) {
+    std::cout << "Enter the Ceres thread count /[" << usingThreadCount << "]: ";
+    std::getline(std::cin, inputLine); // Read the whole line
+    if (!inputLine.empty()) {
+      std::stringstream(inputLine) >> usingThreadCount; // Convert to size_t
+    }
+  }
+
+  auto parseIndices = [](std::string const &list) {
+    std::vector<size_t> indices;
+    std::stringstream listStream(list);
+    std::string token;
+    while (std::getline(listStream, token, ',')) {
+      size_t index = 0;
+      std::stringstream(token) >> index; // Convert to size_t
+      indices.push_back(index);
+    }
+    return indices;
+  };
+
+  double dx = 0.0, dy = 0.0, dz = 0.0;
+  if (!(std::stringstream(usingOffset) >> dx >> dy >> dz)) {
+    std::cerr << "Invalid offset (" << usingOffset << ")" << std::endl;
+    return ReturnCode::kFailure;
+  }
+
+  Deform::Options options;
+  options.refineIterations = usingRefineIterations;
+  options.threadCount      = usingThreadCount;
+
+  // record time
+  auto start = std::chrono::high_resolution_clock::now();
+  if (usingProxyFaceCount == 0) {
+    Deform::deform(usingFileName, parseIndices(usingAnchors), parseIndices(usingHandles),
+                   Kernel::Vector_3(dx, dy, dz), usingStepCount, options);
+  } else {
+    Deform::deformProxy(usingFileName, usingProxyFaceCount, parseIndices(usingAnchors),
+                        parseIndices(usingHandles), Kernel::Vector_3(dx, dy, dz), usingStepCount,
+                        options);
+  }
+  auto end                              = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end - start;
+  std::cout << "Time taken: " << elapsed.count() << "s" << std::endl;
+
+  return ReturnCode::kContinue;
+}
+
 Application::ReturnCode Application::_benchmarkKernal() {
   static std::string usingFileName = "1.obj";
   std::string inputLine; // Use to read the whole line
@@ -204,19 +847,268 @@ Application::ReturnCode Application::_benchmarkKernal() {
   return ReturnCode::kContinue;
 }
 
-Application::ReturnCode Application::_customKernal() {
+Application::ReturnCode Application::_metricsKernal() {
+  static std::string usingFileName = "1.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filename
+  std::cout << "Enter the filename /[" << usingFileName << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileName = inputLine;
+  }
+
+  if (usingFileName == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static Metrics::Options usingOptions;
+  std::cout << "Enter the cap angle /[" << usingOptions.capAngle << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingOptions.capAngle; // Convert to double
+  }
+
+  std::cout << "Enter the needle ratio /[" << usingOptions.needleRatio << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingOptions.needleRatio; // Convert to double
+  }
+
+  static std::string usingCompact = "n";
+  std::cout << "Use float storage (y/n) /[" << usingCompact << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingCompact = inputLine;
+  }
+
+  Metrics::printReport(usingFileName, usingOptions, usingCompact == "y");
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_pipelineKernal() {
+  static std::string usingFileName = "1.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filename
+  std::cout << "Enter the filename /[" << usingFileName << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileName = inputLine;
+  }
+
+  if (usingFileName == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static std::string usingStages = "rep,sim:6050,rem:0.04x10";
+  std::cout << "Enter the stages /[" << usingStages << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingStages = inputLine;
+  }
+
+  static std::string usingWriteIntermediates = "n";
+  std::cout << "Write intermediate meshes (y/n) /[" << usingWriteIntermediates << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingWriteIntermediates = inputLine;
+  }
+
+  auto stages = Pipeline::parseStages(usingStages);
+  if (stages == std::nullopt) {
+    return ReturnCode::kFailure;
+  }
+
+  // record time
+  auto start = std::chrono::high_resolution_clock::now();
+  Pipeline::run(usingFileName, stages.value(), usingWriteIntermediates == "y");
+  auto end                              = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end - start;
+  std::cout << "Time taken: " << elapsed.count() << "s" << std::endl;
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_serverKernal() {
+  static Server::Options usingOptions;
+  std::string inputLine; // Use to read the whole line
+
+  std::cout << "Enter the socket path /[" << usingOptions.socketPath << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingOptions.socketPath = inputLine;
+  }
+
+  if (usingOptions.socketPath == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  std::cout << "Enter the worker count, 0 for all cores /[" << usingOptions.threadCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingOptions.threadCount; // Convert to size_t
+  }
+
+  size_t cacheMib = usingOptions.cacheBytes >> 20;
+  std::cout << "Enter the mesh cache size in MiB /[" << cacheMib << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> cacheMib; // Convert to size_t
+    usingOptions.cacheBytes = cacheMib << 20;
+  }
+
+  // blocks until a client sends the shutdown command
+  if (!Server::serve(usingOptions)) {
+    return ReturnCode::kFailure;
+  }
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_harnessKernal() {
+  static std::string usingFileNames = "1.obj";
+  std::string inputLine; // Use to read the whole line
+
+  // filenames
+  std::cout << "Enter the comma separated filenames /[" << usingFileNames << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingFileNames = inputLine;
+  }
+
+  if (usingFileNames == "exit") {
+    return ReturnCode::kExit;
+  }
+
+  static std::string usingStages = "sim:6050";
+  std::cout << "Enter the stages /[" << usingStages << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingStages = inputLine;
+  }
+
+  static Benchmark::HarnessOptions usingOptions;
+  std::cout << "Enter the warm-up count /[" << usingOptions.warmupCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingOptions.warmupCount; // Convert to size_t
+  }
+
+  std::cout << "Enter the repetition count /[" << usingOptions.repetitionCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingOptions.repetitionCount; // Convert to size_t
+  }
+
+  // "-" turns the file off again
+  std::cout << "Enter the JSON output path, - for none /[" << usingOptions.jsonFilePath << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingOptions.jsonFilePath = inputLine == "-" ? "" : inputLine;
+  }
+
+  std::cout << "Enter the baseline path, - for none /[" << usingOptions.baselineFilePath << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingOptions.baselineFilePath = inputLine == "-" ? "" : inputLine;
+  }
+
+  static std::string usingReorder = "-";
+  std::cout << "Enter the reorder curve (morton/hilbert), - for none /[" << usingReorder << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingReorder = inputLine;
+  }
+  std::optional<Reorder::Curve> curve;
+  if (usingReorder != "-") {
+    curve = Reorder::curveFromName(usingReorder);
+    if (curve == std::nullopt) {
+      std::cerr << "Unknown curve (" << usingReorder << ")" << std::endl;
+      return ReturnCode::kFailure;
+    }
+  }
+  usingOptions.prepareName = curve != std::nullopt ? "reorder:" + usingReorder : "";
+
+  auto cases = _harnessCases(usingFileNames, usingStages, curve);
+  if (cases == std::nullopt) {
+    return ReturnCode::kFailure;
+  }
+  if (!Benchmark::runHarness(cases.value(), usingOptions)) {
+    return ReturnCode::kFailure;
+  }
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_traceKernal() {
+  if (!Instrument::isEnabled()) {
+    Instrument::setEnabled(true);
+    std::cout << "Instrumentation on, run the commands to trace and enter " << kTraceCmd
+              << " again to write the trace" << std::endl;
+    return ReturnCode::kContinue;
+  }
+
+  Instrument::setEnabled(false);
+  Instrument::printSummary();
+
+  static std::string usingTraceFilePath = "trace.json";
+  std::string inputLine; // Use to read the whole line
+  std::cout << "Enter the trace output path /[" << usingTraceFilePath << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    usingTraceFilePath = inputLine;
+  }
+
+  if (!Instrument::writeChromeTrace(usingTraceFilePath)) {
+    return ReturnCode::kFailure;
+  }
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_ioBenchmarkKernal() {
+  std::vector<std::string> filenames;
   for (int i = 1; i <= 10; i++) {
-    std::string usingFileName = std::to_string(i) + ".obj";
-    std::cout << "Using " << usingFileName << std::endl;
+    filenames.push_back(std::to_string(i) + ".obj");
+  }
+
+  Benchmark::compareIo(filenames);
+
+  return ReturnCode::kContinue;
+}
+
+Application::ReturnCode Application::_customKernal() {
+  std::string inputLine; // Use to read the whole line
 
-    // record time
-    auto start = std::chrono::high_resolution_clock::now();
-    MeshSimplification::edgeCollapse(usingFileName, 10000,
-                                     MeshSimplification::GarlandHeckbertPolicy::kNone);
-    auto end                              = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = end - start;
-    std::cout << "Time taken: " << elapsed.count() << "s" << std::endl;
+  static size_t usingThreadCount = 0;
+  std::cout << "Enter the thread count, 0 for all cores /[" << usingThreadCount << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingThreadCount; // Convert to size_t
   }
 
+  static size_t usingMaxMeshesInFlight = 0;
+  std::cout << "Enter the max meshes in flight, 0 for twice the threads /["
+            << usingMaxMeshesInFlight << "]: ";
+  std::getline(std::cin, inputLine); // Read the whole line
+  if (!inputLine.empty()) {
+    std::stringstream(inputLine) >> usingMaxMeshesInFlight; // Convert to size_t
+  }
+
+  std::vector<std::string> filenames;
+  for (int i = 1; i <= 10; i++) {
+    filenames.push_back(std::to_string(i) + ".obj");
+  }
+
+  Batch::Options options{};
+  options.threadCount       = usingThreadCount;
+  options.maxMeshesInFlight = usingMaxMeshesInFlight;
+
+  auto report = Batch::simplifyAll(filenames, 10000,
+                                   MeshSimplification::GarlandHeckbertPolicy::kNone, options);
+  Batch::printReport(report);
+
   return ReturnCode::kContinue;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 class Application {
 public:
@@ -9,6 +10,9 @@ public:
 
   void run();
 
+  // non-interactive entry, returns the process exit code, --trace <path> writes a Chrome trace
+  int runArguments(std::vector<std::string> const &rawArguments);
+
 private:
   enum class ReturnCode {
     kContinue,
@@ -16,11 +20,26 @@ private:
     kFailure,
   };
 
+  int _runArguments(std::vector<std::string> const &arguments);
+
   // return 1 if the user wants to exit
   ReturnCode _commandKernal(std::string const &command);
   ReturnCode _remeshKernal();
+  ReturnCode _localRemeshKernal();
   ReturnCode _simplifyKernal();
+  ReturnCode _parallelSimplifyKernal();
+  ReturnCode _streamingSimplifyKernal();
+  ReturnCode _policyMatrixKernal();
+  ReturnCode _lodKernal();
+  ReturnCode _replayKernal();
   ReturnCode _repairKernal();
+  ReturnCode _deformKernal();
   ReturnCode _benchmarkKernal();
+  ReturnCode _metricsKernal();
+  ReturnCode _pipelineKernal();
+  ReturnCode _harnessKernal();
+  ReturnCode _serverKernal();
+  ReturnCode _traceKernal();
+  ReturnCode _ioBenchmarkKernal();
   ReturnCode _customKernal();
 };
@@ -0,0 +1,233 @@
+#include "Batch.hpp"
+
+#include "common/ThreadPool.hpp"
+#include "common/Timing.hpp"
+#include "io/Io.hpp"
+#include "io/ResultCache.hpp"
+#include "io/SurfaceMeshIo.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// counts the meshes that are resident, the loader blocks here once the limit is reached
+class SlotGate {
+public:
+  explicit SlotGate(size_t slotCount) : mFreeSlots(slotCount) {}
+
+  void acquire() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this]() { return mFreeSlots > 0; });
+    --mFreeSlots;
+  }
+
+  void release() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      ++mFreeSlots;
+    }
+    mCondition.notify_one();
+  }
+
+private:
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  size_t mFreeSlots;
+};
+
+struct WriteItem {
+  size_t jobIndex = 0;
+  std::shared_ptr<Mesh> mesh;
+  std::optional<std::string> resultKey;
+};
+
+// drains simplified meshes to disk on its own thread so workers never wait on I/O
+class Writer {
+public:
+  Writer(std::vector<Batch::JobReport> &jobs, SlotGate &gate, std::mutex &logMutex)
+      : mJobs(jobs), mGate(gate), mLogMutex(logMutex), mThread([this]() { _loop(); }) {}
+
+  ~Writer() { finish(); }
+
+  Writer(Writer const &)            = delete;
+  Writer &operator=(Writer const &) = delete;
+
+  void push(WriteItem item) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mQueue.emplace_back(std::move(item));
+    }
+    mCondition.notify_one();
+  }
+
+  void finish() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mClosed = true;
+    }
+    mCondition.notify_one();
+    if (mThread.joinable()) {
+      mThread.join();
+    }
+  }
+
+private:
+  void _loop() {
+    for (;;) {
+      WriteItem item;
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this]() { return mClosed || !mQueue.empty(); });
+        if (mQueue.empty()) {
+          return;
+        }
+        item = std::move(mQueue.front());
+        mQueue.pop_front();
+      }
+
+      Batch::JobReport &job = mJobs[item.jobIndex];
+
+      auto const writeStart            = Timing::Clock::now();
+      std::string const outputFilePath = Io::makeMeshOutputPath(job.filename);
+      job.success                      = Io::writeSurfaceMesh(outputFilePath, *item.mesh);
+      if (job.success) {
+        Io::storeResult(item.resultKey, outputFilePath);
+      }
+      job.writeSeconds = Timing::secondsSince(writeStart);
+
+      // free the mesh before handing the slot back
+      item.mesh.reset();
+      mGate.release();
+
+      std::lock_guard<std::mutex> lock(mLogMutex);
+      std::cout << job.filename << ": " << job.inputFaceCount << " -> " << job.outputFaceCount
+                << " faces, load " << job.loadSeconds << "s, process " << job.processSeconds
+                << "s (" << static_cast<double>(job.inputFaceCount) / job.processSeconds
+                << " faces/s), write " << job.writeSeconds << "s" << std::endl;
+    }
+  }
+
+  std::vector<Batch::JobReport> &mJobs;
+  SlotGate &mGate;
+  std::mutex &mLogMutex;
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::deque<WriteItem> mQueue;
+  bool mClosed = false;
+
+  std::thread mThread;
+};
+
+} // namespace
+
+namespace Batch {
+
+BatchReport simplifyAll(std::vector<std::string> const &filenames, size_t outputFaceCount,
+                        MeshSimplification::GarlandHeckbertPolicy policy, Options const &options) {
+  BatchReport report;
+  report.jobs.resize(filenames.size());
+
+  ThreadPool pool(options.threadCount);
+  size_t const slotCount = options.maxMeshesInFlight != 0 ? options.maxMeshesInFlight
+                                                          : 2 * pool.getThreadCount();
+  SlotGate gate(slotCount);
+  std::mutex logMutex;
+  Writer writer(report.jobs, gate, logMutex);
+
+  std::cout << "Batch of " << filenames.size() << " files on " << pool.getThreadCount()
+            << " threads, " << slotCount << " meshes in flight" << std::endl;
+
+  // the key of a plain sim of the same count and policy, the two share results
+  std::stringstream operation;
+  operation << std::setprecision(17) << "sim:" << outputFaceCount << ":"
+            << static_cast<int>(policy) << ":" << false << ":" << 0.0;
+
+  auto const start = Timing::Clock::now();
+
+  // the calling thread is the loader, it prefetches ahead of the workers until the gate closes
+  for (size_t i = 0; i < filenames.size(); i++) {
+    JobReport &job                  = report.jobs[i];
+    job.filename                    = filenames[i];
+    std::string const inputFilePath = Io::makeFullInputPath(job.filename);
+
+    std::optional<std::string> resultKey;
+    {
+      std::lock_guard<std::mutex> lock(logMutex);
+      job.cached = Io::fetchResult(inputFilePath, operation.str(),
+                                   Io::makeMeshOutputPath(job.filename), resultKey);
+    }
+    if (job.cached) {
+      job.success = true;
+      continue;
+    }
+
+    gate.acquire();
+
+    auto const loadStart = Timing::Clock::now();
+    auto maybeMesh       = Io::loadTriangleMesh<Mesh>(inputFilePath);
+    job.loadSeconds      = Timing::secondsSince(loadStart);
+    if (maybeMesh == std::nullopt) {
+      gate.release();
+      continue;
+    }
+
+    // std::function wants a copyable callable, so the mesh travels in a shared_ptr
+    auto mesh          = std::make_shared<Mesh>(std::move(maybeMesh.value()));
+    job.inputFaceCount = num_faces(*mesh);
+
+    pool.submit([&job, &writer, i, mesh, resultKey, outputFaceCount, policy]() {
+      auto const processStart = Timing::Clock::now();
+      MeshSimplification::simplify(*mesh, outputFaceCount, policy);
+      job.processSeconds  = Timing::secondsSince(processStart);
+      job.outputFaceCount = num_faces(*mesh);
+
+      writer.push({i, mesh, resultKey});
+    });
+  }
+
+  pool.waitIdle();
+  writer.finish();
+
+  report.wallSeconds = Timing::secondsSince(start);
+  return report;
+}
+
+void printReport(BatchReport const &report) {
+  size_t meshCount      = 0;
+  size_t cachedCount    = 0;
+  size_t faceCount      = 0;
+  double loadSeconds    = 0.0;
+  double processSeconds = 0.0;
+  double writeSeconds   = 0.0;
+  for (auto const &job : report.jobs) {
+    if (!job.success) {
+      std::cout << job.filename << ": failed" << std::endl;
+      continue;
+    }
+    ++meshCount;
+    cachedCount += job.cached ? 1 : 0;
+    faceCount += job.inputFaceCount;
+    loadSeconds += job.loadSeconds;
+    processSeconds += job.processSeconds;
+    writeSeconds += job.writeSeconds;
+  }
+
+  std::cout << meshCount << "/" << report.jobs.size() << " meshes in " << report.wallSeconds
+            << "s, " << cachedCount << " from the result cache" << std::endl;
+  std::cout << "Throughput: " << static_cast<double>(meshCount) / report.wallSeconds
+            << " meshes/s, " << static_cast<double>(faceCount) / report.wallSeconds
+            << " faces/s" << std::endl;
+  std::cout << "Summed stage time: load " << loadSeconds << "s, process " << processSeconds
+            << "s, write " << writeSeconds << "s" << std::endl;
+}
+
+} // namespace Batch
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "mesh-simplification/MeshSimplification.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Batch {
+
+struct Options {
+  // 0 means one worker per hardware thread
+  size_t threadCount = 0;
+  // meshes loaded but not yet written, bounds the resident memory, 0 means twice the thread count
+  size_t maxMeshesInFlight = 0;
+};
+
+struct JobReport {
+  std::string filename;
+  bool success           = false;
+  bool cached            = false;
+  size_t inputFaceCount  = 0;
+  size_t outputFaceCount = 0;
+  double loadSeconds     = 0.0;
+  double processSeconds  = 0.0;
+  double writeSeconds    = 0.0;
+};
+
+struct BatchReport {
+  std::vector<JobReport> jobs;
+  double wallSeconds = 0.0;
+};
+
+// simplifies every file with a three stage pipeline: a loader prefetching inputs, a work-stealing
+// pool running the collapses and a background writer, all bounded by maxMeshesInFlight, a file
+// whose result is in the result cache is linked from there and never loaded
+BatchReport simplifyAll(std::vector<std::string> const &filenames, size_t outputFaceCount,
+                        MeshSimplification::GarlandHeckbertPolicy policy, Options const &options);
+
+void printReport(BatchReport const &report);
+
+} // namespace Batch
@@ -1,84 +1,195 @@
 #include "Benchmark.hpp"
 
-#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Polygon_mesh_processing/IO/polygon_mesh_io.h>
 #include <CGAL/Polygon_mesh_processing/self_intersections.h>
 #include <CGAL/Polygon_mesh_processing/shape_predicates.h>
-#include <CGAL/Surface_mesh.h>
 
+#include "common/Timing.hpp"
 #include "common/defines.hpp"
 #include "io/Io.hpp"
+#include "io/SurfaceMeshIo.hpp"
+#include "metrics/Metrics.hpp"
 
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <limits>
 #include <optional>
 #include <string>
 #include <vector>
 
-typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel;
-typedef CGAL::Surface_mesh<Kernel::Point_3> Mesh;
-
 typedef boost::graph_traits<Mesh>::face_descriptor face_descriptor;
 
 namespace PMP = CGAL::Polygon_mesh_processing;
 
 namespace {
-std::optional<Mesh> _readMesh(std::string const &filePath) {
-  std::cout << "Loading mesh from path (" << filePath << ")..." << std::endl;
+float getCosVal(float const angle) { return std::cos(angle * CGAL_PI / 180.0); }
 
-  Mesh mesh;
-  if (!PMP::IO::read_polygon_mesh(filePath, mesh)) {
-    std::cerr << "Cannot read polygon mesh" << std::endl;
-    return std::nullopt;
-  }
-  if (!CGAL::is_triangle_mesh(mesh)) {
-    std::cerr << "Input geometry is not triangulated." << std::endl;
-    return std::nullopt;
+// best of a few runs, the first one pays for the cold page cache
+template <typename Function> double _bestSeconds(int repetitions, Function &&function) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < repetitions; i++) {
+    auto const start = Timing::Clock::now();
+    function();
+    best = std::min(best, Timing::secondsSince(start));
   }
-
-  std::cout << "Faces: " << num_faces(mesh) << std::endl;
-  return std::optional<Mesh>(mesh);
+  return best;
 }
 
-float getCosVal(float const angle) { return std::cos(angle * CGAL_PI / 180.0); }
-
 } // namespace
 
 namespace Benchmark {
 
+Defects findDefects(Mesh const &mesh, float thresholdAngle) {
+  Defects defects;
+
+  // bool intersecting = PMP::does_self_intersect<CGAL::Parallel_if_available_tag>(
+  //     mesh, CGAL::parameters::vertex_point_map(get(CGAL::vertex_point, mesh)));
+
+  // intersection
+  PMP::self_intersections<CGAL::Parallel_if_available_tag>(
+      faces(mesh), mesh, std::back_inserter(defects.intersectingPairs));
+
+  // cap triangles
+  Metrics::Options options;
+  options.capAngle = thresholdAngle;
+  defects.capFaces = std::move(Metrics::computeMetrics(mesh, options).capFaces);
+
+  return defects;
+}
+
+void benchmark(Mesh const &mesh, float thresholdAngle) {
+  Defects const defects = findDefects(mesh, thresholdAngle);
+
+  std::cout << defects.intersectingPairs.size() << " pairs of triangles intersect." << std::endl;
+  std::cout << defects.capFaces.size() << " cap triangles found." << std::endl;
+}
+
 void benchmark(std::string const &filename, float thresholdAngle) {
-  std::string const inputFilePath  = Io::makeFullInputPath(filename);
-  std::string const outputFilePath = Io::makeFullOutputPath(filename);
+  std::string const inputFilePath = Io::makeFullInputPath(filename);
 
-  auto maybeMesh = _readMesh(inputFilePath);
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
   if (maybeMesh == std::nullopt) {
     return;
   }
-  Mesh &mesh = maybeMesh.value();
 
-  // bool intersecting = PMP::does_self_intersect<CGAL::Parallel_if_available_tag>(
-  //     mesh, CGAL::parameters::vertex_point_map(get(CGAL::vertex_point, mesh)));
+  benchmark(maybeMesh.value(), thresholdAngle);
+}
+
+void detectCaps(std::string const &filename, float thresholdAngle) {
+  int constexpr kRepetitions = 3;
 
-  // count intersection
-  std::vector<std::pair<face_descriptor, face_descriptor>> intersected_tris;
-  PMP::self_intersections<CGAL::Parallel_if_available_tag>(faces(mesh), mesh,
-                                                           std::back_inserter(intersected_tris));
-  std::cout << intersected_tris.size() << " pairs of triangles intersect." << std::endl;
+  std::string const inputFilePath = Io::makeFullInputPath(filename);
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return;
+  }
+  Mesh const &mesh = maybeMesh.value();
 
-  // count cap triangles
+  // the per face predicate walks the halfedges of every face on one thread
   float const threshold = getCosVal(thresholdAngle);
+  size_t serialCount    = 0;
+  double const serial   = _bestSeconds(kRepetitions, [&]() {
+    serialCount = 0;
+    for (const auto &face : faces(mesh)) {
+      if (PMP::is_cap_triangle_face(face, mesh, threshold) !=
+          boost::graph_traits<Mesh>::null_halfedge()) {
+        ++serialCount;
+      }
+    }
+  });
+
+  Metrics::Options options;
+  options.capAngle     = thresholdAngle;
+  size_t metricsCount  = 0;
+  double const metrics = _bestSeconds(kRepetitions, [&]() {
+    metricsCount = Metrics::computeMetrics(mesh, options).capFaces.size();
+  });
+
+  std::cout << serialCount << " cap triangles found by the predicate in " << serial * 1000.0
+            << "ms" << std::endl;
+  std::cout << metricsCount << " cap triangles found by the metrics engine in " << metrics * 1000.0
+            << "ms (" << serial / metrics << "x)" << std::endl;
+}
 
-  int capCount = 0;
-  for (const auto &face : faces(mesh)) {
-    auto halfEdge = PMP::is_cap_triangle_face(face, mesh, threshold);
-    if (halfEdge == boost::graph_traits<Mesh>::null_halfedge()) {
+void compareIo(std::vector<std::string> const &filenames) {
+  int constexpr kRepetitions = 3;
+
+  double cgalReadTotal  = 0.0;
+  double cgalWriteTotal = 0.0;
+  double fastReadTotal  = 0.0;
+  double fastWriteTotal = 0.0;
+  double cacheReadTotal = 0.0;
+
+  // the Io reads time the parsers, with the sidecar on every repetition after the first would
+  // only map the cache, which is timed on its own below
+  bool const meshCache = Io::isMeshCacheEnabled();
+  Io::setMeshCacheEnabled(false);
+
+  for (auto const &filename : filenames) {
+    std::string const inputFilePath  = Io::makeFullInputPath(filename);
+    std::string const outputFilePath = Io::makeFullOutputPath("io-benchmark-" + filename);
+
+    Mesh cgalMesh;
+    Mesh fastMesh;
+    bool readOk = true;
+
+    double const cgalRead = _bestSeconds(kRepetitions, [&]() {
+      cgalMesh.clear();
+      readOk = readOk && PMP::IO::read_polygon_mesh(inputFilePath, cgalMesh);
+    });
+    double const fastRead = _bestSeconds(kRepetitions, [&]() {
+      readOk = readOk && Io::readSurfaceMesh(inputFilePath, fastMesh);
+    });
+    if (!readOk) {
+      std::cerr << "Cannot read polygon mesh (" << inputFilePath << ")" << std::endl;
       continue;
     }
-    ++capCount;
+
+    double const cgalWrite = _bestSeconds(kRepetitions, [&]() {
+      CGAL::IO::write_polygon_mesh(outputFilePath, cgalMesh,
+                                   CGAL::parameters::stream_precision(17));
+    });
+    double const fastWrite =
+        _bestSeconds(kRepetitions, [&]() { Io::writeSurfaceMesh(outputFilePath, fastMesh); });
+    std::filesystem::remove(outputFilePath);
+
+    std::cout << filename << " (" << num_faces(fastMesh) << " faces"
+              << (num_faces(fastMesh) == num_faces(cgalMesh) ? "" : ", face count mismatch")
+              << "): read " << cgalRead << "s -> " << fastRead << "s, write " << cgalWrite
+              << "s -> " << fastWrite << "s" << std::endl;
+
+    // a warm sidecar, the untimed read writes it if it is missing or stale
+    if (meshCache && Io::hasExtension(inputFilePath, ".obj")) {
+      Io::setMeshCacheEnabled(true);
+      Mesh cachedMesh;
+      bool cacheOk           = Io::readSurfaceMesh(inputFilePath, cachedMesh);
+      double const cacheRead = _bestSeconds(kRepetitions, [&]() {
+        cacheOk = cacheOk && Io::readSurfaceMesh(inputFilePath, cachedMesh);
+      });
+      Io::setMeshCacheEnabled(false);
+      if (cacheOk) {
+        std::cout << filename << ": sidecar read " << cacheRead << "s" << std::endl;
+        cacheReadTotal += cacheRead;
+      }
+    }
+
+    cgalReadTotal += cgalRead;
+    cgalWriteTotal += cgalWrite;
+    fastReadTotal += fastRead;
+    fastWriteTotal += fastWrite;
   }
 
-  std::cout << capCount << " cap triangles found." << std::endl;
-}
+  std::cout << "Total read: CGAL " << cgalReadTotal << "s, Io " << fastReadTotal << "s ("
+            << cgalReadTotal / fastReadTotal << "x)" << std::endl;
+  std::cout << "Total write: CGAL " << cgalWriteTotal << "s, Io " << fastWriteTotal << "s ("
+            << cgalWriteTotal / fastWriteTotal << "x)" << std::endl;
+  if (cacheReadTotal > 0.0) {
+    std::cout << "Total sidecar read: " << cacheReadTotal << "s" << std::endl;
+  }
 
-void detectCaps(std::string const &filename, float thresholdAngle) {}
+  Io::setMeshCacheEnabled(meshCache);
+}
 
 } // namespace Benchmark
\ No newline at end of file
@@ -1,9 +1,30 @@
 #pragma once
 
+#include "common/Mesh.hpp"
+
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace Benchmark {
 
+// the faces benchmark counts, also used to pick the regions a local remesh has to touch
+struct Defects {
+  std::vector<std::pair<Mesh::Face_index, Mesh::Face_index>> intersectingPairs;
+  std::vector<Mesh::Face_index> capFaces;
+};
+
+Defects findDefects(Mesh const &mesh, float thresholdAngle);
+
+// counts self-intersecting face pairs and cap triangles
+void benchmark(Mesh const &mesh, float thresholdAngle);
 void benchmark(std::string const &filename, float thresholdAngle);
 
+// times the per face cap predicate against the metrics engine on the same mesh
+void detectCaps(std::string const &filename, float thresholdAngle);
+
+// times the CGAL stream readers and writers against the Io fast path on the same files, the Io
+// reads run with the mesh cache off and a warm sidecar read is reported on its own row
+void compareIo(std::vector<std::string> const &filenames);
+
 } // namespace Benchmark
\ No newline at end of file
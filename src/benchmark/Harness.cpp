@@ -0,0 +1,325 @@
+#include "Harness.hpp"
+
+#include <CGAL/version.h>
+
+#include "common/Counters.hpp"
+#include "common/Json.hpp"
+#include "common/Memory.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/Timing.hpp"
+#include "io/Io.hpp"
+#include "io/MeshCache.hpp"
+#include "io/SurfaceMeshIo.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+
+namespace {
+
+char const *const kPhaseNames[] = {"load", "process", "write", "total"};
+size_t constexpr kPhaseCount    = 4;
+size_t constexpr kProcessPhase  = 1;
+
+// phases faster than this in the baseline are too noisy to gate on
+double constexpr kMinimumGatedSeconds = 1e-3;
+
+struct PhaseStats {
+  double median = 0.0;
+  double p95    = 0.0;
+  double min    = 0.0;
+  double max    = 0.0;
+};
+
+struct CaseResult {
+  std::string name;
+  std::string filename;
+  size_t inputFaceCount    = 0;
+  size_t outputFaceCount   = 0;
+  size_t peakResidentBytes = 0;
+  PhaseStats phases[kPhaseCount];
+
+  // process phase, summed over the repetitions
+  bool countersAvailable = false;
+  Counters::Counts processCounts;
+};
+
+// nearest rank, so the p95 of five samples is the slowest one
+double _percentile(std::vector<double> const &sorted, double percent) {
+  size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * sorted.size()));
+  rank        = std::clamp<size_t>(rank, 1, sorted.size());
+  return sorted[rank - 1];
+}
+
+PhaseStats _phaseStats(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  PhaseStats stats;
+  size_t const middle = samples.size() / 2;
+  stats.median = samples.size() % 2 == 1 ? samples[middle]
+                                         : (samples[middle - 1] + samples[middle]) / 2.0;
+  stats.p95    = _percentile(samples, 95.0);
+  stats.min    = samples.front();
+  stats.max    = samples.back();
+  return stats;
+}
+
+// load, process and write once, seconds receives the phase timings and counters counts the
+// process phase when it is given
+bool _runOnce(Benchmark::HarnessCase const &benchCase, std::string const &outputFilePath,
+              double (&seconds)[kPhaseCount], size_t &inputFaceCount, size_t &outputFaceCount,
+              Counters::ProcessCounters *counters = nullptr,
+              Counters::Counts *counts = nullptr) {
+  auto const start = Timing::Clock::now();
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(Io::makeFullInputPath(benchCase.filename));
+  if (maybeMesh == std::nullopt) {
+    return false;
+  }
+  Mesh &mesh = maybeMesh.value();
+  if (benchCase.prepare) {
+    benchCase.prepare(mesh);
+  }
+  inputFaceCount = num_faces(mesh);
+  seconds[0]     = Timing::secondsSince(start);
+
+  // opened outside the timed phase, one counter per event and thread costs a few system calls
+  bool const counting     = counters != nullptr && counters->start();
+  auto const processStart = Timing::Clock::now();
+  if (benchCase.process) {
+    benchCase.process(mesh);
+  }
+  seconds[1] = Timing::secondsSince(processStart);
+  if (counting) {
+    Counters::Counts const phaseCounts = counters->stop();
+    counts->cycles += phaseCounts.cycles;
+    counts->instructions += phaseCounts.instructions;
+    counts->cacheReferences += phaseCounts.cacheReferences;
+    counts->cacheMisses += phaseCounts.cacheMisses;
+  }
+  outputFaceCount = num_faces(mesh);
+
+  auto const writeStart = Timing::Clock::now();
+  bool const written    = Io::writeSurfaceMesh(outputFilePath, mesh);
+  seconds[2]            = Timing::secondsSince(writeStart);
+  seconds[3]            = Timing::secondsSince(start);
+  return written;
+}
+
+std::optional<CaseResult> _runCase(Benchmark::HarnessCase const &benchCase,
+                                   Benchmark::HarnessOptions const &options) {
+  std::string const outputFilePath = Io::makeFullOutputPath("benchmark-" + benchCase.filename);
+
+  CaseResult result;
+  result.name     = benchCase.name;
+  result.filename = benchCase.filename;
+
+  std::vector<double> samples[kPhaseCount];
+  double seconds[kPhaseCount] = {};
+
+  // warm-up fills the page cache and the mesh cache sidecar, and is not measured
+  for (size_t i = 0; i < options.warmupCount; i++) {
+    if (!_runOnce(benchCase, outputFilePath, seconds, result.inputFaceCount,
+                  result.outputFaceCount)) {
+      return std::nullopt;
+    }
+  }
+
+  // the workers of the shared pool have to exist before the counters are opened to be counted
+  ThreadPool::global();
+  Counters::ProcessCounters counters;
+  result.countersAvailable = counters.start();
+  counters.stop();
+
+  Memory::resetPeakResident();
+  for (size_t i = 0; i < options.repetitionCount; i++) {
+    if (!_runOnce(benchCase, outputFilePath, seconds, result.inputFaceCount,
+                  result.outputFaceCount, result.countersAvailable ? &counters : nullptr,
+                  &result.processCounts)) {
+      return std::nullopt;
+    }
+    for (size_t phase = 0; phase < kPhaseCount; phase++) {
+      samples[phase].push_back(seconds[phase]);
+    }
+  }
+  result.peakResidentBytes = Memory::peakResidentBytes();
+
+  std::error_code error;
+  std::filesystem::remove(outputFilePath, error);
+
+  for (size_t phase = 0; phase < kPhaseCount; phase++) {
+    result.phases[phase] = _phaseStats(samples[phase]);
+  }
+  return result;
+}
+
+Json::Value _toJson(std::vector<CaseResult> const &results,
+                    Benchmark::HarnessOptions const &options) {
+  Json::Value document = Json::Value::object();
+  document.set("version", 1);
+  document.set("cgalVersion", CGAL_VERSION_STR);
+  document.set("meshCache", Io::isMeshCacheEnabled());
+  document.set("prepare", options.prepareName);
+  document.set("warmupCount", options.warmupCount);
+  document.set("repetitionCount", options.repetitionCount);
+
+  Json::Value &cases = document.set("cases", Json::Value::array());
+  for (CaseResult const &result : results) {
+    Json::Value &entry = cases.push(Json::Value::object());
+    entry.set("name", result.name);
+    entry.set("file", result.filename);
+    entry.set("inputFaces", result.inputFaceCount);
+    entry.set("outputFaces", result.outputFaceCount);
+    entry.set("peakResidentBytes", result.peakResidentBytes);
+    for (size_t phase = 0; phase < kPhaseCount; phase++) {
+      Json::Value &stats = entry.set(kPhaseNames[phase], Json::Value::object());
+      stats.set("median", result.phases[phase].median);
+      stats.set("p95", result.phases[phase].p95);
+      stats.set("min", result.phases[phase].min);
+      stats.set("max", result.phases[phase].max);
+      if (phase == kProcessPhase && result.countersAvailable) {
+        // per repetition
+        double const repetitions = static_cast<double>(options.repetitionCount);
+        Json::Value &counters    = stats.set("counters", Json::Value::object());
+        counters.set("cycles", result.processCounts.cycles / repetitions);
+        counters.set("instructions", result.processCounts.instructions / repetitions);
+        counters.set("cacheReferences", result.processCounts.cacheReferences / repetitions);
+        counters.set("cacheMisses", result.processCounts.cacheMisses / repetitions);
+      }
+    }
+  }
+  return document;
+}
+
+std::optional<Json::Value> _readJson(std::string const &filePath) {
+  std::ifstream file(filePath, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot open file (" << filePath << ")" << std::endl;
+    return std::nullopt;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+
+  auto document = Json::parse(text.str());
+  if (document == std::nullopt) {
+    std::cerr << "Cannot parse JSON (" << filePath << ")" << std::endl;
+  }
+  return document;
+}
+
+// cases and phases missing from the baseline are new and pass
+bool _checkBaseline(std::vector<CaseResult> const &results, Json::Value const &baseline,
+                    double threshold) {
+  Json::Value const *baselineCases = baseline.find("cases");
+  if (baselineCases == nullptr || !baselineCases->isArray()) {
+    std::cerr << "Baseline has no cases" << std::endl;
+    return false;
+  }
+
+  if (Json::Value const *version = baseline.find("cgalVersion")) {
+    std::cout << "Baseline CGAL " << version->asString() << ", current CGAL " << CGAL_VERSION_STR
+              << std::endl;
+  }
+
+  bool passed = true;
+  for (CaseResult const &result : results) {
+    auto const it =
+        std::find_if(baselineCases->asArray().begin(), baselineCases->asArray().end(),
+                     [&result](Json::Value const &entry) {
+                       Json::Value const *name = entry.find("name");
+                       return name != nullptr && name->asString() == result.name;
+                     });
+    if (it == baselineCases->asArray().end()) {
+      std::cout << result.name << ": not in baseline" << std::endl;
+      continue;
+    }
+
+    for (size_t phase = 0; phase < kPhaseCount; phase++) {
+      Json::Value const *stats  = it->find(kPhaseNames[phase]);
+      Json::Value const *median = stats != nullptr ? stats->find("median") : nullptr;
+      if (median == nullptr || !median->isNumber() ||
+          median->asNumber() < kMinimumGatedSeconds) {
+        continue;
+      }
+
+      double const ratio = result.phases[phase].median / median->asNumber();
+      if (ratio > 1.0 + threshold) {
+        std::cerr << result.name << ": " << kPhaseNames[phase] << " regressed "
+                  << median->asNumber() << "s -> " << result.phases[phase].median << "s ("
+                  << (ratio - 1.0) * 100.0 << "% slower)" << std::endl;
+        passed = false;
+      }
+    }
+  }
+  return passed;
+}
+
+} // namespace
+
+namespace Benchmark {
+
+bool runHarness(std::vector<HarnessCase> const &cases, HarnessOptions const &options) {
+  if (options.repetitionCount == 0) {
+    std::cerr << "Benchmark needs at least one repetition" << std::endl;
+    return false;
+  }
+
+  std::vector<CaseResult> results;
+  for (HarnessCase const &benchCase : cases) {
+    auto result = _runCase(benchCase, options);
+    if (result == std::nullopt) {
+      std::cerr << "Benchmark case failed (" << benchCase.name << ")" << std::endl;
+      return false;
+    }
+    results.push_back(std::move(result.value()));
+  }
+
+  for (CaseResult const &result : results) {
+    std::cout << result.name << " (" << result.inputFaceCount << " -> " << result.outputFaceCount
+              << " faces, peak " << result.peakResidentBytes / (1024 * 1024) << " MiB)"
+              << std::endl;
+    for (size_t phase = 0; phase < kPhaseCount; phase++) {
+      std::cout << "  " << kPhaseNames[phase] << ": median " << result.phases[phase].median
+                << "s, p95 " << result.phases[phase].p95 << "s" << std::endl;
+    }
+    if (result.countersAvailable) {
+      Counters::Counts const &counts = result.processCounts;
+      double const repetitions       = static_cast<double>(options.repetitionCount);
+      double const references        = std::max<double>(counts.cacheReferences, 1.0);
+      double const cycles            = std::max<double>(counts.cycles, 1.0);
+      std::cout << "  process counters: " << counts.cacheMisses / repetitions
+                << " cache misses per run (" << 100.0 * counts.cacheMisses / references
+                << "% of references), " << counts.instructions / cycles << " instructions per cycle"
+                << std::endl;
+    } else {
+      std::cout << "  process counters: unavailable" << std::endl;
+    }
+  }
+
+  if (!options.jsonFilePath.empty()) {
+    std::ofstream file(options.jsonFilePath, std::ios::binary);
+    file << Json::dump(_toJson(results, options)) << '\n';
+    if (!file) {
+      std::cerr << "Cannot write file (" << options.jsonFilePath << ")" << std::endl;
+      return false;
+    }
+    std::cout << "Benchmark results written to path (" << options.jsonFilePath << ")"
+              << std::endl;
+  }
+
+  if (!options.baselineFilePath.empty()) {
+    auto baseline = _readJson(options.baselineFilePath);
+    if (baseline == std::nullopt ||
+        !_checkBaseline(results, baseline.value(), options.regressionThreshold)) {
+      return false;
+    }
+    std::cout << "No regression against baseline (" << options.baselineFilePath << ")"
+              << std::endl;
+  }
+  return true;
+}
+
+} // namespace Benchmark
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "common/Mesh.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Benchmark {
+
+struct HarnessOptions {
+  size_t warmupCount     = 1;
+  size_t repetitionCount = 5;
+
+  // written when non-empty
+  std::string jsonFilePath;
+
+  // compared against when non-empty, a phase whose median got slower than the baseline median by
+  // more than regressionThreshold (0.1 is 10%) fails the run
+  std::string baselineFilePath;
+  double regressionThreshold = 0.1;
+
+  // the post-load pass of every case in the results, empty when there is none
+  std::string prepareName;
+};
+
+// one timed workload, the input is loaded, handed to process and written out on every repetition,
+// prepare runs right after loading and is timed with the load phase
+struct HarnessCase {
+  std::string name;
+  std::string filename;
+  std::function<void(Mesh &)> process;
+  std::function<void(Mesh &)> prepare;
+};
+
+// prints median and p95 of the load, process and write phases, the cache misses of the process
+// phase where the hardware counters can be read and the peak resident memory of every case,
+// returns false if a case fails or the baseline gate finds a regression
+bool runHarness(std::vector<HarnessCase> const &cases, HarnessOptions const &options);
+
+} // namespace Benchmark
@@ -0,0 +1,131 @@
+#include "Counters.hpp"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#endif
+
+namespace {
+
+#ifdef __linux__
+
+// in the order of the fields of Counters::Counts, one file descriptor each per thread
+uint64_t const kEvents[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                            PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+size_t constexpr kEventCount = sizeof(kEvents) / sizeof(kEvents[0]);
+
+int _openCounter(pid_t thread, uint64_t event) {
+  perf_event_attr attributes{};
+  attributes.size           = sizeof(attributes);
+  attributes.type           = PERF_TYPE_HARDWARE;
+  attributes.config         = event;
+  attributes.disabled       = 1;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv     = 1;
+  attributes.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attributes, thread, -1, -1, 0));
+}
+
+std::vector<pid_t> _threads() {
+  std::vector<pid_t> threads;
+  DIR *directory = opendir("/proc/self/task");
+  if (directory == nullptr) {
+    return threads;
+  }
+  while (dirent *entry = readdir(directory)) {
+    if (entry->d_name[0] != '.') {
+      threads.push_back(static_cast<pid_t>(std::atoi(entry->d_name)));
+    }
+  }
+  closedir(directory);
+  return threads;
+}
+
+// the count over the time the counter was enabled, the kernel only ran it for part of that when
+// more events were asked for than the core has registers
+uint64_t _read(int fileDescriptor) {
+  uint64_t values[3] = {};
+  if (read(fileDescriptor, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(static_cast<double>(values[0]) * values[1] / values[2]);
+}
+
+#endif
+
+} // namespace
+
+namespace Counters {
+
+ProcessCounters::~ProcessCounters() { _close(); }
+
+#ifdef __linux__
+
+bool ProcessCounters::start() {
+  _close();
+  for (pid_t thread : _threads()) {
+    int fileDescriptors[kEventCount];
+    size_t opened = 0;
+    for (; opened < kEventCount; opened++) {
+      fileDescriptors[opened] = _openCounter(thread, kEvents[opened]);
+      if (fileDescriptors[opened] < 0) {
+        break;
+      }
+    }
+    // a thread counts with all of its events or not at all, it may also have exited meanwhile
+    if (opened < kEventCount) {
+      for (size_t i = 0; i < opened; i++) {
+        close(fileDescriptors[i]);
+      }
+      continue;
+    }
+    mFileDescriptors.insert(mFileDescriptors.end(), fileDescriptors,
+                            fileDescriptors + kEventCount);
+  }
+
+  for (int fileDescriptor : mFileDescriptors) {
+    ioctl(fileDescriptor, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fileDescriptor, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  return !mFileDescriptors.empty();
+}
+
+Counts ProcessCounters::stop() {
+  for (int fileDescriptor : mFileDescriptors) {
+    ioctl(fileDescriptor, PERF_EVENT_IOC_DISABLE, 0);
+  }
+
+  Counts counts;
+  uint64_t *const fields[kEventCount] = {&counts.cycles, &counts.instructions,
+                                         &counts.cacheReferences, &counts.cacheMisses};
+  for (size_t i = 0; i < mFileDescriptors.size(); i++) {
+    *fields[i % kEventCount] += _read(mFileDescriptors[i]);
+  }
+  _close();
+  return counts;
+}
+
+void ProcessCounters::_close() {
+  for (int fileDescriptor : mFileDescriptors) {
+    close(fileDescriptor);
+  }
+  mFileDescriptors.clear();
+}
+
+#else
+
+bool ProcessCounters::start() { return false; }
+
+Counts ProcessCounters::stop() { return {}; }
+
+void ProcessCounters::_close() {}
+
+#endif
+
+} // namespace Counters
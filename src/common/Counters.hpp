@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Counters {
+
+// summed over the counted threads, scaled up when the kernel had to multiplex the counters
+struct Counts {
+  uint64_t cycles          = 0;
+  uint64_t instructions    = 0;
+  uint64_t cacheReferences = 0;
+  uint64_t cacheMisses     = 0;
+};
+
+// cycles, instructions and last level cache traffic of every thread of the process that is alive
+// when start is called, so the workers of pools created before count too and threads spawned
+// later don't, through perf_event_open on linux, unavailable elsewhere or when
+// kernel.perf_event_paranoid forbids it
+class ProcessCounters {
+public:
+  ProcessCounters() = default;
+  ~ProcessCounters();
+
+  ProcessCounters(ProcessCounters const &)            = delete;
+  ProcessCounters &operator=(ProcessCounters const &) = delete;
+
+  // opens the counters and starts counting, false when no counter could be opened
+  bool start();
+
+  // stops counting and closes the counters, all zero if start failed
+  Counts stop();
+
+private:
+  void _close();
+
+  std::vector<int> mFileDescriptors;
+};
+
+} // namespace Counters
@@ -0,0 +1,189 @@
+#include "Instrument.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Event {
+  std::string name;
+  char phase; // X is a complete zone, C a value sample
+  Instrument::Clock::time_point start;
+  Instrument::Clock::duration duration;
+  double value;
+};
+
+// every thread appends to its own buffer, the lock is only contended while exporting
+struct ThreadBuffer {
+  std::mutex mutex;
+  size_t threadIndex = 0;
+  std::vector<Event> events;
+  std::map<std::string, int64_t> counters;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  Instrument::Clock::time_point origin = Instrument::Clock::now();
+};
+
+Registry &_registry() {
+  static Registry registry;
+  return registry;
+}
+
+// buffers belong to the registry, so events of threads that already exited are still exported
+thread_local ThreadBuffer *tBuffer = nullptr;
+
+ThreadBuffer &_threadBuffer() {
+  if (tBuffer == nullptr) {
+    Registry &registry = _registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+    tBuffer              = registry.buffers.back().get();
+    tBuffer->threadIndex = registry.buffers.size();
+  }
+  return *tBuffer;
+}
+
+double _microseconds(Instrument::Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+// zone names are identifiers and file names, only quotes and backslashes need escaping
+void _writeName(std::ostream &out, std::string const &name) {
+  out << '"';
+  for (char c : name) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+} // namespace
+
+namespace Instrument {
+
+std::atomic<bool> gEnabled{false};
+
+void setEnabled(bool enabled) {
+  if (enabled) {
+    Registry &registry = _registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto &buffer : registry.buffers) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      buffer->events.clear();
+      buffer->counters.clear();
+    }
+    registry.origin = Clock::now();
+  }
+  gEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void recordZone(std::string name, Clock::time_point start, Clock::time_point end) {
+  ThreadBuffer &buffer = _threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.events.push_back({std::move(name), 'X', start, end - start, 0.0});
+}
+
+void count(char const *name, int64_t delta) {
+  if (!isEnabled()) {
+    return;
+  }
+  ThreadBuffer &buffer = _threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.counters[name] += delta;
+}
+
+void recordValue(char const *name, double value) {
+  if (!isEnabled()) {
+    return;
+  }
+  ThreadBuffer &buffer = _threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.events.push_back({name, 'C', Clock::now(), Clock::duration::zero(), value});
+}
+
+bool writeChromeTrace(std::string const &filePath) {
+  std::ofstream out(filePath, std::ios::binary);
+  if (!out) {
+    std::cerr << "Cannot open file (" << filePath << ")" << std::endl;
+    return false;
+  }
+
+  Registry &registry = _registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (auto &buffer : registry.buffers) {
+    std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+    for (Event const &event : buffer->events) {
+      out << (first ? "\n" : ",\n") << "{\"name\":";
+      _writeName(out, event.name);
+      out << ",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << buffer->threadIndex
+          << ",\"ts\":" << _microseconds(event.start - registry.origin);
+      if (event.phase == 'X') {
+        out << ",\"dur\":" << _microseconds(event.duration);
+      } else {
+        out << ",\"args\":{\"value\":" << event.value << "}";
+      }
+      out << "}";
+      first = false;
+    }
+  }
+  out << "\n]}\n";
+
+  if (!out) {
+    std::cerr << "Cannot write file (" << filePath << ")" << std::endl;
+    return false;
+  }
+  std::cout << "Trace written to path (" << filePath << ")" << std::endl;
+  return true;
+}
+
+void printSummary() {
+  struct ZoneTotal {
+    size_t calls        = 0;
+    double microseconds = 0.0;
+  };
+  std::map<std::string, int64_t> counters;
+  std::map<std::string, ZoneTotal> zones;
+
+  {
+    Registry &registry = _registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto &buffer : registry.buffers) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      for (auto const &[name, value] : buffer->counters) {
+        counters[name] += value;
+      }
+      for (Event const &event : buffer->events) {
+        if (event.phase == 'X') {
+          ZoneTotal &total = zones[event.name];
+          total.calls++;
+          total.microseconds += _microseconds(event.duration);
+        }
+      }
+    }
+  }
+
+  for (auto const &[name, total] : zones) {
+    std::cout << name << ": " << total.calls << " calls, " << total.microseconds / 1e6
+              << "s total, " << total.microseconds / 1e3 / total.calls << "ms mean" << std::endl;
+  }
+  for (auto const &[name, value] : counters) {
+    std::cout << name << ": " << value << std::endl;
+  }
+}
+
+} // namespace Instrument
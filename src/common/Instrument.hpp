@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// zones, counters and sampled values for a Chrome trace (chrome://tracing or ui.perfetto.dev),
+// everything returns after one relaxed load while disabled so it can stay in production builds
+namespace Instrument {
+
+extern std::atomic<bool> gEnabled;
+
+inline bool isEnabled() { return gEnabled.load(std::memory_order_relaxed); }
+
+// enabling also drops everything recorded so far
+void setEnabled(bool enabled);
+
+typedef std::chrono::steady_clock Clock;
+
+void recordZone(std::string name, Clock::time_point start, Clock::time_point end);
+
+// adds delta to a summary counter, hot loops should sum locally and report once
+void count(char const *name, int64_t delta);
+
+// one sample of a value track in the trace, such as a queue size over time
+void recordValue(char const *name, double value);
+
+// times its scope as one trace event
+class Zone {
+public:
+  explicit Zone(char const *name) : mEnabled(isEnabled()) {
+    if (mEnabled) {
+      mName  = name;
+      mStart = Clock::now();
+    }
+  }
+  explicit Zone(std::string name) : mEnabled(isEnabled()) {
+    if (mEnabled) {
+      mName  = std::move(name);
+      mStart = Clock::now();
+    }
+  }
+  ~Zone() {
+    if (mEnabled) {
+      recordZone(std::move(mName), mStart, Clock::now());
+    }
+  }
+
+  Zone(Zone const &)            = delete;
+  Zone &operator=(Zone const &) = delete;
+
+private:
+  bool mEnabled;
+  std::string mName;
+  Clock::time_point mStart;
+};
+
+// call while no instrumented work is running
+bool writeChromeTrace(std::string const &filePath);
+
+// counters and per zone name call count, total and mean time
+void printSummary();
+
+} // namespace Instrument
@@ -0,0 +1,390 @@
+#include "Json.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+
+int constexpr kMaxDepth = 64;
+
+class Parser {
+public:
+  explicit Parser(std::string_view text) : mText(text) {}
+
+  std::optional<Json::Value> parseDocument() {
+    Json::Value value;
+    if (!_parseValue(value, 0)) {
+      return std::nullopt;
+    }
+    _skipWhitespace();
+    if (mPosition != mText.size()) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+private:
+  void _skipWhitespace() {
+    while (mPosition < mText.size() && (mText[mPosition] == ' ' || mText[mPosition] == '\t' ||
+                                        mText[mPosition] == '\n' || mText[mPosition] == '\r')) {
+      ++mPosition;
+    }
+  }
+
+  bool _consume(char expected) {
+    _skipWhitespace();
+    if (mPosition < mText.size() && mText[mPosition] == expected) {
+      ++mPosition;
+      return true;
+    }
+    return false;
+  }
+
+  bool _consumeWord(std::string_view word) {
+    if (mText.substr(mPosition, word.size()) != word) {
+      return false;
+    }
+    mPosition += word.size();
+    return true;
+  }
+
+  bool _parseValue(Json::Value &value, int depth) {
+    if (depth > kMaxDepth) {
+      return false;
+    }
+    _skipWhitespace();
+    if (mPosition >= mText.size()) {
+      return false;
+    }
+
+    switch (mText[mPosition]) {
+    case '{':
+      return _parseObject(value, depth);
+    case '[':
+      return _parseArray(value, depth);
+    case '"': {
+      std::string text;
+      if (!_parseString(text)) {
+        return false;
+      }
+      value = Json::Value(std::move(text));
+      return true;
+    }
+    case 't':
+      value = Json::Value(true);
+      return _consumeWord("true");
+    case 'f':
+      value = Json::Value(false);
+      return _consumeWord("false");
+    case 'n':
+      value = Json::Value();
+      return _consumeWord("null");
+    default:
+      return _parseNumber(value);
+    }
+  }
+
+  bool _parseObject(Json::Value &value, int depth) {
+    ++mPosition; // {
+    value = Json::Value::object();
+    if (_consume('}')) {
+      return true;
+    }
+    do {
+      _skipWhitespace();
+      std::string key;
+      Json::Value member;
+      if (mPosition >= mText.size() || mText[mPosition] != '"' || !_parseString(key) ||
+          !_consume(':') || !_parseValue(member, depth + 1)) {
+        return false;
+      }
+      value.set(key, std::move(member));
+    } while (_consume(','));
+    return _consume('}');
+  }
+
+  bool _parseArray(Json::Value &value, int depth) {
+    ++mPosition; // [
+    value = Json::Value::array();
+    if (_consume(']')) {
+      return true;
+    }
+    do {
+      Json::Value element;
+      if (!_parseValue(element, depth + 1)) {
+        return false;
+      }
+      value.push(std::move(element));
+    } while (_consume(','));
+    return _consume(']');
+  }
+
+  bool _parseHex4(uint32_t &codePoint) {
+    if (mPosition + 4 > mText.size()) {
+      return false;
+    }
+    char const *begin = mText.data() + mPosition;
+    auto result       = std::from_chars(begin, begin + 4, codePoint, 16);
+    if (result.ptr != begin + 4) {
+      return false;
+    }
+    mPosition += 4;
+    return true;
+  }
+
+  static void _appendUtf8(std::string &text, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+      text += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+      text += static_cast<char>(0xC0 | (codePoint >> 6));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+      text += static_cast<char>(0xE0 | (codePoint >> 12));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+      text += static_cast<char>(0xF0 | (codePoint >> 18));
+      text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+  }
+
+  bool _parseString(std::string &text) {
+    ++mPosition; // "
+    while (mPosition < mText.size()) {
+      char const c = mText[mPosition++];
+      if (c == '"') {
+        return true;
+      }
+      if (static_cast<unsigned char>(c) < 0x20) {
+        return false;
+      }
+      if (c != '\\') {
+        text += c;
+        continue;
+      }
+
+      if (mPosition >= mText.size()) {
+        return false;
+      }
+      char const escaped = mText[mPosition++];
+      switch (escaped) {
+      case '"':
+      case '\\':
+      case '/':
+        text += escaped;
+        break;
+      case 'b':
+        text += '\b';
+        break;
+      case 'f':
+        text += '\f';
+        break;
+      case 'n':
+        text += '\n';
+        break;
+      case 'r':
+        text += '\r';
+        break;
+      case 't':
+        text += '\t';
+        break;
+      case 'u': {
+        uint32_t codePoint = 0;
+        if (!_parseHex4(codePoint)) {
+          return false;
+        }
+        // a high surrogate has to be followed by an escaped low surrogate
+        if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+          uint32_t low = 0;
+          if (!_consumeWord("\\u") || !_parseHex4(low) || low < 0xDC00 || low >= 0xE000) {
+            return false;
+          }
+          codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+        } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+          return false;
+        }
+        _appendUtf8(text, codePoint);
+        break;
+      }
+      default:
+        return false;
+      }
+    }
+    return false;
+  }
+
+  bool _parseNumber(Json::Value &value) {
+    char const *begin = mText.data() + mPosition;
+    char const *end   = mText.data() + mText.size();
+    // from_chars would also take inf and nan, which JSON does not have
+    if (*begin != '-' && (*begin < '0' || *begin > '9')) {
+      return false;
+    }
+    double number = 0.0;
+    auto result   = std::from_chars(begin, end, number);
+    if (result.ec != std::errc() || result.ptr == begin) {
+      return false;
+    }
+    mPosition += result.ptr - begin;
+    value = Json::Value(number);
+    return true;
+  }
+
+  std::string_view mText;
+  size_t mPosition = 0;
+};
+
+void _dumpString(std::string const &text, std::string &out) {
+  out += '"';
+  for (char c : text) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[7];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+        out += escaped;
+      } else {
+        out += c;
+      }
+    }
+  }
+  out += '"';
+}
+
+void _newLine(std::string &out, int indent, int depth) {
+  if (indent > 0) {
+    out += '\n';
+    out.append(static_cast<size_t>(indent * depth), ' ');
+  }
+}
+
+void _dumpValue(Json::Value const &value, std::string &out, int indent, int depth) {
+  switch (value.type()) {
+  case Json::Value::Type::kNull:
+    out += "null";
+    break;
+  case Json::Value::Type::kBool:
+    out += value.asBool() ? "true" : "false";
+    break;
+  case Json::Value::Type::kNumber: {
+    // JSON has no inf or nan
+    if (!std::isfinite(value.asNumber())) {
+      out += "null";
+      break;
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value.asNumber());
+    out.append(buffer, result.ptr);
+    break;
+  }
+  case Json::Value::Type::kString:
+    _dumpString(value.asString(), out);
+    break;
+  case Json::Value::Type::kArray: {
+    Json::Value::Array const &array = value.asArray();
+    out += '[';
+    for (size_t i = 0; i < array.size(); i++) {
+      out += i == 0 ? "" : ",";
+      _newLine(out, indent, depth + 1);
+      _dumpValue(array[i], out, indent, depth + 1);
+    }
+    if (!array.empty()) {
+      _newLine(out, indent, depth);
+    }
+    out += ']';
+    break;
+  }
+  case Json::Value::Type::kObject: {
+    Json::Value::Object const &object = value.asObject();
+    out += '{';
+    for (size_t i = 0; i < object.size(); i++) {
+      out += i == 0 ? "" : ",";
+      _newLine(out, indent, depth + 1);
+      _dumpString(object[i].first, out);
+      out += indent > 0 ? ": " : ":";
+      _dumpValue(object[i].second, out, indent, depth + 1);
+    }
+    if (!object.empty()) {
+      _newLine(out, indent, depth);
+    }
+    out += '}';
+    break;
+  }
+  }
+}
+
+} // namespace
+
+namespace Json {
+
+Value Value::array() {
+  Value value;
+  value.mType = Type::kArray;
+  return value;
+}
+
+Value Value::object() {
+  Value value;
+  value.mType = Type::kObject;
+  return value;
+}
+
+Value &Value::push(Value value) {
+  if (mType == Type::kNull) {
+    mType = Type::kArray;
+  }
+  mArray.push_back(std::move(value));
+  return mArray.back();
+}
+
+Value &Value::set(std::string const &key, Value value) {
+  if (mType == Type::kNull) {
+    mType = Type::kObject;
+  }
+  for (auto &[memberKey, member] : mObject) {
+    if (memberKey == key) {
+      member = std::move(value);
+      return member;
+    }
+  }
+  mObject.emplace_back(key, std::move(value));
+  return mObject.back().second;
+}
+
+Value const *Value::find(std::string const &key) const {
+  for (auto const &[memberKey, member] : mObject) {
+    if (memberKey == key) {
+      return &member;
+    }
+  }
+  return nullptr;
+}
+
+std::optional<Value> parse(std::string_view text) { return Parser(text).parseDocument(); }
+
+std::string dump(Value const &value, int indent) {
+  std::string out;
+  _dumpValue(value, out, indent, 0);
+  return out;
+}
+
+} // namespace Json
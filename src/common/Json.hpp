@@ -0,0 +1,76 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Json {
+
+// a parsed or hand-built JSON document, objects keep their keys in insertion order
+class Value {
+public:
+  enum class Type {
+    kNull,
+    kBool,
+    kNumber,
+    kString,
+    kArray,
+    kObject,
+  };
+
+  typedef std::vector<Value> Array;
+  typedef std::vector<std::pair<std::string, Value>> Object;
+
+  Value() = default;
+  Value(bool value) : mType(Type::kBool), mBool(value) {}
+  template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+  Value(T value) : mType(Type::kNumber), mNumber(static_cast<double>(value)) {}
+  Value(std::string value) : mType(Type::kString), mString(std::move(value)) {}
+  Value(char const *value) : mType(Type::kString), mString(value) {}
+
+  static Value array();
+  static Value object();
+
+  [[nodiscard]] Type type() const { return mType; }
+  [[nodiscard]] bool isNull() const { return mType == Type::kNull; }
+  [[nodiscard]] bool isBool() const { return mType == Type::kBool; }
+  [[nodiscard]] bool isNumber() const { return mType == Type::kNumber; }
+  [[nodiscard]] bool isString() const { return mType == Type::kString; }
+  [[nodiscard]] bool isArray() const { return mType == Type::kArray; }
+  [[nodiscard]] bool isObject() const { return mType == Type::kObject; }
+
+  // the accessors return an empty or zero value when the type does not match
+  [[nodiscard]] bool asBool() const { return mBool; }
+  [[nodiscard]] double asNumber() const { return mNumber; }
+  [[nodiscard]] std::string const &asString() const { return mString; }
+  [[nodiscard]] Array const &asArray() const { return mArray; }
+  [[nodiscard]] Object const &asObject() const { return mObject; }
+
+  // appends to an array, a null value becomes an empty array first
+  Value &push(Value value);
+
+  // sets a key of an object, a null value becomes an empty object first
+  Value &set(std::string const &key, Value value);
+
+  // nullptr when this is not an object or has no such key
+  [[nodiscard]] Value const *find(std::string const &key) const;
+
+private:
+  Type mType     = Type::kNull;
+  bool mBool     = false;
+  double mNumber = 0.0;
+  std::string mString;
+  Array mArray;
+  Object mObject;
+};
+
+// nullopt on malformed input or nesting deeper than 64 levels
+std::optional<Value> parse(std::string_view text);
+
+// indent 0 writes everything on one line
+std::string dump(Value const &value, int indent = 2);
+
+} // namespace Json
@@ -0,0 +1,74 @@
+#include "Memory.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+// windows.h first
+#include <psapi.h>
+#else
+#include <fstream>
+#include <string>
+#endif
+
+namespace {
+
+#ifndef _WIN32
+
+// reads a "Name:   1234 kB" line of /proc/self/status
+size_t _readStatusKiloBytes(char const *name) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  std::string const prefix = std::string(name) + ":";
+  while (std::getline(status, line)) {
+    if (line.compare(0, prefix.size(), prefix) == 0) {
+      return std::stoull(line.substr(prefix.size())) * 1024;
+    }
+  }
+  return 0;
+}
+
+#endif
+
+} // namespace
+
+namespace Memory {
+
+#ifdef _WIN32
+
+size_t currentResidentBytes() {
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return counters.WorkingSetSize;
+}
+
+size_t peakResidentBytes() {
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize;
+}
+
+bool resetPeakResident() { return false; }
+
+#else
+
+size_t currentResidentBytes() { return _readStatusKiloBytes("VmRSS"); }
+
+size_t peakResidentBytes() { return _readStatusKiloBytes("VmHWM"); }
+
+// writing 5 to clear_refs resets VmHWM, linux 4.0 and later
+bool resetPeakResident() {
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+  clearRefs.flush();
+  return clearRefs.good();
+}
+
+#endif
+
+} // namespace Memory
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Memory {
+
+// resident set size of this process in bytes, 0 when the platform does not tell
+size_t currentResidentBytes();
+
+// highest resident set size since start or since the last successful resetPeakResident
+size_t peakResidentBytes();
+
+// restarts the peak tracking at the current resident size, false when the platform cannot, in
+// which case peakResidentBytes keeps reporting the peak since process start
+bool resetPeakResident();
+
+} // namespace Memory
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Simple_cartesian.h>
+#include <CGAL/Surface_mesh.h>
+
+// the mesh type every module works on, so a loaded mesh can be handed from stage to stage
+typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel;
+typedef CGAL::Surface_mesh<Kernel::Point_3> Mesh;
+
+// single precision storage for inputs where point memory dominates, half the bytes per point of
+// Mesh, the float kernel only stores, anything computing on the points reads them through
+// CompactPointMap so it still gets Kernel and its exact predicates
+typedef CGAL::Simple_cartesian<float> CompactKernel;
+typedef CGAL::Surface_mesh<CompactKernel::Point_3> CompactMesh;
+
+// the points of a CompactMesh as Kernel points, writes round to the nearest float
+struct CompactPointMap {
+  typedef CompactMesh::Vertex_index key_type;
+  typedef Kernel::Point_3 value_type;
+  typedef value_type reference;
+  typedef boost::read_write_property_map_tag category;
+
+  CompactMesh *mesh = nullptr;
+
+  friend value_type get(CompactPointMap const &map, key_type const &v) {
+    CompactKernel::Point_3 const &p = map.mesh->point(v);
+    return value_type(p.x(), p.y(), p.z());
+  }
+
+  friend void put(CompactPointMap const &map, key_type const &v, value_type const &p) {
+    map.mesh->point(v) = CompactKernel::Point_3(static_cast<float>(p.x()),
+                                                static_cast<float>(p.y()),
+                                                static_cast<float>(p.z()));
+  }
+};
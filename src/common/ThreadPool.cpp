@@ -0,0 +1,175 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace {
+thread_local ThreadPool const *tCurrentPool = nullptr;
+thread_local size_t tWorkerIndex            = 0;
+
+std::atomic<ThreadPool *> gGlobalOverride{nullptr};
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+
+  mWorkerQueues.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; i++) {
+    mWorkerQueues.emplace_back(std::make_unique<Worker>());
+  }
+
+  mWorkers.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; i++) {
+    mWorkers.emplace_back([this, i]() { _workerLoop(i); });
+  }
+}
+
+std::unique_ptr<ThreadPool> ThreadPool::withThreads(size_t threadCount) {
+  if (threadCount <= 1) {
+    return std::unique_ptr<ThreadPool>(new ThreadPool(NoWorkers{}));
+  }
+  return std::make_unique<ThreadPool>(threadCount - 1);
+}
+
+ThreadPool::~ThreadPool() {
+  waitIdle();
+  {
+    std::lock_guard<std::mutex> lock(mWakeMutex);
+    mStopping = true;
+  }
+  mWakeCondition.notify_all();
+  for (auto &worker : mWorkers) {
+    worker.join();
+  }
+}
+
+ThreadPool &ThreadPool::global() {
+  if (ThreadPool *pool = gGlobalOverride.load(std::memory_order_acquire)) {
+    return *pool;
+  }
+  static ThreadPool pool{};
+  return pool;
+}
+
+void ThreadPool::setGlobal(ThreadPool *pool) {
+  gGlobalOverride.store(pool, std::memory_order_release);
+}
+
+void ThreadPool::submit(Task task) {
+  if (mWorkerQueues.empty()) {
+    task();
+    return;
+  }
+
+  size_t index = 0;
+  if (tCurrentPool == this) {
+    index = tWorkerIndex;
+  } else {
+    index = mNextQueue.fetch_add(1, std::memory_order_relaxed) % mWorkerQueues.size();
+  }
+
+  mPendingCount.fetch_add(1, std::memory_order_acq_rel);
+  {
+    std::lock_guard<std::mutex> lock(mWorkerQueues[index]->mutex);
+    mWorkerQueues[index]->tasks.emplace_back(std::move(task));
+  }
+
+  // taking the wake mutex orders this notify after a worker's emptiness check
+  { std::lock_guard<std::mutex> lock(mWakeMutex); }
+  mWakeCondition.notify_one();
+}
+
+void ThreadPool::waitIdle() {
+  if (tCurrentPool == this) {
+    // a worker can't sleep on its own pool, drain instead
+    while (mPendingCount.load(std::memory_order_acquire) != 0) {
+      if (!_tryRunOne(tWorkerIndex)) {
+        std::this_thread::yield();
+      }
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mWakeMutex);
+  mIdleCondition.wait(lock, [this]() { return mPendingCount.load() == 0; });
+}
+
+bool ThreadPool::_popTask(size_t index, Task &task) {
+  size_t const queueCount = mWorkerQueues.size();
+
+  // own work first, newest task is the hottest in cache
+  if (index < queueCount) {
+    Worker &own = *mWorkerQueues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  // steal the oldest task from someone else
+  size_t const start = index < queueCount ? index + 1 : 0;
+  for (size_t offset = 0; offset < queueCount; offset++) {
+    size_t const victimIndex = (start + offset) % queueCount;
+    if (victimIndex == index) {
+      continue;
+    }
+    Worker &victim = *mWorkerQueues[victimIndex];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::_tryRunOne(size_t preferredIndex) {
+  if (tCurrentPool == this) {
+    preferredIndex = tWorkerIndex;
+  }
+
+  Task task;
+  if (!_popTask(preferredIndex, task)) {
+    return false;
+  }
+
+  task();
+
+  if (mPendingCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    std::lock_guard<std::mutex> lock(mWakeMutex);
+    mIdleCondition.notify_all();
+  }
+  return true;
+}
+
+void ThreadPool::_workerLoop(size_t index) {
+  tCurrentPool = this;
+  tWorkerIndex = index;
+
+  for (;;) {
+    if (_tryRunOne(index)) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mWakeMutex);
+    if (mStopping) {
+      return;
+    }
+    // re-check under the lock so a submit between the failed pop and here is not lost
+    bool hasWork = false;
+    for (auto const &queue : mWorkerQueues) {
+      std::lock_guard<std::mutex> queueLock(queue->mutex);
+      if (!queue->tasks.empty()) {
+        hasWork = true;
+        break;
+      }
+    }
+    if (!hasWork) {
+      mWakeCondition.wait(lock);
+    }
+  }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a work-stealing thread pool, every worker owns a deque, pops its own work from the back and
+// steals from the front of the others when it runs dry
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  // threadCount == 0 means one worker per hardware thread
+  explicit ThreadPool(size_t threadCount = 0);
+
+  // threadCount threads counting the caller of parallelFor, so threadCount - 1 workers, a single
+  // thread is a pool without workers where everything runs on the caller
+  static std::unique_ptr<ThreadPool> withThreads(size_t threadCount);
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const &)            = delete;
+  ThreadPool &operator=(ThreadPool const &) = delete;
+
+  // the workers, a pool without any counts the caller that runs its work, so this is never 0 and
+  // callers can size rounds and chunk counts by it
+  [[nodiscard]] size_t getThreadCount() const { return std::max<size_t>(1, mWorkers.size()); }
+
+  // tasks submitted from a worker go to that worker's own deque, others are spread round-robin
+  void submit(Task task);
+
+  // blocks until every submitted task has finished, the calling thread helps if it is a worker
+  void waitIdle();
+
+  // runs body(i) for i in [0, count) and returns when all are done, the calling thread takes part
+  // in the work so this is safe to call from inside a task
+  template <typename Body> void parallelFor(size_t count, Body &&body);
+
+  // the pool shared by modules that don't manage their own
+  static ThreadPool &global();
+
+  // global returns pool instead until called again with nullptr, lets a benchmark sweep the thread
+  // count of modules that only use the global pool, not to be switched while tasks are running
+  static void setGlobal(ThreadPool *pool);
+
+private:
+  struct NoWorkers {};
+  explicit ThreadPool(NoWorkers) {}
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void _workerLoop(size_t index);
+  bool _tryRunOne(size_t preferredIndex);
+  bool _popTask(size_t index, Task &task);
+
+  std::vector<std::unique_ptr<Worker>> mWorkerQueues;
+  std::vector<std::thread> mWorkers;
+
+  std::mutex mWakeMutex;
+  std::condition_variable mWakeCondition;
+  std::condition_variable mIdleCondition;
+
+  std::atomic<size_t> mPendingCount{0};
+  std::atomic<size_t> mNextQueue{0};
+  std::atomic<bool> mStopping{false};
+};
+
+template <typename Body> void ThreadPool::parallelFor(size_t count, Body &&body) {
+  if (count == 0) {
+    return;
+  }
+  if (count == 1 || mWorkers.empty()) {
+    for (size_t i = 0; i < count; i++) {
+      body(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> remaining{count};
+  for (size_t i = 1; i < count; i++) {
+    submit([&body, &remaining, i]() {
+      body(i);
+      remaining.fetch_sub(1, std::memory_order_release);
+    });
+  }
+
+  body(size_t{0});
+  remaining.fetch_sub(1, std::memory_order_release);
+
+  // help with whatever is queued instead of blocking a worker, otherwise nested calls deadlock
+  while (remaining.load(std::memory_order_acquire) != 0) {
+    if (!_tryRunOne(mWorkers.size())) {
+      std::this_thread::yield();
+    }
+  }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <chrono>
+
+// wall time for the reports printed to the console, trace zones have their own clock in Instrument
+namespace Timing {
+
+typedef std::chrono::high_resolution_clock Clock;
+
+inline double secondsSince(Clock::time_point const &start) {
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  return elapsed.count();
+}
+
+} // namespace Timing
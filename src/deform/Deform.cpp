@@ -0,0 +1,428 @@
+#include "Deform.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+#include <Eigen/SVD>
+#include <Eigen/SparseCholesky>
+#include <ceres/ceres.h>
+#include <ceres/rotation.h>
+
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/Timing.hpp"
+#include "io/Io.hpp"
+#include "io/SurfaceMeshIo.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+namespace {
+
+typedef Mesh::Vertex_index Vertex_index;
+typedef Mesh::Halfedge_index Halfedge_index;
+// obtuse triangles give negative cotangent weights which make the energy indefinite
+double constexpr kMinWeight = 1e-4;
+
+// vertices per parallel task of the local step and the right hand side
+size_t constexpr kBlockSize = size_t{1} << 12;
+
+// the column of a vertex that is not solved for
+int64_t constexpr kFixed = -1;
+
+// the cotangent of the angle facing h in its face, 0 for a border halfedge
+double _cotangent(Mesh const &mesh, Halfedge_index h) {
+  if (mesh.is_border(h)) {
+    return 0.0;
+  }
+  Kernel::Point_3 const &opposite = mesh.point(mesh.target(mesh.next(h)));
+  Kernel::Vector_3 const a        = mesh.point(mesh.source(h)) - opposite;
+  Kernel::Vector_3 const b        = mesh.point(mesh.target(h)) - opposite;
+  double const sine               = std::sqrt(CGAL::cross_product(a, b).squared_length());
+  return sine > 0.0 ? a * b / sine : 0.0;
+}
+
+// the weight of the edge of h, the same from both sides
+double _edgeWeight(Mesh const &mesh, Halfedge_index h) {
+  double const cotangent = _cotangent(mesh, h) + _cotangent(mesh, mesh.opposite(h));
+  return std::max(0.5 * cotangent, kMinWeight);
+}
+
+// one edge of the cell of vertex i, (pi - pj) should be the rest edge turned by the rotation of i
+struct EdgeResidual {
+  EdgeResidual(double weight, Kernel::Vector_3 const &rest)
+      : mWeight(weight), mRest{rest.x(), rest.y(), rest.z()} {}
+
+  template <typename T>
+  bool operator()(T const *rotation, T const *pi, T const *pj, T *residual) const {
+    T const rest[3] = {T(mRest[0]), T(mRest[1]), T(mRest[2])};
+    T rotated[3];
+    ceres::AngleAxisRotatePoint(rotation, rest, rotated);
+    for (int k = 0; k < 3; k++) {
+      residual[k] = T(mWeight) * (pi[k] - pj[k] - rotated[k]);
+    }
+    return true;
+  }
+
+  static ceres::CostFunction *create(double weight, Kernel::Vector_3 const &rest) {
+    return new ceres::AutoDiffCostFunction<EdgeResidual, 3, 3, 3, 3>(
+        new EdgeResidual(weight, rest));
+  }
+
+  // square root of the cotangent weight, Ceres squares the residual
+  double mWeight;
+  double mRest[3];
+};
+
+// vertex j seen from vertex i, rest is pi - pj in the rest shape
+struct Neighbour {
+  uint32_t vertex;
+  double weight;
+  Eigen::Vector3d rest;
+};
+
+} // namespace
+
+namespace Deform {
+
+struct Deformer::System {
+  // the neighbours of vertex i are edges[edgeOffsets[i]] to edges[edgeOffsets[i + 1]]
+  std::vector<size_t> edgeOffsets;
+  std::vector<Neighbour> edges;
+
+  // the row of every free vertex in the Laplacian, kFixed for the others
+  std::vector<int64_t> columns;
+  std::vector<uint32_t> freeVertices;
+
+  std::vector<Eigen::Matrix3d> rotations;
+  Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver;
+  bool factored = false;
+};
+
+Deformer::Deformer(Mesh const &mesh, std::vector<Mesh::Vertex_index> const &anchors,
+                   std::vector<Mesh::Vertex_index> const &handles, Options const &options)
+    : mOptions(options), mHandles(handles), mPositions(3 * mesh.num_vertices()),
+      mRotations(3 * mesh.num_vertices(), 0.0), mSystem(std::make_unique<System>()) {
+  Instrument::Zone zone("deform.setup");
+
+  for (Vertex_index v : mesh.vertices()) {
+    Kernel::Point_3 const &p = mesh.point(v);
+    mPositions[3 * v]        = p.x();
+    mPositions[3 * v + 1]    = p.y();
+    mPositions[3 * v + 2]    = p.z();
+  }
+
+  System &system           = *mSystem;
+  size_t const vertexCount = mesh.num_vertices();
+  system.rotations.assign(vertexCount, Eigen::Matrix3d::Identity());
+  system.edgeOffsets.assign(vertexCount + 1, 0);
+  for (size_t i = 0; i < vertexCount; i++) {
+    Vertex_index const v(static_cast<Mesh::size_type>(i));
+    if (!mesh.is_removed(v) && mesh.halfedge(v) != Mesh::null_halfedge()) {
+      for (Halfedge_index h : CGAL::halfedges_around_target(mesh.halfedge(v), mesh)) {
+        Kernel::Vector_3 const rest = mesh.point(v) - mesh.point(mesh.source(h));
+        system.edges.push_back({static_cast<uint32_t>(mesh.source(h)), _edgeWeight(mesh, h),
+                                Eigen::Vector3d(rest.x(), rest.y(), rest.z())});
+      }
+    }
+    system.edgeOffsets[i + 1] = system.edges.size();
+  }
+
+  // anchors and handles are fixed, and so is every part of the mesh none of them reaches, as any
+  // rigid motion of it is a solution and it may as well stay where it is
+  std::vector<bool> fixed(vertexCount, false);
+  for (auto const *vertices : {&anchors, &handles}) {
+    for (Vertex_index v : *vertices) {
+      fixed[v] = true;
+    }
+  }
+  std::vector<bool> visited(vertexCount, false);
+  std::vector<uint32_t> component;
+  size_t unreachedCount = 0;
+  for (uint32_t seed = 0; seed < vertexCount; seed++) {
+    if (visited[seed] || system.edgeOffsets[seed] == system.edgeOffsets[seed + 1]) {
+      continue;
+    }
+    component.assign(1, seed);
+    visited[seed]  = true;
+    bool isReached = false;
+    for (size_t k = 0; k < component.size(); k++) {
+      uint32_t const i = component[k];
+      isReached        = isReached || fixed[i];
+      for (size_t e = system.edgeOffsets[i]; e < system.edgeOffsets[i + 1]; e++) {
+        uint32_t const j = system.edges[e].vertex;
+        if (!visited[j]) {
+          visited[j] = true;
+          component.push_back(j);
+        }
+      }
+    }
+    if (!isReached) {
+      unreachedCount += component.size();
+    }
+    for (uint32_t i : component) {
+      if (isReached && !fixed[i]) {
+        system.freeVertices.push_back(i);
+      }
+    }
+  }
+  if (unreachedCount != 0) {
+    std::cout << unreachedCount << " vertices are not connected to an anchor or a handle and stay "
+              << "in place" << std::endl;
+  }
+  std::sort(system.freeVertices.begin(), system.freeVertices.end());
+  system.columns.assign(vertexCount, kFixed);
+  for (size_t column = 0; column < system.freeVertices.size(); column++) {
+    system.columns[system.freeVertices[column]] = static_cast<int64_t>(column);
+  }
+
+  // the Laplacian of the free vertices, symmetric positive definite as every part of it reaches a
+  // fixed vertex
+  std::vector<Eigen::Triplet<double>> entries;
+  entries.reserve(system.freeVertices.size() + system.edges.size());
+  for (uint32_t i : system.freeVertices) {
+    int64_t const row = system.columns[i];
+    double diagonal   = 0.0;
+    for (size_t e = system.edgeOffsets[i]; e < system.edgeOffsets[i + 1]; e++) {
+      Neighbour const &neighbour = system.edges[e];
+      diagonal += neighbour.weight;
+      if (system.columns[neighbour.vertex] != kFixed) {
+        entries.emplace_back(row, system.columns[neighbour.vertex], -neighbour.weight);
+      }
+    }
+    entries.emplace_back(row, row, diagonal);
+  }
+  Eigen::SparseMatrix<double> laplacian(system.freeVertices.size(), system.freeVertices.size());
+  laplacian.setFromTriplets(entries.begin(), entries.end());
+  system.solver.compute(laplacian);
+  system.factored = system.solver.info() == Eigen::Success;
+  if (!system.factored) {
+    std::cerr << "Cannot factor the deformation system" << std::endl;
+  }
+
+  if (mOptions.refineIterations <= 0) {
+    return;
+  }
+  mProblem = std::make_unique<ceres::Problem>();
+  for (auto e : mesh.edges()) {
+    Halfedge_index const h = mesh.halfedge(e);
+
+    Vertex_index const i        = mesh.source(h);
+    Vertex_index const j        = mesh.target(h);
+    Kernel::Vector_3 const rest = mesh.point(i) - mesh.point(j);
+    double const weightRoot     = std::sqrt(_edgeWeight(mesh, h));
+    double *const positionI     = &mPositions[3 * i];
+    double *const positionJ     = &mPositions[3 * j];
+    mProblem->AddResidualBlock(EdgeResidual::create(weightRoot, rest), nullptr,
+                               &mRotations[3 * i], positionI, positionJ);
+    mProblem->AddResidualBlock(EdgeResidual::create(weightRoot, -rest), nullptr,
+                               &mRotations[3 * j], positionJ, positionI);
+  }
+
+  // an isolated vertex has no residual and so no block to hold
+  for (size_t v = 0; v < vertexCount; v++) {
+    if (system.columns[v] == kFixed && mProblem->HasParameterBlock(&mPositions[3 * v])) {
+      mProblem->SetParameterBlockConstant(&mPositions[3 * v]);
+    }
+  }
+}
+
+Deformer::~Deformer() = default;
+
+bool Deformer::drag(std::vector<Kernel::Point_3> const &positions) {
+  Instrument::Zone zone("deform.drag");
+
+  System &system      = *mSystem;
+  mLastIterationCount = 0;
+  if (!system.factored) {
+    return false;
+  }
+
+  std::vector<double> const previousPositions = mPositions;
+  for (size_t i = 0; i < mHandles.size() && i < positions.size(); i++) {
+    double *const position = &mPositions[3 * mHandles[i]];
+    position[0]            = positions[i].x();
+    position[1]            = positions[i].y();
+    position[2]            = positions[i].z();
+  }
+
+  auto const position = [&](uint32_t v) {
+    return Eigen::Map<Eigen::Vector3d>(&mPositions[3 * v]);
+  };
+
+  size_t const vertexCount  = system.columns.size();
+  size_t const freeCount    = system.freeVertices.size();
+  size_t const vertexBlocks = (vertexCount + kBlockSize - 1) / kBlockSize;
+  size_t const freeBlocks   = (freeCount + kBlockSize - 1) / kBlockSize;
+  Eigen::MatrixXd rightHand(freeCount, 3);
+  bool solved = true;
+  for (int iteration = 0; iteration < mOptions.maxIterations && solved; iteration++) {
+    // local step, the rotation closest to the weighted covariance of the rest and current edges
+    ThreadPool::global().parallelFor(vertexBlocks, [&](size_t block) {
+      size_t const blockEnd = std::min(vertexCount, (block + 1) * kBlockSize);
+      for (size_t i = block * kBlockSize; i < blockEnd; i++) {
+        if (system.edgeOffsets[i] == system.edgeOffsets[i + 1]) {
+          continue;
+        }
+        Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+        for (size_t e = system.edgeOffsets[i]; e < system.edgeOffsets[i + 1]; e++) {
+          Neighbour const &neighbour = system.edges[e];
+          Eigen::Vector3d const edge =
+              position(static_cast<uint32_t>(i)) - position(neighbour.vertex);
+          covariance += neighbour.weight * neighbour.rest * edge.transpose();
+        }
+        Eigen::JacobiSVD<Eigen::Matrix3d> svd(covariance,
+                                              Eigen::ComputeFullU | Eigen::ComputeFullV);
+        Eigen::Matrix3d u        = svd.matrixU();
+        Eigen::Matrix3d rotation = svd.matrixV() * u.transpose();
+        // a reflection, the smallest singular direction is flipped
+        if (rotation.determinant() < 0.0) {
+          u.col(2) *= -1.0;
+          rotation = svd.matrixV() * u.transpose();
+        }
+        system.rotations[i] = rotation;
+      }
+    });
+
+    // global step, fixed neighbours move to the right hand side
+    ThreadPool::global().parallelFor(freeBlocks, [&](size_t block) {
+      size_t const blockEnd = std::min(freeCount, (block + 1) * kBlockSize);
+      for (size_t column = block * kBlockSize; column < blockEnd; column++) {
+        uint32_t const i  = system.freeVertices[column];
+        Eigen::Vector3d b = Eigen::Vector3d::Zero();
+        for (size_t e = system.edgeOffsets[i]; e < system.edgeOffsets[i + 1]; e++) {
+          Neighbour const &neighbour = system.edges[e];
+          b += 0.5 * neighbour.weight *
+               (system.rotations[i] + system.rotations[neighbour.vertex]) * neighbour.rest;
+          if (system.columns[neighbour.vertex] == kFixed) {
+            b += neighbour.weight * position(neighbour.vertex);
+          }
+        }
+        rightHand.row(column) = b.transpose();
+      }
+    });
+    Eigen::MatrixXd const solution = system.solver.solve(rightHand);
+    solved                         = system.solver.info() == Eigen::Success;
+    for (size_t column = 0; column < freeCount && solved; column++) {
+      position(system.freeVertices[column]) = solution.row(column).transpose();
+    }
+    ++mLastIterationCount;
+  }
+  if (!solved) {
+    std::cerr << "Cannot solve the deformation" << std::endl;
+  }
+  if (solved && mProblem != nullptr) {
+    solved = _refine();
+  }
+
+  if (!solved) {
+    mPositions = previousPositions;
+    return false;
+  }
+  return true;
+}
+
+bool Deformer::_refine() {
+  Instrument::Zone zone("deform.refine");
+
+  // Ceres starts from the rotations of the last local step, both are column major
+  for (size_t v = 0; v < mSystem->rotations.size(); v++) {
+    ceres::RotationMatrixToAngleAxis(mSystem->rotations[v].data(), &mRotations[3 * v]);
+  }
+
+  size_t const threadCount =
+      mOptions.threadCount != 0 ? mOptions.threadCount : std::thread::hardware_concurrency();
+
+  ceres::Solver::Options options;
+  options.linear_solver_type           = ceres::SPARSE_NORMAL_CHOLESKY;
+  options.num_threads                  = static_cast<int>(std::max<size_t>(threadCount, 1));
+  options.max_num_iterations           = mOptions.refineIterations;
+  options.logging_type                 = ceres::SILENT;
+  options.minimizer_progress_to_stdout = false;
+
+  ceres::Solver::Summary summary;
+  ceres::Solve(options, mProblem.get(), &summary);
+  mLastIterationCount += static_cast<int>(summary.iterations.size());
+
+  if (!summary.IsSolutionUsable()) {
+    std::cerr << "Cannot refine the deformation (" << summary.message << ")" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+Kernel::Point_3 Deformer::point(Mesh::Vertex_index v) const {
+  return Kernel::Point_3(mPositions[3 * v], mPositions[3 * v + 1], mPositions[3 * v + 2]);
+}
+
+void Deformer::apply(Mesh &mesh) const {
+  for (Vertex_index v : mesh.vertices()) {
+    mesh.point(v) = point(v);
+  }
+}
+
+std::optional<std::vector<Mesh::Vertex_index>> findVertices(Mesh const &mesh,
+                                                            std::vector<size_t> const &indices) {
+  std::vector<Vertex_index> vertices;
+  vertices.reserve(indices.size());
+  for (size_t index : indices) {
+    Vertex_index const v(static_cast<Mesh::size_type>(index));
+    if (index >= mesh.num_vertices() || mesh.is_removed(v)) {
+      std::cerr << "Cannot find vertex (" << index << ")" << std::endl;
+      return std::nullopt;
+    }
+    vertices.push_back(v);
+  }
+  return vertices;
+}
+
+void deform(std::string const &filename, std::vector<size_t> const &anchors,
+            std::vector<size_t> const &handles, Kernel::Vector_3 const &offset, size_t stepCount,
+            Options const &options) {
+  std::string const inputFilePath  = Io::makeFullInputPath(filename);
+  std::string const outputFilePath = Io::makeMeshOutputPath(filename);
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return;
+  }
+  Mesh &mesh = maybeMesh.value();
+
+  auto anchorVertices = findVertices(mesh, anchors);
+  auto handleVertices = findVertices(mesh, handles);
+  if (anchorVertices == std::nullopt || handleVertices == std::nullopt) {
+    return;
+  }
+
+  auto start = Timing::Clock::now();
+  Deformer deformer(mesh, anchorVertices.value(), handleVertices.value(), options);
+  std::cout << "Setup: " << Timing::secondsSince(start) << "s" << std::endl;
+
+  stepCount           = std::max<size_t>(stepCount, 1);
+  double totalSeconds = 0.0;
+  std::vector<Kernel::Point_3> targets(handleVertices->size());
+  for (size_t step = 1; step <= stepCount; step++) {
+    double const t = static_cast<double>(step) / static_cast<double>(stepCount);
+    for (size_t i = 0; i < targets.size(); i++) {
+      targets[i] = mesh.point(handleVertices.value()[i]) + t * offset;
+    }
+
+    start                = Timing::Clock::now();
+    bool const solved    = deformer.drag(targets);
+    double const seconds = Timing::secondsSince(start);
+    totalSeconds += seconds;
+    std::cout << "Step " << step << ": " << seconds << "s, " << deformer.lastIterationCount()
+              << " iterations" << (solved ? "" : ", failed") << std::endl;
+  }
+  std::cout << "Mean step: " << totalSeconds / static_cast<double>(stepCount) << "s" << std::endl;
+
+  deformer.apply(mesh);
+  if (!Io::writeSurfaceMesh(outputFilePath, mesh)) {
+    return;
+  }
+  std::cout << "Mesh deformed and is written to path (" << outputFilePath << ")" << std::endl;
+}
+
+} // namespace Deform
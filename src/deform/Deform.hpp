@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common/Mesh.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ceres {
+class Problem;
+} // namespace ceres
+
+namespace Deform {
+
+struct Options {
+  // local/global iterations per drag, a warm start is close so a few keep a drag at frame rate
+  int maxIterations = 10;
+
+  // Ceres iterations on the full energy after the local/global ones, 0 never builds the problem
+  int refineIterations = 0;
+
+  // Ceres residual evaluation and normal equations, 0 means one per hardware thread, the
+  // local/global iterations run on the global pool
+  size_t threadCount = 0;
+};
+
+// as-rigid-as-possible deformation of one mesh with a fixed set of anchors and handles, solved
+// with local/global iterations, the local step fits a rotation per vertex to its cotangent
+// weighted edges and the global step solves the Laplacian of the free vertices, which only
+// depends on the rest shape and which vertices are fixed so it is factored once at setup and a
+// drag only rewrites the handle positions and back substitutes, Ceres optionally refines the
+// result on the same energy
+class Deformer {
+public:
+  // anchors stay where they are and handles follow drag, the rest shape is copied from the mesh
+  Deformer(Mesh const &mesh, std::vector<Mesh::Vertex_index> const &anchors,
+           std::vector<Mesh::Vertex_index> const &handles, Options const &options = {});
+  ~Deformer();
+
+  // moves the handles to positions, in handle order, and solves, false if the system could not be
+  // factored or solved, in which case the previous solution is kept
+  bool drag(std::vector<Kernel::Point_3> const &positions);
+
+  [[nodiscard]] Kernel::Point_3 point(Mesh::Vertex_index v) const;
+
+  // writes the current solution into a mesh with the vertices of the source mesh
+  void apply(Mesh &mesh) const;
+
+  [[nodiscard]] int lastIterationCount() const { return mLastIterationCount; }
+
+private:
+  // the factored Laplacian and the per vertex state of the local/global iterations
+  struct System;
+
+  bool _refine();
+
+  Options mOptions;
+  std::vector<Mesh::Vertex_index> mHandles;
+
+  // xyz and an angle axis rotation per vertex index, the problem points into both so they are
+  // sized once and never reallocated
+  std::vector<double> mPositions;
+  std::vector<double> mRotations;
+
+  std::unique_ptr<System> mSystem;
+  std::unique_ptr<ceres::Problem> mProblem;
+  int mLastIterationCount = 0;
+};
+
+// the vertices with these indices, nullopt and a message if one is out of range or removed
+std::optional<std::vector<Mesh::Vertex_index>> findVertices(Mesh const &mesh,
+                                                            std::vector<size_t> const &indices);
+
+// moves the handles by offset in stepCount equal steps the way an interactive drag would, prints
+// the setup time and the time of each step and writes the result to the output folder
+void deform(std::string const &filename, std::vector<size_t> const &anchors,
+            std::vector<size_t> const &handles, Kernel::Vector_3 const &offset, size_t stepCount,
+            Options const &options = {});
+
+} // namespace Deform
@@ -0,0 +1,216 @@
+#include "Proxy.hpp"
+
+#include <CGAL/AABB_face_graph_triangle_primitive.h>
+#include <CGAL/AABB_traits.h>
+#include <CGAL/AABB_tree.h>
+
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/Timing.hpp"
+#include "io/Io.hpp"
+#include "io/SurfaceMeshIo.hpp"
+#include "mesh-simplification/MeshSimplification.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <optional>
+
+namespace {
+
+typedef Mesh::Vertex_index Vertex_index;
+typedef Mesh::Face_index Face_index;
+typedef CGAL::AABB_face_graph_triangle_primitive<Mesh> Primitive;
+typedef CGAL::AABB_traits<Kernel, Primitive> AabbTraits;
+typedef CGAL::AABB_tree<AabbTraits> AabbTree;
+
+// vertices per parallel task
+size_t constexpr kBlockSize = 4096;
+
+struct Triangle {
+  Kernel::Point_3 a;
+  Kernel::Vector_3 ab;
+  Kernel::Vector_3 ac;
+  // unit length, zero for a degenerate triangle
+  Kernel::Vector_3 normal;
+};
+
+Triangle _triangle(Mesh const &mesh, Face_index f) {
+  Mesh::Halfedge_index const h = mesh.halfedge(f);
+  Triangle triangle;
+  triangle.a               = mesh.point(mesh.source(h));
+  triangle.ab              = mesh.point(mesh.target(h)) - triangle.a;
+  triangle.ac              = mesh.point(mesh.target(mesh.next(h))) - triangle.a;
+  Kernel::Vector_3 const n = CGAL::cross_product(triangle.ab, triangle.ac);
+  double const length      = std::sqrt(n.squared_length());
+  triangle.normal          = length > 0.0 ? n / length : Kernel::Vector_3(0.0, 0.0, 0.0);
+  return triangle;
+}
+
+// barycentric coordinates are not clamped, a vertex whose closest point is on an edge projects
+// slightly outside and still comes back exactly
+Deform::Binding _bind(Kernel::Point_3 const &p, Face_index f, Triangle const &triangle) {
+  Deform::Binding binding;
+  binding.face = f;
+
+  Kernel::Vector_3 const ap = p - triangle.a;
+  binding.normalOffset      = ap * triangle.normal;
+
+  double const d00   = triangle.ab * triangle.ab;
+  double const d01   = triangle.ab * triangle.ac;
+  double const d11   = triangle.ac * triangle.ac;
+  double const d20   = ap * triangle.ab;
+  double const d21   = ap * triangle.ac;
+  double const denom = d00 * d11 - d01 * d01;
+  if (denom <= 0.0) {
+    // a degenerate triangle has no plane, pin to its first corner
+    binding.barycentric  = {1.0, 0.0, 0.0};
+    binding.normalOffset = 0.0;
+    return binding;
+  }
+  double const v      = (d11 * d20 - d01 * d21) / denom;
+  double const w      = (d00 * d21 - d01 * d20) / denom;
+  binding.barycentric = {1.0 - v - w, v, w};
+  return binding;
+}
+
+// the proxy vertex closest to each vertex, proxies are small enough for a linear scan
+std::vector<Vertex_index> _closestProxyVertices(Mesh const &mesh, Mesh const &proxy,
+                                                std::vector<Vertex_index> const &vertices) {
+  std::vector<Vertex_index> closest;
+  closest.reserve(vertices.size());
+  for (Vertex_index v : vertices) {
+    Vertex_index best   = Mesh::null_vertex();
+    double bestDistance = std::numeric_limits<double>::max();
+    for (Vertex_index candidate : proxy.vertices()) {
+      double const distance = CGAL::squared_distance(mesh.point(v), proxy.point(candidate));
+      if (distance < bestDistance) {
+        best         = candidate;
+        bestDistance = distance;
+      }
+    }
+    if (best != Mesh::null_vertex()) {
+      closest.push_back(best);
+    }
+  }
+  return closest;
+}
+
+} // namespace
+
+namespace Deform {
+
+std::vector<Binding> bindToProxy(Mesh const &mesh, Mesh const &proxy) {
+  Instrument::Zone zone("deform.bind");
+
+  std::vector<Binding> bindings(mesh.num_vertices(), Binding{Mesh::null_face(), {}, 0.0});
+
+  AabbTree tree(faces(proxy).first, faces(proxy).second, proxy);
+  // the binding loop below runs on the pool, the first closest point query would build the
+  // search tree lazily and that build is not safe to share, so build it before the loop
+  tree.accelerate_distance_queries();
+
+  std::vector<Vertex_index> const vertices(mesh.vertices().begin(), mesh.vertices().end());
+  size_t const blockCount = (vertices.size() + kBlockSize - 1) / kBlockSize;
+  ThreadPool::global().parallelFor(blockCount, [&](size_t block) {
+    size_t const end = std::min(vertices.size(), (block + 1) * kBlockSize);
+    for (size_t i = block * kBlockSize; i < end; i++) {
+      Kernel::Point_3 const &p = mesh.point(vertices[i]);
+      Face_index const f       = tree.closest_point_and_primitive(p).second;
+      bindings[vertices[i]]    = _bind(p, f, _triangle(proxy, f));
+    }
+  });
+  return bindings;
+}
+
+void transferDeformation(std::vector<Binding> const &bindings, Mesh const &deformedProxy,
+                         Mesh &mesh) {
+  Instrument::Zone zone("deform.transfer");
+
+  // every write goes to the vertex's own point
+  std::vector<Vertex_index> const vertices(mesh.vertices().begin(), mesh.vertices().end());
+  size_t const blockCount = (vertices.size() + kBlockSize - 1) / kBlockSize;
+  ThreadPool::global().parallelFor(blockCount, [&](size_t block) {
+    size_t const end = std::min(vertices.size(), (block + 1) * kBlockSize);
+    for (size_t i = block * kBlockSize; i < end; i++) {
+      Binding const &binding = bindings[vertices[i]];
+      if (binding.face == Mesh::null_face()) {
+        continue;
+      }
+      Triangle const triangle = _triangle(deformedProxy, binding.face);
+      mesh.point(vertices[i]) = triangle.a + binding.barycentric[1] * triangle.ab +
+                                binding.barycentric[2] * triangle.ac +
+                                binding.normalOffset * triangle.normal;
+    }
+  });
+}
+
+void deformProxy(std::string const &filename, size_t proxyFaceCount,
+                 std::vector<size_t> const &anchors, std::vector<size_t> const &handles,
+                 Kernel::Vector_3 const &offset, size_t stepCount, Options const &options) {
+  std::string const inputFilePath  = Io::makeFullInputPath(filename);
+  std::string const outputFilePath = Io::makeMeshOutputPath(filename);
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return;
+  }
+  Mesh &mesh = maybeMesh.value();
+
+  auto anchorVertices = findVertices(mesh, anchors);
+  auto handleVertices = findVertices(mesh, handles);
+  if (anchorVertices == std::nullopt || handleVertices == std::nullopt) {
+    return;
+  }
+
+  auto start = Timing::Clock::now();
+  Mesh proxy = mesh;
+  MeshSimplification::simplifyParallel(proxy, proxyFaceCount,
+                                       MeshSimplification::GarlandHeckbertPolicy::kClassicPlane, 0);
+  std::cout << "Proxy: " << num_faces(proxy) << " faces, " << Timing::secondsSince(start) << "s"
+            << std::endl;
+
+  start                               = Timing::Clock::now();
+  std::vector<Binding> const bindings = bindToProxy(mesh, proxy);
+  std::cout << "Binding: " << Timing::secondsSince(start) << "s" << std::endl;
+
+  std::vector<Vertex_index> const proxyHandles =
+      _closestProxyVertices(mesh, proxy, handleVertices.value());
+  std::vector<Vertex_index> const proxyAnchors =
+      _closestProxyVertices(mesh, proxy, anchorVertices.value());
+
+  start = Timing::Clock::now();
+  Deformer deformer(proxy, proxyAnchors, proxyHandles, options);
+  std::cout << "Setup: " << Timing::secondsSince(start) << "s" << std::endl;
+
+  stepCount           = std::max<size_t>(stepCount, 1);
+  double totalSeconds = 0.0;
+  std::vector<Kernel::Point_3> targets(proxyHandles.size());
+  for (size_t step = 1; step <= stepCount; step++) {
+    double const t = static_cast<double>(step) / static_cast<double>(stepCount);
+    for (size_t i = 0; i < targets.size(); i++) {
+      targets[i] = proxy.point(proxyHandles[i]) + t * offset;
+    }
+
+    start                = Timing::Clock::now();
+    bool const solved    = deformer.drag(targets);
+    double const seconds = Timing::secondsSince(start);
+    totalSeconds += seconds;
+    std::cout << "Step " << step << ": " << seconds << "s, " << deformer.lastIterationCount()
+              << " iterations" << (solved ? "" : ", failed") << std::endl;
+  }
+  std::cout << "Mean step: " << totalSeconds / static_cast<double>(stepCount) << "s" << std::endl;
+
+  start = Timing::Clock::now();
+  deformer.apply(proxy);
+  transferDeformation(bindings, proxy, mesh);
+  std::cout << "Transfer: " << Timing::secondsSince(start) << "s" << std::endl;
+
+  if (!Io::writeSurfaceMesh(outputFilePath, mesh)) {
+    return;
+  }
+  std::cout << "Mesh deformed and is written to path (" << outputFilePath << ")" << std::endl;
+}
+
+} // namespace Deform
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Deform.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace Deform {
+
+// where a full resolution vertex sits relative to a proxy triangle, the barycentric coordinates of
+// its projection on the triangle plane and the signed distance along the unit normal, exact at
+// rest and carried along when the triangle moves, rotates or stretches
+struct Binding {
+  Mesh::Face_index face;
+  std::array<double, 3> barycentric;
+  double normalOffset = 0.0;
+};
+
+// binds every vertex of mesh to the closest triangle of proxy, indexed by vertex, queries run in
+// parallel against an AABB tree of the proxy, removed vertices get a null face
+std::vector<Binding> bindToProxy(Mesh const &mesh, Mesh const &proxy);
+
+// moves every bound vertex of mesh to its binding on deformedProxy, which must be the proxy the
+// bindings were made against with only its points changed, one parallel pass over the vertices
+void transferDeformation(std::vector<Binding> const &bindings, Mesh const &deformedProxy,
+                         Mesh &mesh);
+
+// deform on a proxy simplified to proxyFaceCount, anchors and handles are full resolution vertices
+// and pin their closest proxy vertex, the drag cost follows the proxy size and only the final
+// transfer touches the full mesh
+void deformProxy(std::string const &filename, size_t proxyFaceCount,
+                 std::vector<size_t> const &anchors, std::vector<size_t> const &handles,
+                 Kernel::Vector_3 const &offset, size_t stepCount, Options const &options = {});
+
+} // namespace Deform
@@ -0,0 +1,273 @@
+#include "Intersection.hpp"
+
+#include <CGAL/Polygon_mesh_processing/self_intersections.h>
+
+#include "common/Instrument.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace PMP = CGAL::Polygon_mesh_processing;
+
+namespace {
+
+// a face over this many cells goes to the oversized list, one large face next to many small ones
+// would otherwise fill a cube of cells
+double constexpr kMaxCellsPerFace = 64.0;
+
+// 21 bits per axis, cells far apart may share a key which only costs a few box tests
+uint64_t _cellKey(int64_t x, int64_t y, int64_t z) {
+  uint64_t constexpr kMask = (uint64_t(1) << 21) - 1;
+  return (uint64_t(x) & kMask) | ((uint64_t(y) & kMask) << 21) | ((uint64_t(z) & kMask) << 42);
+}
+
+uint64_t _pairKey(uint32_t a, uint32_t b) {
+  return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+} // namespace
+
+namespace Intersection {
+
+Index::Index(Mesh const &mesh) : mMesh(&mesh) { _rebuild(); }
+
+// in doubles, the box of a far off face may span more cells than fit an integer
+double Index::_cellCount(CGAL::Bbox_3 const &box) const {
+  auto const span = [&](double lower, double upper) {
+    return std::floor(upper / mCellSize) - std::floor(lower / mCellSize) + 1.0;
+  };
+  return span(box.xmin(), box.xmax()) * span(box.ymin(), box.ymax()) *
+         span(box.zmin(), box.zmax());
+}
+
+template <typename Function>
+void Index::_forEachCell(CGAL::Bbox_3 const &box, Function &&function) const {
+  auto const cell = [&](double value) {
+    return static_cast<int64_t>(std::floor(value / mCellSize));
+  };
+  int64_t const x1 = cell(box.xmax());
+  int64_t const y1 = cell(box.ymax());
+  int64_t const z1 = cell(box.zmax());
+  for (int64_t x = cell(box.xmin()); x <= x1; x++) {
+    for (int64_t y = cell(box.ymin()); y <= y1; y++) {
+      for (int64_t z = cell(box.zmin()); z <= z1; z++) {
+        function(_cellKey(x, y, z));
+      }
+    }
+  }
+}
+
+void Index::markFace(Mesh::Face_index face) {
+  if (face != Mesh::null_face()) {
+    mDirtyFaces.push_back(static_cast<uint32_t>(face));
+  }
+}
+
+void Index::markVertex(Mesh::Vertex_index vertex) { mDirtyVertices.push_back(vertex); }
+
+void Index::markChangedFaces() {
+  Instrument::Zone zone("intersection.markChangedFaces");
+
+  size_t const capacity = mMesh->number_of_faces() + mMesh->number_of_removed_faces();
+  for (size_t i = 0; i < std::max(capacity, mEntries.size()); i++) {
+    FaceEntry current;
+    bool const live    = i < capacity && _readFace(Mesh::Face_index(i), current);
+    bool const indexed = i < mEntries.size() && mEntries[i].indexed;
+    if (live != indexed || (live && (current.vertices != mEntries[i].vertices ||
+                                     current.points != mEntries[i].points))) {
+      mDirtyFaces.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+size_t Index::update() {
+  Instrument::Zone zone("intersection.update");
+
+  // a vertex removed by a later collapse had its faces handed to the vertex that replaced it
+  for (Mesh::Vertex_index vertex : mDirtyVertices) {
+    if (mMesh->is_removed(vertex) || mMesh->halfedge(vertex) == Mesh::null_halfedge()) {
+      continue;
+    }
+    for (Mesh::Face_index face : mMesh->faces_around_target(mMesh->halfedge(vertex))) {
+      markFace(face);
+    }
+  }
+  mDirtyVertices.clear();
+
+  std::sort(mDirtyFaces.begin(), mDirtyFaces.end());
+  mDirtyFaces.erase(std::unique(mDirtyFaces.begin(), mDirtyFaces.end()), mDirtyFaces.end());
+
+  size_t const capacity = mMesh->number_of_faces() + mMesh->number_of_removed_faces();
+  if (mDirtyFaces.size() * 2 > mMesh->number_of_faces()) {
+    _rebuild();
+    return mPairs.size();
+  }
+  mLastTestedCount = 0;
+  if (mDirtyFaces.empty()) {
+    return mPairs.size();
+  }
+  if (mEntries.size() < capacity) {
+    mEntries.resize(capacity);
+  }
+
+  auto const isDirty = [&](uint32_t face) {
+    return std::binary_search(mDirtyFaces.begin(), mDirtyFaces.end(), face);
+  };
+  for (auto it = mPairs.begin(); it != mPairs.end();) {
+    if (isDirty(static_cast<uint32_t>(*it >> 32)) || isDirty(static_cast<uint32_t>(*it))) {
+      it = mPairs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  std::vector<Mesh::Face_index> tested;
+  std::unordered_set<uint32_t> seen;
+  for (uint32_t face : mDirtyFaces) {
+    if (mEntries[face].indexed) {
+      _erase(face);
+    }
+    if (face < capacity && _readFace(Mesh::Face_index(face), mEntries[face])) {
+      _insert(face);
+      tested.push_back(Mesh::Face_index(face));
+      seen.insert(face);
+    }
+  }
+
+  // the clean faces a changed face may now touch, pairs among them are known but get tested too
+  size_t const changedCount = tested.size();
+  for (size_t i = 0; i < changedCount; i++) {
+    CGAL::Bbox_3 const &box = mEntries[tested[i]].box;
+    auto const visit        = [&](uint32_t other) {
+      if (CGAL::do_overlap(box, mEntries[other].box) && seen.insert(other).second) {
+        tested.push_back(Mesh::Face_index(other));
+      }
+    };
+    if (mEntries[tested[i]].oversized) {
+      // is not in the grid, every face is looked at, rare enough to stay linear
+      for (uint32_t other = 0; other < mEntries.size(); other++) {
+        if (mEntries[other].indexed) {
+          visit(other);
+        }
+      }
+      continue;
+    }
+    _forEachCell(box, [&](uint64_t key) {
+      for (uint32_t other : mCells.find(key)->second) {
+        visit(other);
+      }
+    });
+    for (uint32_t other : mOversized) {
+      visit(other);
+    }
+  }
+
+  std::vector<FacePair> pairs;
+  PMP::self_intersections<CGAL::Parallel_if_available_tag>(tested, *mMesh,
+                                                            std::back_inserter(pairs));
+  for (FacePair const &pair : pairs) {
+    mPairs.insert(_pairKey(pair.first, pair.second));
+  }
+
+  Instrument::count("intersection.testedFaces", static_cast<int64_t>(tested.size()));
+  mLastTestedCount = tested.size();
+  mDirtyFaces.clear();
+  return mPairs.size();
+}
+
+std::vector<FacePair> Index::intersectingPairs() const {
+  std::vector<FacePair> pairs;
+  pairs.reserve(mPairs.size());
+  for (uint64_t key : mPairs) {
+    pairs.emplace_back(Mesh::Face_index(static_cast<uint32_t>(key >> 32)),
+                       Mesh::Face_index(static_cast<uint32_t>(key)));
+  }
+  std::sort(pairs.begin(), pairs.end());
+  return pairs;
+}
+
+void Index::_rebuild() {
+  Instrument::Zone zone("intersection.rebuild");
+
+  mCells.clear();
+  mOversized.clear();
+  mPairs.clear();
+  mDirtyFaces.clear();
+  mDirtyVertices.clear();
+  mEntries.assign(mMesh->number_of_faces() + mMesh->number_of_removed_faces(), FaceEntry{});
+
+  // cells twice the typical face, so most faces land in a handful of them
+  double extentSum = 0.0;
+  size_t faceCount = 0;
+  for (Mesh::Face_index face : mMesh->faces()) {
+    FaceEntry &entry = mEntries[face];
+    if (!_readFace(face, entry)) {
+      continue;
+    }
+    extentSum += std::max({entry.box.xmax() - entry.box.xmin(), entry.box.ymax() - entry.box.ymin(),
+                           entry.box.zmax() - entry.box.zmin()});
+    ++faceCount;
+  }
+  mCellSize = extentSum > 0.0 ? 2.0 * extentSum / faceCount : 1.0;
+
+  for (Mesh::Face_index face : mMesh->faces()) {
+    if (mMesh->degree(face) == 3) {
+      _insert(static_cast<uint32_t>(face));
+    }
+  }
+
+  std::vector<FacePair> pairs;
+  PMP::self_intersections<CGAL::Parallel_if_available_tag>(faces(*mMesh), *mMesh,
+                                                            std::back_inserter(pairs));
+  for (FacePair const &pair : pairs) {
+    mPairs.insert(_pairKey(pair.first, pair.second));
+  }
+  mLastTestedCount = faceCount;
+}
+
+bool Index::_readFace(Mesh::Face_index face, FaceEntry &entry) const {
+  if (mMesh->is_removed(face) || mMesh->degree(face) != 3) {
+    return false;
+  }
+  Mesh::Halfedge_index h = mMesh->halfedge(face);
+  for (size_t k = 0; k < 3; k++) {
+    entry.vertices[k] = mMesh->target(h);
+    entry.points[k]   = mMesh->point(entry.vertices[k]);
+    h                 = mMesh->next(h);
+  }
+  entry.box = entry.points[0].bbox() + entry.points[1].bbox() + entry.points[2].bbox();
+  return true;
+}
+
+void Index::_insert(uint32_t face) {
+  FaceEntry &entry = mEntries[face];
+  entry.indexed    = true;
+  entry.oversized  = _cellCount(entry.box) > kMaxCellsPerFace;
+  if (entry.oversized) {
+    mOversized.push_back(face);
+    return;
+  }
+  _forEachCell(entry.box, [&](uint64_t key) { mCells[key].push_back(face); });
+}
+
+void Index::_erase(uint32_t face) {
+  FaceEntry &entry = mEntries[face];
+  entry.indexed    = false;
+  if (entry.oversized) {
+    *std::find(mOversized.begin(), mOversized.end(), face) = mOversized.back();
+    mOversized.pop_back();
+    entry.oversized = false;
+    return;
+  }
+  _forEachCell(entry.box, [&](uint64_t key) {
+    auto cell                    = mCells.find(key);
+    std::vector<uint32_t> &faces = cell->second;
+    faces.erase(std::find(faces.begin(), faces.end(), face));
+    if (faces.empty()) {
+      mCells.erase(cell);
+    }
+  });
+}
+
+} // namespace Intersection
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "common/Mesh.hpp"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Intersection {
+
+typedef std::pair<Mesh::Face_index, Mesh::Face_index> FacePair;
+
+// the self-intersections of one mesh kept up to date across edits, face boxes live in a uniform
+// grid and the intersecting pairs found so far are remembered, so an update only tests the faces
+// that changed against the faces their boxes overlap, faces spanning too many cells stay out of
+// the grid in a list every update tests
+class Index {
+public:
+  // indexes every face and runs the first full check, the mesh has to outlive the index
+  explicit Index(Mesh const &mesh);
+
+  // a face that was created, removed or reshaped, removed faces leave the index on update
+  void markFace(Mesh::Face_index face);
+
+  // every face around the vertex changed shape, resolved on update so a vertex that a later
+  // collapse removes costs nothing
+  void markVertex(Mesh::Vertex_index vertex);
+
+  // compares every face with what the index saw last and marks the ones that differ, linear but
+  // far cheaper than testing, for edits that don't report what they touched
+  void markChangedFaces();
+
+  // retests the marked faces and returns the number of intersecting pairs, rebuilds from scratch
+  // when most of the mesh changed since the grid no longer fits the face sizes
+  size_t update();
+
+  [[nodiscard]] size_t intersectingPairCount() const { return mPairs.size(); }
+  [[nodiscard]] std::vector<FacePair> intersectingPairs() const;
+
+  // faces retested by the last update, the whole mesh after a rebuild
+  [[nodiscard]] size_t lastTestedFaceCount() const { return mLastTestedCount; }
+
+private:
+  // what the index saw of a face, the points catch moves that leave the box unchanged
+  struct FaceEntry {
+    CGAL::Bbox_3 box;
+    std::array<Mesh::Vertex_index, 3> vertices;
+    std::array<Kernel::Point_3, 3> points;
+    bool indexed   = false;
+    bool oversized = false;
+  };
+
+  void _rebuild();
+  bool _readFace(Mesh::Face_index face, FaceEntry &entry) const;
+  void _insert(uint32_t face);
+  void _erase(uint32_t face);
+  [[nodiscard]] double _cellCount(CGAL::Bbox_3 const &box) const;
+  template <typename Function>
+  void _forEachCell(CGAL::Bbox_3 const &box, Function &&function) const;
+
+  Mesh const *mMesh;
+
+  double mCellSize = 1.0;
+  std::vector<FaceEntry> mEntries;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> mCells;
+  std::vector<uint32_t> mOversized;
+
+  // both face indices packed in one key, smaller first
+  std::unordered_set<uint64_t> mPairs;
+
+  std::vector<uint32_t> mDirtyFaces;
+  std::vector<Mesh::Vertex_index> mDirtyVertices;
+  size_t mLastTestedCount = 0;
+};
+
+} // namespace Intersection
@@ -0,0 +1,508 @@
+#include "Compressed.hpp"
+
+#include "MappedFile.hpp"
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+uint32_t constexpr kCompressedVersion = 1;
+char constexpr kCompressedMagic[8]    = {'Q', 'M', 'S', 'H', 'M', 'E', 'S', 'H'};
+
+// vertices or triangles per block, a block is the unit of parallel work and of random access
+size_t constexpr kBlockSize = size_t{1} << 16;
+
+// order 0 byte rANS with 12 bit probabilities and a 32 bit state that spills a byte at a time
+uint32_t constexpr kProbabilityBits  = 12;
+uint32_t constexpr kProbabilityScale = uint32_t{1} << kProbabilityBits;
+uint32_t constexpr kStateLow         = uint32_t{1} << 23;
+
+// a block is its raw size, its mode and then either the raw bytes or the frequency table and the
+// rANS stream
+uint8_t constexpr kRawBlock          = 0;
+uint8_t constexpr kRansBlock         = 1;
+size_t constexpr kBlockHeaderSize    = sizeof(uint32_t) + sizeof(uint8_t);
+size_t constexpr kFrequencyTableSize = 256 * sizeof(uint16_t);
+// three varints of at most five bytes per vertex or triangle
+size_t constexpr kMaxRawBlockSize = 3 * 5 * kBlockSize;
+
+// the header is followed by blockCount + 1 offsets from the start of the file, vertex blocks
+// first, then face blocks, the last offset is the file size
+struct CompressedHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t positionBits;
+  uint64_t blockSize;
+  uint64_t vertexCount;
+  uint64_t faceCount;
+  double origin[3];
+  double step[3];
+};
+static_assert(sizeof(CompressedHeader) % 8 == 0);
+
+typedef std::array<uint32_t, 256> Frequencies;
+
+std::atomic<unsigned int> gPositionBits{16};
+
+size_t _blockCount(size_t itemCount) { return (itemCount + kBlockSize - 1) / kBlockSize; }
+
+// the fewest bytes a block of itemCount vertices or triangles takes, its three varints a byte each
+// stored raw, or a frequency table and the rANS state
+size_t _minBlockSize(size_t itemCount) {
+  return kBlockHeaderSize + std::min(3 * itemCount, kFrequencyTableSize + sizeof(uint32_t));
+}
+
+uint64_t _zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t _unzigzag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void _putVarint(std::vector<uint8_t> &bytes, uint64_t value) {
+  while (value >= 0x80) {
+    bytes.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  bytes.push_back(static_cast<uint8_t>(value));
+}
+
+bool _getVarint(uint8_t const *&p, uint8_t const *end, uint64_t &value) {
+  value = 0;
+  for (unsigned int shift = 0; p < end && shift < 64; shift += 7) {
+    uint8_t const byte = *p++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// scales the byte counts to kProbabilityScale, every byte that occurs keeps at least one slot
+Frequencies _normalize(Frequencies const &counts, size_t total) {
+  Frequencies frequencies{};
+  uint32_t sum = 0;
+  for (size_t s = 0; s < 256; s++) {
+    if (counts[s] != 0) {
+      uint64_t const scaled = uint64_t{counts[s]} * kProbabilityScale / total;
+      frequencies[s]        = std::max<uint32_t>(1, static_cast<uint32_t>(scaled));
+      sum += frequencies[s];
+    }
+  }
+  // rounding leaves the sum a little off, the most frequent byte absorbs the difference
+  while (sum != kProbabilityScale) {
+    auto largest = std::max_element(frequencies.begin(), frequencies.end());
+    if (sum > kProbabilityScale) {
+      (*largest)--;
+      sum--;
+    } else {
+      (*largest)++;
+      sum++;
+    }
+  }
+  return frequencies;
+}
+
+void _appendUint32(std::vector<uint8_t> &bytes, uint32_t value) {
+  for (size_t i = 0; i < 4; i++) {
+    bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+uint32_t _loadUint32(uint8_t const *p) {
+  return uint32_t{p[0]} | uint32_t{p[1]} << 8 | uint32_t{p[2]} << 16 | uint32_t{p[3]} << 24;
+}
+
+// falls back to the raw bytes when the table and the stream would not be smaller
+std::vector<uint8_t> _encodeBlock(std::vector<uint8_t> const &raw) {
+  std::vector<uint8_t> block;
+  _appendUint32(block, static_cast<uint32_t>(raw.size()));
+
+  std::vector<uint8_t> stream;
+  Frequencies frequencies{};
+  if (!raw.empty()) {
+    Frequencies counts{};
+    for (uint8_t byte : raw) {
+      counts[byte]++;
+    }
+    frequencies = _normalize(counts, raw.size());
+    Frequencies starts{};
+    for (size_t s = 1; s < 256; s++) {
+      starts[s] = starts[s - 1] + frequencies[s - 1];
+    }
+
+    // rANS is last in first out, the symbols go in backwards and the stream grows downwards, a
+    // symbol costs at most kProbabilityBits bits
+    stream.resize(2 * raw.size() + 8);
+    uint8_t *p = stream.data() + stream.size();
+    uint32_t x = kStateLow;
+    for (size_t i = raw.size(); i-- > 0;) {
+      uint32_t const frequency = frequencies[raw[i]];
+      uint32_t const limit     = ((kStateLow >> kProbabilityBits) << 8) * frequency;
+      while (x >= limit) {
+        *--p = static_cast<uint8_t>(x);
+        x >>= 8;
+      }
+      x = ((x / frequency) << kProbabilityBits) + x % frequency + starts[raw[i]];
+    }
+    for (size_t i = 4; i-- > 0;) {
+      *--p = static_cast<uint8_t>(x >> (8 * i));
+    }
+    stream.erase(stream.begin(), stream.begin() + (p - stream.data()));
+  }
+
+  if (raw.empty() || kFrequencyTableSize + stream.size() >= raw.size()) {
+    block.push_back(kRawBlock);
+    block.insert(block.end(), raw.begin(), raw.end());
+    return block;
+  }
+  block.push_back(kRansBlock);
+  for (uint32_t frequency : frequencies) {
+    block.push_back(static_cast<uint8_t>(frequency));
+    block.push_back(static_cast<uint8_t>(frequency >> 8));
+  }
+  block.insert(block.end(), stream.begin(), stream.end());
+  return block;
+}
+
+bool _decodeBlock(uint8_t const *p, uint8_t const *end, std::vector<uint8_t> &raw) {
+  if (static_cast<size_t>(end - p) < kBlockHeaderSize) {
+    return false;
+  }
+  uint32_t const rawSize = _loadUint32(p);
+  uint8_t const mode     = p[4];
+  p += kBlockHeaderSize;
+  if (rawSize > kMaxRawBlockSize) {
+    return false;
+  }
+  raw.resize(rawSize);
+
+  if (mode == kRawBlock) {
+    if (static_cast<size_t>(end - p) != raw.size()) {
+      return false;
+    }
+    std::copy(p, end, raw.begin());
+    return true;
+  }
+  if (mode != kRansBlock || static_cast<size_t>(end - p) < kFrequencyTableSize + 4) {
+    return false;
+  }
+
+  Frequencies frequencies{};
+  Frequencies starts{};
+  std::array<uint8_t, kProbabilityScale> symbols{};
+  uint32_t sum = 0;
+  for (size_t s = 0; s < 256; s++, p += 2) {
+    frequencies[s] = uint32_t{p[0]} | uint32_t{p[1]} << 8;
+    starts[s]      = sum;
+    if (sum + frequencies[s] > kProbabilityScale) {
+      return false;
+    }
+    std::fill_n(symbols.begin() + sum, frequencies[s], static_cast<uint8_t>(s));
+    sum += frequencies[s];
+  }
+  if (sum != kProbabilityScale) {
+    return false;
+  }
+
+  uint32_t x = _loadUint32(p);
+  p += 4;
+  for (uint8_t &byte : raw) {
+    uint32_t const slot = x & (kProbabilityScale - 1);
+    byte                = symbols[slot];
+    x                   = frequencies[byte] * (x >> kProbabilityBits) + slot - starts[byte];
+    while (x < kStateLow) {
+      if (p == end) {
+        return false;
+      }
+      x = (x << 8) | *p++;
+    }
+  }
+  // the encoder started from kStateLow, ending anywhere else means the stream is corrupt
+  return p == end && x == kStateLow;
+}
+
+struct Quantizer {
+  double origin[3];
+  double step[3];
+  uint32_t maxValue;
+
+  [[nodiscard]] uint32_t quantize(double value, size_t axis) const {
+    if (step[axis] == 0.0) {
+      return 0;
+    }
+    double const q = std::round((value - origin[axis]) / step[axis]);
+    return static_cast<uint32_t>(std::clamp(q, 0.0, static_cast<double>(maxValue)));
+  }
+};
+
+Quantizer _makeQuantizer(Io::MeshView const &view, unsigned int positionBits) {
+  Quantizer quantizer{};
+  quantizer.maxValue = static_cast<uint32_t>((uint64_t{1} << positionBits) - 1);
+  for (size_t axis = 0; axis < 3; axis++) {
+    double min = 0.0, max = 0.0;
+    for (size_t v = 0; v < view.vertexCount; v++) {
+      double const value = view.positions[3 * v + axis];
+      min                = v == 0 ? value : std::min(min, value);
+      max                = v == 0 ? value : std::max(max, value);
+    }
+    quantizer.origin[axis] = min;
+    quantizer.step[axis]   = (max - min) / quantizer.maxValue;
+  }
+  return quantizer;
+}
+
+// per axis deltas of the quantized positions from the previous vertex in the block
+std::vector<uint8_t> _packVertices(Io::MeshView const &view, Quantizer const &quantizer,
+                                   size_t begin, size_t end) {
+  std::vector<uint8_t> raw;
+  raw.reserve(3 * 3 * (end - begin));
+  uint32_t previous[3] = {0, 0, 0};
+  for (size_t v = begin; v < end; v++) {
+    for (size_t axis = 0; axis < 3; axis++) {
+      uint32_t const q = quantizer.quantize(view.positions[3 * v + axis], axis);
+      _putVarint(raw, _zigzag(int64_t{q} - int64_t{previous[axis]}));
+      previous[axis] = q;
+    }
+  }
+  return raw;
+}
+
+// the first corner as a delta from the first corner of the previous triangle, the other two as
+// deltas from the first, neighbouring triangles share vertices so the deltas stay small
+std::vector<uint8_t> _packTriangles(Io::MeshView const &view, size_t begin, size_t end) {
+  std::vector<uint8_t> raw;
+  raw.reserve(3 * 2 * (end - begin));
+  int64_t previous = 0;
+  for (size_t f = begin; f < end; f++) {
+    uint32_t const *corners = view.indices + view.faceOffsets[f];
+    int64_t const first     = corners[0];
+    _putVarint(raw, _zigzag(first - previous));
+    _putVarint(raw, _zigzag(int64_t{corners[1]} - first));
+    _putVarint(raw, _zigzag(int64_t{corners[2]} - first));
+    previous = first;
+  }
+  return raw;
+}
+
+bool _unpackVertices(std::vector<uint8_t> const &raw, CompressedHeader const &header,
+                     size_t begin, size_t end, Io::MeshBuffer &buffer) {
+  uint64_t const maxValue = (uint64_t{1} << header.positionBits) - 1;
+  uint8_t const *p        = raw.data();
+  uint8_t const *rawEnd   = raw.data() + raw.size();
+  int64_t previous[3]     = {0, 0, 0};
+  for (size_t v = begin; v < end; v++) {
+    for (size_t axis = 0; axis < 3; axis++) {
+      uint64_t value = 0;
+      if (!_getVarint(p, rawEnd, value)) {
+        return false;
+      }
+      previous[axis] += _unzigzag(value);
+      if (previous[axis] < 0 || static_cast<uint64_t>(previous[axis]) > maxValue) {
+        return false;
+      }
+      buffer.positions[3 * v + axis] =
+          header.origin[axis] + static_cast<double>(previous[axis]) * header.step[axis];
+    }
+  }
+  return p == rawEnd;
+}
+
+bool _unpackTriangles(std::vector<uint8_t> const &raw, CompressedHeader const &header,
+                      size_t begin, size_t end, Io::MeshBuffer &buffer) {
+  uint8_t const *p      = raw.data();
+  uint8_t const *rawEnd = raw.data() + raw.size();
+  int64_t previous      = 0;
+  for (size_t f = begin; f < end; f++) {
+    uint64_t values[3];
+    for (uint64_t &value : values) {
+      if (!_getVarint(p, rawEnd, value)) {
+        return false;
+      }
+    }
+    int64_t const first     = previous + _unzigzag(values[0]);
+    int64_t const corners[] = {first, first + _unzigzag(values[1]), first + _unzigzag(values[2])};
+    for (size_t c = 0; c < 3; c++) {
+      if (corners[c] < 0 || static_cast<uint64_t>(corners[c]) >= header.vertexCount) {
+        return false;
+      }
+      buffer.indices[3 * f + c] = static_cast<uint32_t>(corners[c]);
+    }
+    buffer.faceOffsets[f + 1] = static_cast<uint32_t>(3 * (f + 1));
+    previous                  = first;
+  }
+  return p == rawEnd;
+}
+
+} // namespace
+
+namespace Io {
+
+char const *const kCompressedExtension = ".qmsh";
+
+bool writeCompressed(std::string const &filePath, MeshView const &view, unsigned int positionBits) {
+  Instrument::Zone zone("io.writeCompressed");
+
+  if (positionBits < 1 || positionBits > 31) {
+    std::cerr << "Cannot quantize positions to " << positionBits << " bits" << std::endl;
+    return false;
+  }
+  for (size_t f = 0; f < view.faceCount; f++) {
+    if (view.faceOffsets[f + 1] - view.faceOffsets[f] != 3) {
+      std::cerr << "Cannot compress a mesh with non-triangular faces (" << filePath << ")"
+                << std::endl;
+      return false;
+    }
+  }
+
+  Quantizer const quantizer = _makeQuantizer(view, positionBits);
+  CompressedHeader header{};
+  std::memcpy(header.magic, kCompressedMagic, sizeof(kCompressedMagic));
+  header.version      = kCompressedVersion;
+  header.positionBits = positionBits;
+  header.blockSize    = kBlockSize;
+  header.vertexCount  = view.vertexCount;
+  header.faceCount    = view.faceCount;
+  std::copy(std::begin(quantizer.origin), std::end(quantizer.origin), header.origin);
+  std::copy(std::begin(quantizer.step), std::end(quantizer.step), header.step);
+
+  size_t const vertexBlockCount = _blockCount(view.vertexCount);
+  size_t const blockCount       = vertexBlockCount + _blockCount(view.faceCount);
+  std::vector<std::vector<uint8_t>> blocks(blockCount);
+  ThreadPool::global().parallelFor(blockCount, [&](size_t block) {
+    if (block < vertexBlockCount) {
+      size_t const begin = block * kBlockSize;
+      size_t const end   = std::min(view.vertexCount, begin + kBlockSize);
+      blocks[block]      = _encodeBlock(_packVertices(view, quantizer, begin, end));
+    } else {
+      size_t const begin = (block - vertexBlockCount) * kBlockSize;
+      size_t const end   = std::min(view.faceCount, begin + kBlockSize);
+      blocks[block]      = _encodeBlock(_packTriangles(view, begin, end));
+    }
+  });
+
+  std::vector<uint64_t> offsets(blockCount + 1);
+  offsets[0] = sizeof(CompressedHeader) + offsets.size() * sizeof(uint64_t);
+  for (size_t block = 0; block < blockCount; block++) {
+    offsets[block + 1] = offsets[block] + blocks[block].size();
+  }
+
+  std::FILE *file = std::fopen(filePath.c_str(), "wb");
+  if (file == nullptr) {
+    std::cerr << "Cannot open file (" << filePath << ")" << std::endl;
+    return false;
+  }
+  bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) ==
+                     offsets.size();
+  for (auto const &block : blocks) {
+    written = written && std::fwrite(block.data(), 1, block.size(), file) == block.size();
+  }
+  bool const closed = std::fclose(file) == 0;
+  if (!written || !closed) {
+    std::cerr << "Failed writing (" << filePath << ")" << std::endl;
+    return false;
+  }
+  Instrument::count("io.compressedBytesWritten", static_cast<int64_t>(offsets.back()));
+  return true;
+}
+
+bool readCompressed(std::string const &filePath, MeshBuffer &buffer) {
+  Instrument::Zone zone("io.readCompressed");
+  buffer.clear();
+
+  MappedFile file(filePath);
+  if (!file.isOpen()) {
+    std::cerr << "Cannot open file (" << filePath << ")" << std::endl;
+    return false;
+  }
+  Instrument::count("io.compressedBytesRead", static_cast<int64_t>(file.size()));
+
+  CompressedHeader header{};
+  if (file.size() >= sizeof(CompressedHeader)) {
+    std::memcpy(&header, file.data(), sizeof(CompressedHeader));
+  }
+  if (std::memcmp(header.magic, kCompressedMagic, sizeof(kCompressedMagic)) != 0 ||
+      header.version != kCompressedVersion || header.positionBits < 1 ||
+      header.positionBits > 31 || header.blockSize != kBlockSize ||
+      header.vertexCount > UINT32_MAX || header.faceCount > UINT32_MAX / 3) {
+    std::cerr << "Not a compressed mesh (" << filePath << ")" << std::endl;
+    return false;
+  }
+
+  // every block takes an offset and at least its own header, so the counts are held to what the
+  // file can hold before anything is sized from them, then each block to what its items need
+  size_t const vertexBlockCount = _blockCount(header.vertexCount);
+  size_t const blockCount       = vertexBlockCount + _blockCount(header.faceCount);
+  size_t const bodySize         = file.size() - sizeof(CompressedHeader);
+
+  bool valid = bodySize >= sizeof(uint64_t) &&
+               (bodySize - sizeof(uint64_t)) / (sizeof(uint64_t) + kBlockHeaderSize) >= blockCount;
+
+  std::vector<uint64_t> offsets;
+  if (valid) {
+    offsets.resize(blockCount + 1);
+    size_t const tableEnd = sizeof(CompressedHeader) + offsets.size() * sizeof(uint64_t);
+    std::memcpy(offsets.data(), file.data() + sizeof(CompressedHeader),
+                offsets.size() * sizeof(uint64_t));
+    valid = offsets.front() == tableEnd && offsets.back() == file.size() &&
+            std::is_sorted(offsets.begin(), offsets.end());
+    for (size_t block = 0; block < blockCount && valid; block++) {
+      bool const isVertexBlock = block < vertexBlockCount;
+      size_t const first       = (isVertexBlock ? block : block - vertexBlockCount) * kBlockSize;
+      size_t const total       = isVertexBlock ? header.vertexCount : header.faceCount;
+      size_t const itemCount   = std::min<size_t>(kBlockSize, total - first);
+      valid                    = offsets[block + 1] - offsets[block] >= _minBlockSize(itemCount);
+    }
+  }
+
+  if (valid) {
+    buffer.positions.resize(3 * header.vertexCount);
+    buffer.indices.resize(3 * header.faceCount);
+    buffer.faceOffsets.resize(header.faceCount + 1);
+
+    std::atomic<bool> failed{false};
+    auto const *data = reinterpret_cast<uint8_t const *>(file.data());
+    ThreadPool::global().parallelFor(blockCount, [&](size_t block) {
+      std::vector<uint8_t> raw;
+      bool ok = _decodeBlock(data + offsets[block], data + offsets[block + 1], raw);
+      if (ok && block < vertexBlockCount) {
+        size_t const begin = block * kBlockSize;
+        size_t const end   = std::min<size_t>(header.vertexCount, begin + kBlockSize);
+        ok                 = _unpackVertices(raw, header, begin, end, buffer);
+      } else if (ok) {
+        size_t const begin = (block - vertexBlockCount) * kBlockSize;
+        size_t const end   = std::min<size_t>(header.faceCount, begin + kBlockSize);
+        ok                 = _unpackTriangles(raw, header, begin, end, buffer);
+      }
+      if (!ok) {
+        failed = true;
+      }
+    });
+    valid = !failed;
+  }
+
+  if (!valid) {
+    std::cerr << "Malformed compressed mesh (" << filePath << ")" << std::endl;
+    buffer.clear();
+    return false;
+  }
+  return true;
+}
+
+void setCompressedPositionBits(unsigned int positionBits) { gPositionBits = positionBits; }
+unsigned int compressedPositionBits() { return gPositionBits; }
+
+} // namespace Io
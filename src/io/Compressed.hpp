@@ -0,0 +1,23 @@
+#pragma once
+
+#include "MeshBuffer.hpp"
+
+#include <string>
+
+namespace Io {
+
+// a compact triangle mesh file, positions quantized to positionBits per axis over the bounding
+// box, so a coordinate is off by at most half a step of extent / (2^positionBits - 1), vertices
+// and faces are cut into blocks that are delta coded, varint packed and rANS coded on their own,
+// so both writing and reading run one block per task
+extern char const *const kCompressedExtension;
+
+// positionBits in [1, 31], false for faces that are not triangles
+bool writeCompressed(std::string const &filePath, MeshView const &view, unsigned int positionBits);
+bool readCompressed(std::string const &filePath, MeshBuffer &buffer);
+
+// 16 by default, the bits writeSurfaceMesh quantizes to
+void setCompressedPositionBits(unsigned int positionBits);
+unsigned int compressedPositionBits();
+
+} // namespace Io
@@ -1,10 +1,54 @@
 #include "Io.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <random>
+
 namespace Io {
 std::string const kResourceFolderPrefix = "C:/Users/danny/Desktop/cgal-mesh-deform-test/resources/";
 std::string const kInputPrefix          = kResourceFolderPrefix + "input-models/out/";
 std::string const kOutputPrefix         = kResourceFolderPrefix + "output-models/";
 
+std::mutex gOutputMeshExtensionMutex;
+std::string gOutputMeshExtension;
+
+std::atomic<uint64_t> gTempCounter{0};
+
 std::string makeFullInputPath(std::string const &filename) { return kInputPrefix + filename; }
 std::string makeFullOutputPath(std::string const &filename) { return kOutputPrefix + filename; }
+
+std::string makeTempPath(std::string const &filePath) {
+  // random per process, so two processes sharing the folder never meet, the counter keeps the
+  // threads of one apart
+  static uint64_t const processToken =
+      (uint64_t{std::random_device{}()} << 32 | std::random_device{}()) ^
+      static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+  char suffix[48];
+  std::snprintf(suffix, sizeof(suffix), ".%016llx-%llu.tmp",
+                static_cast<unsigned long long>(processToken),
+                static_cast<unsigned long long>(gTempCounter++));
+  return filePath + suffix;
+}
+
+std::string makeMeshOutputPath(std::string const &filename) {
+  std::string const extension = outputMeshExtension();
+  if (extension.empty()) {
+    return makeFullOutputPath(filename);
+  }
+  return makeFullOutputPath(std::filesystem::path(filename).replace_extension(extension).string());
+}
+
+void setOutputMeshExtension(std::string const &extension) {
+  std::lock_guard<std::mutex> lock(gOutputMeshExtensionMutex);
+  gOutputMeshExtension = extension;
+}
+
+std::string outputMeshExtension() {
+  std::lock_guard<std::mutex> lock(gOutputMeshExtensionMutex);
+  return gOutputMeshExtension;
+}
 } // namespace Io
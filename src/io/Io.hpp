@@ -5,4 +5,16 @@
 namespace Io {
 std::string makeFullInputPath(std::string const &filename);
 std::string makeFullOutputPath(std::string const &filename);
-} // namespace Io
\ No newline at end of file
+
+// the output path of a mesh made from filename, in the format picked with setOutputMeshExtension
+std::string makeMeshOutputPath(std::string const &filename);
+
+// a sibling of filePath ending in .tmp that no other thread or process picks, for writing a file
+// that is then renamed into place
+std::string makeTempPath(std::string const &filePath);
+
+// ".obj", ".ply", ".qmsh" or anything CGAL writes, empty by default which keeps the extension of
+// the input
+void setOutputMeshExtension(std::string const &extension);
+std::string outputMeshExtension();
+} // namespace Io
@@ -0,0 +1,157 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <utility>
+
+namespace Io {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const &filePath) {
+  HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  mFileHandle = file;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    _close();
+    return;
+  }
+  mSize = static_cast<size_t>(fileSize.QuadPart);
+  mOpen = true;
+
+  // mapping an empty file fails, an open empty mapping is still valid
+  if (mSize == 0) {
+    return;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    _close();
+    return;
+  }
+  mMappingHandle = mapping;
+
+  mData = static_cast<char const *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (mData == nullptr) {
+    _close();
+  }
+}
+
+void MappedFile::_close() {
+  if (mData != nullptr) {
+    UnmapViewOfFile(mData);
+  }
+  if (mMappingHandle != nullptr) {
+    CloseHandle(mMappingHandle);
+  }
+  if (mFileHandle != nullptr) {
+    CloseHandle(mFileHandle);
+  }
+  mData          = nullptr;
+  mMappingHandle = nullptr;
+  mFileHandle    = nullptr;
+  mSize          = 0;
+  mOpen          = false;
+}
+
+void MappedFile::_steal(MappedFile &other) {
+  mOpen          = std::exchange(other.mOpen, false);
+  mData          = std::exchange(other.mData, nullptr);
+  mSize          = std::exchange(other.mSize, 0);
+  mFileHandle    = std::exchange(other.mFileHandle, nullptr);
+  mMappingHandle = std::exchange(other.mMappingHandle, nullptr);
+}
+
+void MappedFile::evict(size_t, size_t) const {}
+
+#else
+
+MappedFile::MappedFile(std::string const &filePath) {
+  int const fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+  if (fileDescriptor < 0) {
+    return;
+  }
+  mFileDescriptor = fileDescriptor;
+
+  struct stat fileStat {};
+  if (::fstat(fileDescriptor, &fileStat) != 0) {
+    _close();
+    return;
+  }
+  mSize = static_cast<size_t>(fileStat.st_size);
+  mOpen = true;
+
+  // mapping an empty file fails, an open empty mapping is still valid
+  if (mSize == 0) {
+    return;
+  }
+
+  void *mapped = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+  if (mapped == MAP_FAILED) {
+    _close();
+    return;
+  }
+  ::madvise(mapped, mSize, MADV_SEQUENTIAL);
+  mData = static_cast<char const *>(mapped);
+}
+
+void MappedFile::_close() {
+  if (mData != nullptr) {
+    ::munmap(const_cast<char *>(mData), mSize);
+  }
+  if (mFileDescriptor >= 0) {
+    ::close(mFileDescriptor);
+  }
+  mData           = nullptr;
+  mFileDescriptor = -1;
+  mSize           = 0;
+  mOpen           = false;
+}
+
+void MappedFile::_steal(MappedFile &other) {
+  mOpen           = std::exchange(other.mOpen, false);
+  mData           = std::exchange(other.mData, nullptr);
+  mSize           = std::exchange(other.mSize, 0);
+  mFileDescriptor = std::exchange(other.mFileDescriptor, -1);
+}
+
+void MappedFile::evict(size_t begin, size_t end) const {
+  size_t const pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  begin                 = (begin + pageSize - 1) / pageSize * pageSize;
+  end                   = std::min(end, mSize) / pageSize * pageSize;
+  if (mData != nullptr && begin < end) {
+    ::madvise(const_cast<char *>(mData) + begin, end - begin, MADV_DONTNEED);
+  }
+}
+
+#endif
+
+MappedFile::~MappedFile() { _close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { _steal(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    _close();
+    _steal(other);
+  }
+  return *this;
+}
+
+} // namespace Io
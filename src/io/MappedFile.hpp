@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Io {
+
+// read-only memory mapping of a whole file, the OS pages it in on demand
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(std::string const &filePath);
+  ~MappedFile();
+
+  MappedFile(MappedFile const &)            = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  [[nodiscard]] bool isOpen() const { return mOpen; }
+  [[nodiscard]] char const *data() const { return mData; }
+  [[nodiscard]] size_t size() const { return mSize; }
+
+  // drops the whole pages within [begin, end) from memory, touching them again reads them back
+  // from the file, keeps a single pass over a huge file from filling the page cache of the process,
+  // a no-op on Windows
+  void evict(size_t begin, size_t end) const;
+
+private:
+  void _close();
+  void _steal(MappedFile &other);
+
+  bool mOpen        = false;
+  char const *mData = nullptr;
+  size_t mSize      = 0;
+#ifdef _WIN32
+  void *mFileHandle    = nullptr;
+  void *mMappingHandle = nullptr;
+#else
+  int mFileDescriptor = -1;
+#endif
+};
+
+} // namespace Io
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Io {
+
+// non-owning view of an indexed polygon mesh laid out as flat arrays
+struct MeshView {
+  double const *positions     = nullptr; // xyz per vertex
+  size_t vertexCount          = 0;
+  uint32_t const *indices     = nullptr; // face corners, faces back to back
+  uint32_t const *faceOffsets = nullptr; // faceCount + 1 entries into indices
+  size_t faceCount            = 0;
+};
+
+// owning flat arrays, the in-memory form every reader and writer in Io goes through
+struct MeshBuffer {
+  std::vector<double> positions;
+  std::vector<uint32_t> indices;
+  std::vector<uint32_t> faceOffsets{0};
+
+  [[nodiscard]] size_t vertexCount() const { return positions.size() / 3; }
+  [[nodiscard]] size_t faceCount() const { return faceOffsets.size() - 1; }
+
+  [[nodiscard]] MeshView view() const {
+    MeshView view{};
+    view.positions   = positions.data();
+    view.vertexCount = vertexCount();
+    view.indices     = indices.data();
+    view.faceOffsets = faceOffsets.data();
+    view.faceCount   = faceCount();
+    return view;
+  }
+
+  void clear() {
+    positions.clear();
+    indices.clear();
+    faceOffsets.assign(1, 0);
+  }
+};
+
+} // namespace Io
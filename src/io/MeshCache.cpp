@@ -0,0 +1,223 @@
+#include "MeshCache.hpp"
+
+#include "Io.hpp"
+#include "Obj.hpp"
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+namespace {
+
+uint32_t constexpr kCacheVersion = 1;
+char constexpr kCacheMagic[8]    = {'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H'};
+
+// faces checked per parallel task when a cache is opened
+size_t constexpr kValidateBlockSize = size_t{1} << 16;
+
+// positions come right after the header and the padded source path, so the doubles stay aligned
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t pathLength;
+  uint64_t sourceSize;
+  int64_t sourceModifiedTime;
+  uint64_t vertexCount;
+  uint64_t faceCount;
+  uint64_t cornerCount;
+};
+static_assert(sizeof(CacheHeader) % 8 == 0);
+
+struct SourceStamp {
+  uint64_t size        = 0;
+  int64_t modifiedTime = 0;
+};
+
+std::atomic<bool> gCacheEnabled{true};
+
+size_t _paddedPathLength(size_t pathLength) { return (pathLength + 7) & ~size_t{7}; }
+
+// counts no file of this size could hold are rejected before they go into any arithmetic
+bool _countsFit(CacheHeader const &header, size_t fileSize) {
+  return header.vertexCount <= fileSize / (3 * sizeof(double)) &&
+         header.faceCount < fileSize / sizeof(uint32_t) &&
+         header.cornerCount <= fileSize / sizeof(uint32_t) && header.pathLength <= fileSize;
+}
+
+// offsets that only grow up to cornerCount and indices below vertexCount, what buildSurfaceMesh
+// relies on to stay inside the arrays
+bool _isConsistent(Io::MeshView const &view, uint64_t cornerCount) {
+  if (view.faceOffsets[0] != 0 || view.faceOffsets[view.faceCount] != cornerCount) {
+    return false;
+  }
+  std::atomic<bool> consistent{true};
+  size_t const blockCount = (view.faceCount + kValidateBlockSize - 1) / kValidateBlockSize;
+  ThreadPool::global().parallelFor(blockCount, [&](size_t block) {
+    size_t const end = std::min(view.faceCount, (block + 1) * kValidateBlockSize);
+    for (size_t f = block * kValidateBlockSize; f < end && consistent; f++) {
+      uint32_t const begin     = view.faceOffsets[f];
+      uint32_t const cornerEnd = view.faceOffsets[f + 1];
+      if (begin > cornerEnd || cornerEnd > cornerCount ||
+          std::any_of(view.indices + begin, view.indices + cornerEnd,
+                      [&view](uint32_t v) { return v >= view.vertexCount; })) {
+        consistent = false;
+      }
+    }
+  });
+  return consistent;
+}
+
+size_t _expectedFileSize(CacheHeader const &header) {
+  return sizeof(CacheHeader) + _paddedPathLength(header.pathLength) +
+         header.vertexCount * 3 * sizeof(double) + (header.faceCount + 1) * sizeof(uint32_t) +
+         header.cornerCount * sizeof(uint32_t);
+}
+
+bool _stampSource(std::string const &filePath, SourceStamp &stamp) {
+  std::error_code error;
+  auto const size = std::filesystem::file_size(filePath, error);
+  if (error) {
+    return false;
+  }
+  auto const modifiedTime = std::filesystem::last_write_time(filePath, error);
+  if (error) {
+    return false;
+  }
+  stamp.size         = size;
+  stamp.modifiedTime = modifiedTime.time_since_epoch().count();
+  return true;
+}
+
+// returns a view into the mapping when it holds a fresh cache of filePath
+bool _viewCache(Io::MappedFile const &mapping, std::string const &filePath,
+                SourceStamp const &stamp, Io::MeshView &view) {
+  if (mapping.size() < sizeof(CacheHeader)) {
+    return false;
+  }
+
+  CacheHeader header{};
+  std::memcpy(&header, mapping.data(), sizeof(CacheHeader));
+  if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+      header.version != kCacheVersion || header.sourceSize != stamp.size ||
+      header.sourceModifiedTime != stamp.modifiedTime || header.pathLength != filePath.size() ||
+      !_countsFit(header, mapping.size()) || mapping.size() != _expectedFileSize(header)) {
+    return false;
+  }
+
+  char const *cursor = mapping.data() + sizeof(CacheHeader);
+  if (std::memcmp(cursor, filePath.data(), filePath.size()) != 0) {
+    return false;
+  }
+  cursor += _paddedPathLength(header.pathLength);
+
+  view.vertexCount = header.vertexCount;
+  view.faceCount   = header.faceCount;
+  view.positions   = reinterpret_cast<double const *>(cursor);
+  cursor += header.vertexCount * 3 * sizeof(double);
+  view.faceOffsets = reinterpret_cast<uint32_t const *>(cursor);
+  cursor += (header.faceCount + 1) * sizeof(uint32_t);
+  view.indices = reinterpret_cast<uint32_t const *>(cursor);
+
+  // a sidecar that is corrupt or was tampered with is treated as stale and rebuilt
+  return _isConsistent(view, header.cornerCount);
+}
+
+bool _writeCache(std::string const &cachePath, std::string const &filePath,
+                 SourceStamp const &stamp, Io::MeshView const &view) {
+  CacheHeader header{};
+  std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.version            = kCacheVersion;
+  header.pathLength         = static_cast<uint32_t>(filePath.size());
+  header.sourceSize         = stamp.size;
+  header.sourceModifiedTime = stamp.modifiedTime;
+  header.vertexCount        = view.vertexCount;
+  header.faceCount          = view.faceCount;
+  header.cornerCount        = view.faceOffsets[view.faceCount];
+
+  // written next to the target and renamed over it, so a concurrent reader never maps half a
+  // file, under a name of its own so concurrent writers do not share the temporary either
+  std::string const tempPath = Io::makeTempPath(cachePath);
+  std::FILE *file            = std::fopen(tempPath.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  bool ok         = true;
+  auto writeBytes = [&ok, file](void const *data, size_t size) {
+    ok = ok && std::fwrite(data, 1, size, file) == size;
+  };
+
+  char const padding[8] = {};
+  writeBytes(&header, sizeof(header));
+  writeBytes(filePath.data(), filePath.size());
+  writeBytes(padding, _paddedPathLength(filePath.size()) - filePath.size());
+  writeBytes(view.positions, 3 * view.vertexCount * sizeof(double));
+  writeBytes(view.faceOffsets, (view.faceCount + 1) * sizeof(uint32_t));
+  writeBytes(view.indices, header.cornerCount * sizeof(uint32_t));
+
+  bool const closed = std::fclose(file) == 0;
+  ok                = ok && closed;
+
+  std::error_code error;
+  if (ok) {
+    std::filesystem::rename(tempPath, cachePath, error);
+  }
+  if (!ok || error) {
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+namespace Io {
+
+char const *const kMeshCacheExtension = ".meshcache";
+
+void setMeshCacheEnabled(bool enabled) { gCacheEnabled = enabled; }
+bool isMeshCacheEnabled() { return gCacheEnabled; }
+
+bool loadObjCached(std::string const &filePath, CachedMesh &mesh) {
+  Instrument::Zone zone("io.loadObjCached");
+  mesh.mMapping = MappedFile{};
+  mesh.mBuffer.clear();
+  mesh.mView = MeshView{};
+
+  SourceStamp stamp{};
+  if (!_stampSource(filePath, stamp)) {
+    std::cerr << "Cannot open file (" << filePath << ")" << std::endl;
+    return false;
+  }
+
+  std::string const cachePath = filePath + kMeshCacheExtension;
+
+  MappedFile mapping(cachePath);
+  if (mapping.isOpen() && _viewCache(mapping, filePath, stamp, mesh.mView)) {
+    mesh.mMapping = std::move(mapping);
+    Instrument::count("io.meshCacheHits", 1);
+    return true;
+  }
+  mapping = MappedFile{};
+  Instrument::count("io.meshCacheMisses", 1);
+
+  if (!readObj(filePath, mesh.mBuffer)) {
+    return false;
+  }
+  mesh.mView = mesh.mBuffer.view();
+
+  // a read-only input folder just means no cache, the parsed mesh is still good
+  if (!_writeCache(cachePath, filePath, stamp, mesh.mView)) {
+    std::cerr << "Cannot write mesh cache (" << cachePath << ")" << std::endl;
+  }
+  return true;
+}
+
+} // namespace Io
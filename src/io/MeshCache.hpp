@@ -0,0 +1,35 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "MeshBuffer.hpp"
+
+#include <string>
+
+namespace Io {
+
+// an OBJ loaded through its binary sidecar, the view points into the mapping on a cache hit and
+// into the freshly parsed buffer on a miss
+class CachedMesh {
+public:
+  [[nodiscard]] MeshView const &view() const { return mView; }
+  [[nodiscard]] bool fromCache() const { return mMapping.isOpen(); }
+
+private:
+  friend bool loadObjCached(std::string const &filePath, CachedMesh &mesh);
+
+  MappedFile mMapping;
+  MeshBuffer mBuffer;
+  MeshView mView{};
+};
+
+// the sidecar lives at filePath + kMeshCacheExtension and is keyed by the source path, size and
+// modification time, stale or corrupt sidecars are rebuilt from the OBJ
+extern char const *const kMeshCacheExtension;
+
+bool loadObjCached(std::string const &filePath, CachedMesh &mesh);
+
+// on by default, readSurfaceMesh goes through the cache for OBJ files when enabled
+void setMeshCacheEnabled(bool enabled);
+bool isMeshCacheEnabled();
+
+} // namespace Io
@@ -0,0 +1,429 @@
+#include "Obj.hpp"
+
+#include "MappedFile.hpp"
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+size_t constexpr kMinChunkBytes   = size_t{1} << 20;
+size_t constexpr kWriteBlockItems = size_t{1} << 16;
+
+struct Chunk {
+  char const *begin = nullptr;
+  char const *end   = nullptr;
+
+  size_t vertexCount = 0;
+  size_t faceCount   = 0;
+  size_t cornerCount = 0;
+
+  size_t vertexBase = 0;
+  size_t faceBase   = 0;
+  size_t cornerBase = 0;
+};
+
+enum class LineKind {
+  kOther,
+  kVertex,
+  kFace,
+};
+
+bool _isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+char const *_skipBlanks(char const *p, char const *end) {
+  while (p < end && _isBlank(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+char const *_skipToken(char const *p, char const *end) {
+  while (p < end && !_isBlank(*p) && *p != '\n') {
+    ++p;
+  }
+  return p;
+}
+
+char const *_lineEnd(char const *p, char const *end) {
+  auto const *newline = static_cast<char const *>(std::memchr(p, '\n', end - p));
+  return newline != nullptr ? newline : end;
+}
+
+char const *_nextLine(char const *lineEnd, char const *end) {
+  return lineEnd < end ? lineEnd + 1 : end;
+}
+
+// p points at the first non blank character of a line, returns the position after the keyword
+LineKind _classify(char const *&p, char const *lineEnd) {
+  if (lineEnd - p < 2 || !_isBlank(p[1])) {
+    return LineKind::kOther;
+  }
+  if (p[0] == 'v') {
+    p += 2;
+    return LineKind::kVertex;
+  }
+  if (p[0] == 'f') {
+    p += 2;
+    return LineKind::kFace;
+  }
+  return LineKind::kOther;
+}
+
+void _countChunk(Chunk &chunk) {
+  char const *p = chunk.begin;
+  while (p < chunk.end) {
+    char const *lineEnd = _lineEnd(p, chunk.end);
+    p                   = _skipBlanks(p, lineEnd);
+
+    LineKind const kind = _classify(p, lineEnd);
+    if (kind == LineKind::kVertex) {
+      ++chunk.vertexCount;
+    } else if (kind == LineKind::kFace) {
+      ++chunk.faceCount;
+      for (p = _skipBlanks(p, lineEnd); p < lineEnd; p = _skipBlanks(p, lineEnd)) {
+        p = _skipToken(p, lineEnd);
+        ++chunk.cornerCount;
+      }
+    }
+    p = _nextLine(lineEnd, chunk.end);
+  }
+}
+
+// from_chars ignores the locale, unlike strtod and iostreams
+char const *_parseDouble(char const *p, char const *end, double &value) {
+  p = _skipBlanks(p, end);
+  if (p < end && *p == '+') {
+    ++p;
+  }
+  auto const result = std::from_chars(p, end, value);
+  return result.ec == std::errc{} ? result.ptr : nullptr;
+}
+
+// only the position index of "v", "v/vt", "v//vn" or "v/vt/vn" is kept, negative indices are
+// relative to the vertexCount vertices read so far, returns the position after the corner
+char const *_parseCorner(char const *p, char const *lineEnd, size_t vertexCount,
+                         long long &resolved) {
+  long long index   = 0;
+  auto const result = std::from_chars(p, lineEnd, index);
+  if (result.ec != std::errc{} || index == 0) {
+    return nullptr;
+  }
+  resolved = index > 0 ? index - 1 : static_cast<long long>(vertexCount) + index;
+  if (resolved < 0) {
+    return nullptr;
+  }
+  return _skipToken(result.ptr, lineEnd);
+}
+
+bool _parseChunk(Chunk const &chunk, size_t totalVertexCount, Io::MeshBuffer &buffer) {
+  double *positions     = buffer.positions.data();
+  uint32_t *indices     = buffer.indices.data();
+  uint32_t *faceOffsets = buffer.faceOffsets.data();
+
+  size_t vertex = chunk.vertexBase;
+  size_t face   = chunk.faceBase;
+  size_t corner = chunk.cornerBase;
+
+  char const *p = chunk.begin;
+  while (p < chunk.end) {
+    char const *lineEnd = _lineEnd(p, chunk.end);
+    p                   = _skipBlanks(p, lineEnd);
+
+    LineKind const kind = _classify(p, lineEnd);
+    if (kind == LineKind::kVertex) {
+      for (int axis = 0; axis < 3; axis++) {
+        p = _parseDouble(p, lineEnd, positions[3 * vertex + axis]);
+        if (p == nullptr) {
+          return false;
+        }
+      }
+      ++vertex;
+    } else if (kind == LineKind::kFace) {
+      for (p = _skipBlanks(p, lineEnd); p < lineEnd; p = _skipBlanks(p, lineEnd)) {
+        long long resolved = 0;
+        p                  = _parseCorner(p, lineEnd, vertex, resolved);
+        if (p == nullptr || static_cast<size_t>(resolved) >= totalVertexCount) {
+          return false;
+        }
+        indices[corner++] = static_cast<uint32_t>(resolved);
+      }
+      faceOffsets[++face] = static_cast<uint32_t>(corner);
+    }
+    p = _nextLine(lineEnd, chunk.end);
+  }
+  return true;
+}
+
+std::vector<Chunk> _splitChunks(char const *data, size_t size, size_t maxChunkCount) {
+  size_t const chunkCount = std::clamp<size_t>(size / kMinChunkBytes, 1, maxChunkCount);
+
+  std::vector<Chunk> chunks;
+  chunks.reserve(chunkCount);
+  char const *begin     = data;
+  char const *const end = data + size;
+  for (size_t i = 1; i <= chunkCount && begin < end; i++) {
+    char const *split = i == chunkCount ? end : data + i * (size / chunkCount);
+    if (split <= begin) {
+      continue;
+    }
+    // chunks always end right after a newline so no line is shared
+    split = _nextLine(_lineEnd(split, end), end);
+
+    Chunk chunk{};
+    chunk.begin = begin;
+    chunk.end   = split;
+    chunks.push_back(chunk);
+    begin = split;
+  }
+  return chunks;
+}
+
+// collects formatted text in a large buffer and hands it to the file in big writes
+class BufferedWriter {
+public:
+  explicit BufferedWriter(std::FILE *file) : mFile(file) { mBuffer.reserve(kCapacity); }
+
+  void append(std::vector<char> const &text) {
+    if (mBuffer.size() + text.size() > kCapacity) {
+      flush();
+    }
+    if (text.size() > kCapacity) {
+      mOk = mOk && std::fwrite(text.data(), 1, text.size(), mFile) == text.size();
+      return;
+    }
+    mBuffer.insert(mBuffer.end(), text.begin(), text.end());
+  }
+
+  void flush() {
+    if (!mBuffer.empty()) {
+      mOk = mOk && std::fwrite(mBuffer.data(), 1, mBuffer.size(), mFile) == mBuffer.size();
+      mBuffer.clear();
+    }
+  }
+
+  [[nodiscard]] bool ok() const { return mOk; }
+
+private:
+  static size_t constexpr kCapacity = size_t{1} << 22;
+
+  std::FILE *mFile;
+  std::vector<char> mBuffer;
+  bool mOk = true;
+};
+
+void _formatVertices(Io::MeshView const &view, size_t begin, size_t end, std::vector<char> &text) {
+  // "v " + 3 * (24 digits + separator)
+  text.resize((end - begin) * 80);
+  char *out        = text.data();
+  char *const last = text.data() + text.size();
+  for (size_t v = begin; v < end; v++) {
+    *out++ = 'v';
+    for (int axis = 0; axis < 3; axis++) {
+      *out++ = ' ';
+      out    = std::to_chars(out, last, view.positions[3 * v + axis]).ptr;
+    }
+    *out++ = '\n';
+  }
+  text.resize(out - text.data());
+}
+
+void _formatFaces(Io::MeshView const &view, size_t begin, size_t end, std::vector<char> &text) {
+  size_t const cornerCount = view.faceOffsets[end] - view.faceOffsets[begin];
+  // "f" + "\n" per face, separator and up to 10 digits per corner
+  text.resize((end - begin) * 2 + cornerCount * 11);
+  char *out        = text.data();
+  char *const last = text.data() + text.size();
+  for (size_t f = begin; f < end; f++) {
+    *out++ = 'f';
+    for (uint32_t c = view.faceOffsets[f]; c < view.faceOffsets[f + 1]; c++) {
+      *out++ = ' ';
+      out    = std::to_chars(out, last, view.indices[c] + 1).ptr;
+    }
+    *out++ = '\n';
+  }
+  text.resize(out - text.data());
+}
+
+// formats rounds of blocks in parallel and appends them in order, which bounds the text in memory
+template <typename Format>
+void _writeBlocks(size_t itemCount, BufferedWriter &writer, Format &&format) {
+  ThreadPool &pool        = ThreadPool::global();
+  size_t const blockCount = (itemCount + kWriteBlockItems - 1) / kWriteBlockItems;
+  size_t const roundSize  = 2 * pool.getThreadCount();
+
+  std::vector<std::vector<char>> texts(roundSize);
+  for (size_t roundBegin = 0; roundBegin < blockCount; roundBegin += roundSize) {
+    size_t const roundEnd = std::min(roundBegin + roundSize, blockCount);
+    pool.parallelFor(roundEnd - roundBegin, [&](size_t i) {
+      size_t const block = roundBegin + i;
+      size_t const begin = block * kWriteBlockItems;
+      size_t const end   = std::min(begin + kWriteBlockItems, itemCount);
+      format(begin, end, texts[i]);
+    });
+    for (size_t i = 0; i < roundEnd - roundBegin; i++) {
+      writer.append(texts[i]);
+    }
+  }
+}
+
+} // namespace
+
+namespace Io {
+
+bool readObj(std::string const &filePath, MeshBuffer &buffer) {
+  Instrument::Zone zone("io.readObj");
+  buffer.clear();
+
+  MappedFile file(filePath);
+  if (!file.isOpen()) {
+    std::cerr << "Cannot open file (" << filePath << ")" << std::endl;
+    return false;
+  }
+  Instrument::count("io.objBytesRead", static_cast<int64_t>(file.size()));
+
+  ThreadPool &pool = ThreadPool::global();
+  std::vector<Chunk> chunks =
+      _splitChunks(file.data(), file.size(), 4 * pool.getThreadCount());
+
+  pool.parallelFor(chunks.size(), [&chunks](size_t i) { _countChunk(chunks[i]); });
+
+  // prefix sums give every chunk its own slice of the output arrays
+  size_t vertexCount = 0;
+  size_t faceCount   = 0;
+  size_t cornerCount = 0;
+  for (auto &chunk : chunks) {
+    chunk.vertexBase = vertexCount;
+    chunk.faceBase   = faceCount;
+    chunk.cornerBase = cornerCount;
+    vertexCount += chunk.vertexCount;
+    faceCount += chunk.faceCount;
+    cornerCount += chunk.cornerCount;
+  }
+  if (cornerCount > UINT32_MAX) {
+    std::cerr << "Too many face corners in (" << filePath << ")" << std::endl;
+    return false;
+  }
+
+  buffer.positions.resize(3 * vertexCount);
+  buffer.indices.resize(cornerCount);
+  buffer.faceOffsets.resize(faceCount + 1);
+  buffer.faceOffsets[0] = 0;
+
+  std::atomic<bool> failed{false};
+  pool.parallelFor(chunks.size(), [&](size_t i) {
+    if (!_parseChunk(chunks[i], vertexCount, buffer)) {
+      failed = true;
+    }
+  });
+
+  if (failed) {
+    std::cerr << "Malformed OBJ (" << filePath << ")" << std::endl;
+    buffer.clear();
+    return false;
+  }
+  return true;
+}
+
+bool streamObj(std::string const &filePath, size_t batchSize,
+               std::function<bool(MeshBuffer const &batch, size_t vertexBase)> const &onBatch) {
+  Instrument::Zone zone("io.streamObj");
+
+  MappedFile file(filePath);
+  if (!file.isOpen()) {
+    std::cerr << "Cannot open file (" << filePath << ")" << std::endl;
+    return false;
+  }
+  Instrument::count("io.objBytesRead", static_cast<int64_t>(file.size()));
+
+  MeshBuffer batch;
+  size_t vertexBase = 0;
+  auto const flush  = [&]() {
+    bool const ok = onBatch(batch, vertexBase);
+    vertexBase += batch.vertexCount();
+    batch.clear();
+    return ok;
+  };
+
+  char const *const begin = file.data();
+  char const *const end   = begin + file.size();
+  char const *evicted     = begin;
+  char const *p           = begin;
+  while (p < end) {
+    char const *lineEnd = _lineEnd(p, end);
+    p                   = _skipBlanks(p, lineEnd);
+
+    LineKind const kind = _classify(p, lineEnd);
+    if (kind == LineKind::kVertex) {
+      for (int axis = 0; axis < 3 && p != nullptr; axis++) {
+        p = _parseDouble(p, lineEnd, batch.positions.emplace_back());
+      }
+    } else if (kind == LineKind::kFace) {
+      size_t const vertexCount = vertexBase + batch.vertexCount();
+      for (p = _skipBlanks(p, lineEnd); p != nullptr && p < lineEnd;) {
+        long long resolved = 0;
+        p                  = _parseCorner(p, lineEnd, vertexCount, resolved);
+        if (p != nullptr) {
+          batch.indices.push_back(static_cast<uint32_t>(resolved));
+          p = _skipBlanks(p, lineEnd);
+        }
+      }
+      batch.faceOffsets.push_back(static_cast<uint32_t>(batch.indices.size()));
+    }
+    if (p == nullptr) {
+      std::cerr << "Malformed OBJ (" << filePath << ")" << std::endl;
+      return false;
+    }
+    p = _nextLine(lineEnd, end);
+
+    if (batch.vertexCount() >= batchSize || batch.faceCount() >= batchSize) {
+      if (!flush()) {
+        return false;
+      }
+      // everything before the cursor is parsed and handed out
+      file.evict(evicted - begin, p - begin);
+      evicted = p;
+    }
+  }
+  return flush();
+}
+
+bool writeObj(std::string const &filePath, MeshView const &view) {
+  Instrument::Zone zone("io.writeObj");
+  std::FILE *file = std::fopen(filePath.c_str(), "wb");
+  if (file == nullptr) {
+    std::cerr << "Cannot open file (" << filePath << ") for writing" << std::endl;
+    return false;
+  }
+  // our own buffer already batches the writes
+  std::setvbuf(file, nullptr, _IONBF, 0);
+
+  auto const formatVertices = [&view](size_t begin, size_t end, std::vector<char> &text) {
+    _formatVertices(view, begin, end, text);
+  };
+  auto const formatFaces = [&view](size_t begin, size_t end, std::vector<char> &text) {
+    _formatFaces(view, begin, end, text);
+  };
+
+  BufferedWriter writer(file);
+  _writeBlocks(view.vertexCount, writer, formatVertices);
+  _writeBlocks(view.faceCount, writer, formatFaces);
+  writer.flush();
+
+  bool const closed = std::fclose(file) == 0;
+  bool const ok     = writer.ok() && closed;
+  if (!ok) {
+    std::cerr << "Failed writing (" << filePath << ")" << std::endl;
+  }
+  return ok;
+}
+
+} // namespace Io
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "MeshBuffer.hpp"
+
+#include <functional>
+#include <string>
+
+namespace Io {
+
+// parses a Wavefront OBJ from a memory mapping, chunks are counted and then filled in parallel,
+// only positions and faces are kept
+bool readObj(std::string const &filePath, MeshBuffer &buffer);
+
+// walks an OBJ once in file order for inputs that do not fit in memory, onBatch receives the
+// positions and faces parsed since its last call, at most batchSize of either, with face indices
+// zero based over the whole file and vertexBase the index of the first position in the batch,
+// parsed pages are dropped from memory, false on malformed input or when onBatch returns false
+bool streamObj(std::string const &filePath, size_t batchSize,
+               std::function<bool(MeshBuffer const &batch, size_t vertexBase)> const &onBatch);
+
+// writes positions and faces with shortest round-trip float formatting
+bool writeObj(std::string const &filePath, MeshView const &view);
+
+} // namespace Io
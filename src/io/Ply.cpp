@@ -0,0 +1,308 @@
+#include "Ply.hpp"
+
+#include "MappedFile.hpp"
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// vertices or faces per parallel task
+size_t constexpr kBlockSize = size_t{1} << 16;
+
+char constexpr kEndHeader[] = "end_header";
+
+// where the fields sit in the binary body, like the mesh cache this assumes a little endian host
+struct Layout {
+  size_t vertexCount  = 0;
+  size_t vertexStride = 0;
+  size_t coordinateOffsets[3];
+  bool coordinateDoubles[3];
+
+  size_t faceCount     = 0;
+  size_t listCountSize = 0;
+  size_t listIndexSize = 0;
+  bool listIndexSigned = false;
+
+  size_t bodyOffset = 0;
+};
+
+// bytes of a PLY scalar type, 0 for an unknown one
+size_t _typeSize(std::string const &type) {
+  if (type == "char" || type == "uchar" || type == "int8" || type == "uint8") {
+    return 1;
+  } else if (type == "short" || type == "ushort" || type == "int16" || type == "uint16") {
+    return 2;
+  } else if (type == "int" || type == "uint" || type == "int32" || type == "uint32" ||
+             type == "float" || type == "float32") {
+    return 4;
+  } else if (type == "double" || type == "float64") {
+    return 8;
+  }
+  return 0;
+}
+
+bool _isSigned(std::string const &type) {
+  return type == "char" || type == "int8" || type == "short" || type == "int16" ||
+         type == "int" || type == "int32";
+}
+
+// nullopt for anything outside the layouts readPly takes
+std::optional<Layout> _parseHeader(char const *data, size_t size) {
+  char const *const headerEnd =
+      std::search(data, data + size, kEndHeader, kEndHeader + sizeof(kEndHeader) - 1);
+  char const *const bodyBegin = std::find(headerEnd, data + size, '\n');
+  if (bodyBegin == data + size) {
+    return std::nullopt;
+  }
+
+  Layout layout;
+  layout.bodyOffset = bodyBegin + 1 - data;
+  std::fill(std::begin(layout.coordinateOffsets), std::end(layout.coordinateOffsets), SIZE_MAX);
+
+  std::stringstream header(std::string(data, headerEnd));
+  std::string line;
+  // which element the properties belong to, 'v', 'f' or 0 for an empty one
+  char element     = 0;
+  bool sawFormat   = false;
+  bool sawFaceList = false;
+  bool sawFaces    = false;
+  for (size_t lineIndex = 0; std::getline(header, line); lineIndex++) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    std::stringstream words(line);
+    std::string keyword;
+    words >> keyword;
+    if (lineIndex == 0) {
+      if (keyword != "ply") {
+        return std::nullopt;
+      }
+    } else if (keyword == "format") {
+      std::string format, version;
+      words >> format >> version;
+      if (format != "binary_little_endian") {
+        return std::nullopt;
+      }
+      sawFormat = true;
+    } else if (keyword == "element") {
+      std::string name;
+      size_t count = 0;
+      words >> name >> count;
+      if (name == "vertex" && !sawFaces) {
+        element            = 'v';
+        layout.vertexCount = count;
+      } else if (name == "face") {
+        element          = 'f';
+        layout.faceCount = count;
+        sawFaces         = true;
+      } else if (count == 0) {
+        element = 0;
+      } else {
+        return std::nullopt;
+      }
+    } else if (keyword == "property") {
+      std::string type;
+      words >> type;
+      if (element == 'v') {
+        std::string name;
+        words >> name;
+        size_t const typeSize = _typeSize(type);
+        if (typeSize == 0) {
+          return std::nullopt;
+        }
+        if (name == "x" || name == "y" || name == "z") {
+          size_t const axis = name[0] - 'x';
+          if (typeSize != 4 && typeSize != 8) {
+            return std::nullopt;
+          }
+          layout.coordinateOffsets[axis] = layout.vertexStride;
+          layout.coordinateDoubles[axis] = typeSize == 8;
+        }
+        layout.vertexStride += typeSize;
+      } else if (element == 'f') {
+        std::string countType, indexType, name;
+        words >> countType >> indexType >> name;
+        if (type != "list" || sawFaceList ||
+            (name != "vertex_indices" && name != "vertex_index")) {
+          return std::nullopt;
+        }
+        layout.listCountSize   = _typeSize(countType);
+        layout.listIndexSize   = _typeSize(indexType);
+        layout.listIndexSigned = _isSigned(indexType);
+        if (layout.listCountSize == 0 || layout.listCountSize == 8 || layout.listIndexSize == 0 ||
+            layout.listIndexSize == 8) {
+          return std::nullopt;
+        }
+        sawFaceList = true;
+      }
+    }
+  }
+
+  bool const hasCoordinates =
+      std::none_of(std::begin(layout.coordinateOffsets), std::end(layout.coordinateOffsets),
+                   [](size_t offset) { return offset == SIZE_MAX; });
+  if (!sawFormat || !hasCoordinates || (layout.faceCount != 0 && !sawFaceList)) {
+    return std::nullopt;
+  }
+  return layout;
+}
+
+// little endian unsigned or sign extended integer of 1, 2 or 4 bytes
+int64_t _readInteger(char const *p, size_t size, bool isSigned) {
+  uint32_t value = 0;
+  std::memcpy(&value, p, size);
+  if (isSigned && size < 4 && (value >> (8 * size - 1)) != 0) {
+    value |= ~uint32_t{0} << (8 * size);
+  }
+  return isSigned ? static_cast<int64_t>(static_cast<int32_t>(value)) : value;
+}
+
+} // namespace
+
+namespace Io {
+
+bool readPly(std::string const &filePath, MeshBuffer &buffer) {
+  Instrument::Zone zone("io.readPly");
+
+  MappedFile file(filePath);
+  if (!file.isOpen()) {
+    return false;
+  }
+  auto layout = _parseHeader(file.data(), file.size());
+  if (layout == std::nullopt) {
+    return false;
+  }
+
+  char const *const end = file.data() + file.size();
+  char const *p         = file.data() + layout->bodyOffset;
+  if (static_cast<size_t>(end - p) / std::max<size_t>(layout->vertexStride, 1) <
+      layout->vertexCount) {
+    std::cerr << "Malformed PLY (" << filePath << ")" << std::endl;
+    return false;
+  }
+
+  buffer.clear();
+  buffer.positions.resize(3 * layout->vertexCount);
+  size_t const blockCount = (layout->vertexCount + kBlockSize - 1) / kBlockSize;
+  ThreadPool::global().parallelFor(blockCount, [&](size_t block) {
+    size_t const blockEnd = std::min(layout->vertexCount, (block + 1) * kBlockSize);
+    for (size_t v = block * kBlockSize; v < blockEnd; v++) {
+      char const *record = p + v * layout->vertexStride;
+      for (size_t axis = 0; axis < 3; axis++) {
+        char const *field = record + layout->coordinateOffsets[axis];
+        if (layout->coordinateDoubles[axis]) {
+          std::memcpy(&buffer.positions[3 * v + axis], field, sizeof(double));
+        } else {
+          float value;
+          std::memcpy(&value, field, sizeof(float));
+          buffer.positions[3 * v + axis] = value;
+        }
+      }
+    }
+  });
+  p += layout->vertexCount * layout->vertexStride;
+
+  // every face has at least its corner count, so the reserves below stay within the file
+  if (static_cast<size_t>(end - p) / std::max<size_t>(layout->listCountSize, 1) <
+      layout->faceCount) {
+    std::cerr << "Malformed PLY (" << filePath << ")" << std::endl;
+    buffer.clear();
+    return false;
+  }
+
+  // records differ in length, so the faces are walked in order
+  buffer.faceOffsets.reserve(layout->faceCount + 1);
+  buffer.indices.reserve(3 * layout->faceCount);
+  bool valid = true;
+  for (size_t f = 0; f < layout->faceCount && valid; f++) {
+    valid = static_cast<size_t>(end - p) >= layout->listCountSize;
+    if (!valid) {
+      break;
+    }
+    size_t const cornerCount = static_cast<size_t>(_readInteger(p, layout->listCountSize, false));
+    p += layout->listCountSize;
+    valid = static_cast<size_t>(end - p) / layout->listIndexSize >= cornerCount;
+    for (size_t c = 0; c < cornerCount && valid; c++, p += layout->listIndexSize) {
+      int64_t const index = _readInteger(p, layout->listIndexSize, layout->listIndexSigned);
+      valid               = index >= 0 && static_cast<size_t>(index) < layout->vertexCount;
+      buffer.indices.push_back(static_cast<uint32_t>(index));
+    }
+    buffer.faceOffsets.push_back(static_cast<uint32_t>(buffer.indices.size()));
+  }
+  if (!valid) {
+    std::cerr << "Malformed PLY (" << filePath << ")" << std::endl;
+    buffer.clear();
+    return false;
+  }
+
+  Instrument::count("io.plyBytesRead", static_cast<int64_t>(file.size()));
+  return true;
+}
+
+bool writePly(std::string const &filePath, MeshView const &view) {
+  Instrument::Zone zone("io.writePly");
+
+  std::stringstream header;
+  header << "ply\nformat binary_little_endian 1.0\nelement vertex " << view.vertexCount
+         << "\nproperty double x\nproperty double y\nproperty double z\nelement face "
+         << view.faceCount << "\nproperty list uchar uint vertex_indices\n" << kEndHeader << "\n";
+  std::string const headerText = header.str();
+
+  // a face is its count byte and four bytes per corner, so where it starts follows from the
+  // face offsets and the blocks can be filled side by side
+  size_t const cornerCount   = view.faceCount != 0 ? view.faceOffsets[view.faceCount] : 0;
+  size_t const positionBytes = 3 * sizeof(double) * view.vertexCount;
+  std::vector<char> body(positionBytes + view.faceCount + sizeof(uint32_t) * cornerCount);
+  if (view.vertexCount != 0) {
+    std::memcpy(body.data(), view.positions, positionBytes);
+  }
+
+  std::atomic<bool> valid{true};
+  size_t const blockCount = (view.faceCount + kBlockSize - 1) / kBlockSize;
+  ThreadPool::global().parallelFor(blockCount, [&](size_t block) {
+    size_t const blockEnd = std::min(view.faceCount, (block + 1) * kBlockSize);
+    for (size_t f = block * kBlockSize; f < blockEnd; f++) {
+      uint32_t const begin = view.faceOffsets[f];
+      uint32_t const count = view.faceOffsets[f + 1] - begin;
+      if (count > 255) {
+        valid = false;
+        return;
+      }
+      char *record = body.data() + positionBytes + f + sizeof(uint32_t) * begin;
+      *record      = static_cast<char>(count);
+      std::memcpy(record + 1, view.indices + begin, sizeof(uint32_t) * count);
+    }
+  });
+  if (!valid) {
+    std::cerr << "Cannot write a face of more than 255 corners (" << filePath << ")" << std::endl;
+    return false;
+  }
+
+  std::FILE *file = std::fopen(filePath.c_str(), "wb");
+  if (file == nullptr) {
+    std::cerr << "Cannot open file (" << filePath << ")" << std::endl;
+    return false;
+  }
+  bool const written = std::fwrite(headerText.data(), 1, headerText.size(), file) ==
+                           headerText.size() &&
+                       std::fwrite(body.data(), 1, body.size(), file) == body.size();
+  bool const closed = std::fclose(file) == 0;
+  if (!written || !closed) {
+    std::cerr << "Failed writing (" << filePath << ")" << std::endl;
+    return false;
+  }
+  Instrument::count("io.plyBytesWritten", static_cast<int64_t>(headerText.size() + body.size()));
+  return true;
+}
+
+} // namespace Io
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "MeshBuffer.hpp"
+
+#include <string>
+
+namespace Io {
+
+// binary little endian PLY, the layout writePly produces and the common ones of other tools,
+// float or double x y z among any other fixed size vertex properties and a face element with
+// only a vertex index list, a file in any other layout returns false without a message so the
+// caller can hand it to a general reader, a truncated or inconsistent one returns false with one
+bool readPly(std::string const &filePath, MeshBuffer &buffer);
+
+// double x y z and a uchar counted uint index list per face, the face records are laid out in
+// parallel blocks and the file goes out in one write
+bool writePly(std::string const &filePath, MeshView const &view);
+
+} // namespace Io
@@ -0,0 +1,272 @@
+#include "ResultCache.hpp"
+
+#include "Compressed.hpp"
+#include "Io.hpp"
+#include "MappedFile.hpp"
+#include "common/Instrument.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+// bumped whenever a change to the operations or the key would make old entries wrong
+char constexpr kKeyVersion[] = "result-cache-3";
+
+std::atomic<bool> gCacheEnabled{true};
+
+struct Hash128 {
+  uint64_t low  = 0;
+  uint64_t high = 0;
+};
+
+uint64_t _rotateLeft(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+// the final avalanche, every input bit flips each output bit with about even odds
+uint64_t _mix(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdull;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ull;
+  value ^= value >> 33;
+  return value;
+}
+
+// MurmurHash3 x64 128, a content address has to see every bit, a multiply only carries bits
+// upwards so a plain word wise FNV lets differences in the top bit of two words cancel, which
+// is exactly what negating two doubles does
+Hash128 _hash(char const *data, size_t size) {
+  uint64_t constexpr kC1 = 0x87c37b91114253d5ull;
+  uint64_t constexpr kC2 = 0x4cf5ad432745937full;
+
+  uint64_t h1             = 0;
+  uint64_t h2             = 0;
+  size_t const blockCount = size / 16;
+  for (size_t i = 0; i < blockCount; i++) {
+    uint64_t k1, k2;
+    std::memcpy(&k1, data + 16 * i, sizeof(uint64_t));
+    std::memcpy(&k2, data + 16 * i + 8, sizeof(uint64_t));
+
+    h1 ^= _rotateLeft(k1 * kC1, 31) * kC2;
+    h1 = (_rotateLeft(h1, 27) + h2) * 5 + 0x52dce729;
+    h2 ^= _rotateLeft(k2 * kC2, 33) * kC1;
+    h2 = (_rotateLeft(h2, 31) + h1) * 5 + 0x38495ab5;
+  }
+
+  auto const *tail  = reinterpret_cast<unsigned char const *>(data) + 16 * blockCount;
+  size_t const rest = size % 16;
+  uint64_t k1       = 0;
+  uint64_t k2       = 0;
+  for (size_t i = rest; i > 8; i--) {
+    k2 = (k2 << 8) | tail[i - 1];
+  }
+  for (size_t i = std::min<size_t>(rest, 8); i > 0; i--) {
+    k1 = (k1 << 8) | tail[i - 1];
+  }
+  if (rest > 8) {
+    h2 ^= _rotateLeft(k2 * kC2, 33) * kC1;
+  }
+  if (rest > 0) {
+    h1 ^= _rotateLeft(k1 * kC1, 31) * kC2;
+  }
+
+  h1 ^= size;
+  h2 ^= size;
+  h1 += h2;
+  h2 += h1;
+  h1 = _mix(h1);
+  h2 = _mix(h2);
+  h1 += h2;
+  h2 += h1;
+  return {h1, h2};
+}
+
+std::string _hex(uint64_t value) {
+  char text[17];
+  std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+  return text;
+}
+
+} // namespace
+
+namespace Io {
+
+ResultCache::ResultCache(std::string directory, uint64_t maxBytes)
+    : mDirectory(std::move(directory)), mMaxBytes(maxBytes) {}
+
+std::optional<std::string> ResultCache::key(std::string const &inputFilePath,
+                                            std::string const &operation) const {
+  Instrument::Zone zone("io.resultCacheKey");
+
+  std::error_code error;
+  if (std::filesystem::file_size(inputFilePath, error) == 0 || error) {
+    std::cerr << "Cannot open file (" << inputFilePath << ")" << std::endl;
+    return std::nullopt;
+  }
+  MappedFile mapping(inputFilePath);
+  if (!mapping.isOpen()) {
+    std::cerr << "Cannot open file (" << inputFilePath << ")" << std::endl;
+    return std::nullopt;
+  }
+
+  // the size rides along in the name, two inputs only share an entry if they also agree on it,
+  // the position bits change what a compressed output holds, so they count as part of the job
+  Hash128 const content = _hash(mapping.data(), mapping.size());
+  std::string const job = std::string(kKeyVersion) + "\n" + operation +
+                          "\nbits:" + std::to_string(compressedPositionBits());
+  Hash128 const jobHash = _hash(job.data(), job.size());
+  return _hex(content.high) + _hex(content.low) + "-" + _hex(mapping.size()) + "-" +
+         _hex(jobHash.high) + _hex(jobHash.low);
+}
+
+bool ResultCache::fetch(std::string const &key, std::string const &outputFilePath) {
+  Instrument::Zone zone("io.resultCacheFetch");
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  std::string const entryPath = _entryPath(key, outputFilePath);
+  std::error_code error;
+  if (!std::filesystem::is_regular_file(entryPath, error)) {
+    ++mStats.misses;
+    Instrument::count("io.resultCacheMisses", 1);
+    return false;
+  }
+
+  std::filesystem::remove(outputFilePath, error);
+  error.clear();
+  std::filesystem::create_hard_link(entryPath, outputFilePath, error);
+  if (error) {
+    error.clear();
+    std::filesystem::copy_file(entryPath, outputFilePath,
+                               std::filesystem::copy_options::overwrite_existing, error);
+  }
+  if (error) {
+    std::cerr << "Cannot link cached result (" << entryPath << ")" << std::endl;
+    ++mStats.misses;
+    Instrument::count("io.resultCacheMisses", 1);
+    return false;
+  }
+
+  // the modification time is the recency the eviction goes by
+  std::filesystem::last_write_time(entryPath, std::filesystem::file_time_type::clock::now(),
+                                   error);
+  ++mStats.hits;
+  Instrument::count("io.resultCacheHits", 1);
+  return true;
+}
+
+bool ResultCache::store(std::string const &key, std::string const &outputFilePath) {
+  Instrument::Zone zone("io.resultCacheStore");
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  std::error_code error;
+  std::filesystem::create_directories(mDirectory, error);
+
+  // linked or copied next to the entry and renamed over it, so a fetch never sees half a file
+  std::string const entryPath = _entryPath(key, outputFilePath);
+  std::string const tempPath  = makeTempPath(entryPath);
+  std::filesystem::create_hard_link(outputFilePath, tempPath, error);
+  if (error) {
+    error.clear();
+    std::filesystem::copy_file(outputFilePath, tempPath, error);
+  }
+  if (!error) {
+    std::filesystem::rename(tempPath, entryPath, error);
+  }
+  if (error) {
+    std::filesystem::remove(tempPath, error);
+    std::cerr << "Cannot store result (" << entryPath << ")" << std::endl;
+    return false;
+  }
+
+  ++mStats.stores;
+  _evict();
+  return true;
+}
+
+ResultCacheStats ResultCache::stats() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mStats;
+}
+
+ResultCache &ResultCache::global() {
+  static ResultCache cache(makeFullOutputPath(".result-cache"), uint64_t(4) << 30);
+  return cache;
+}
+
+std::string ResultCache::_entryPath(std::string const &key,
+                                    std::string const &outputFilePath) const {
+  // the output format follows the extension, so it is part of the entry
+  std::string const extension = std::filesystem::path(outputFilePath).extension().string();
+  return (std::filesystem::path(mDirectory) / (key + extension)).string();
+}
+
+void ResultCache::_evict() {
+  struct Entry {
+    std::filesystem::path path;
+    std::filesystem::file_time_type lastUse;
+    uint64_t size;
+  };
+
+  std::vector<Entry> entries;
+  uint64_t totalBytes = 0;
+  std::error_code error;
+  for (auto const &item : std::filesystem::directory_iterator(mDirectory, error)) {
+    std::error_code itemError;
+    if (!item.is_regular_file(itemError) || item.path().extension() == ".tmp") {
+      continue;
+    }
+    Entry entry{item.path(), item.last_write_time(itemError), item.file_size(itemError)};
+    if (itemError) {
+      continue;
+    }
+    totalBytes += entry.size;
+    entries.push_back(std::move(entry));
+  }
+  if (totalBytes <= mMaxBytes) {
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](Entry const &a, Entry const &b) { return a.lastUse < b.lastUse; });
+  for (Entry const &entry : entries) {
+    if (totalBytes <= mMaxBytes) {
+      break;
+    }
+    if (std::filesystem::remove(entry.path, error)) {
+      totalBytes -= entry.size;
+      ++mStats.evictions;
+      Instrument::count("io.resultCacheEvictions", 1);
+    }
+  }
+}
+
+bool fetchResult(std::string const &inputFilePath, std::string const &operation,
+                 std::string const &outputFilePath, std::optional<std::string> &key) {
+  key.reset();
+  if (!isResultCacheEnabled()) {
+    return false;
+  }
+  key = ResultCache::global().key(inputFilePath, operation);
+  if (key == std::nullopt || !ResultCache::global().fetch(key.value(), outputFilePath)) {
+    return false;
+  }
+  std::cout << "Result taken from the result cache (" << outputFilePath << ")" << std::endl;
+  return true;
+}
+
+void storeResult(std::optional<std::string> const &key, std::string const &outputFilePath) {
+  if (key != std::nullopt) {
+    ResultCache::global().store(key.value(), outputFilePath);
+  }
+}
+
+void setResultCacheEnabled(bool enabled) { gCacheEnabled = enabled; }
+bool isResultCacheEnabled() { return gCacheEnabled; }
+
+} // namespace Io
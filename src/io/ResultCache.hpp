@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace Io {
+
+struct ResultCacheStats {
+  size_t hits      = 0;
+  size_t misses    = 0;
+  size_t stores    = 0;
+  size_t evictions = 0;
+};
+
+// finished job outputs on disk, keyed by a 128-bit hash and the size of the input file bytes and
+// a description of the job, a hit hard links the stored file to the output path, copying when the
+// two live on different file systems, entries past maxBytes go least recently used first, an
+// entry's modification time is its last use so the order survives restarts
+class ResultCache {
+public:
+  ResultCache(std::string directory, uint64_t maxBytes);
+
+  // operation has to spell out every parameter that changes the output, nullopt if the input
+  // cannot be read
+  [[nodiscard]] std::optional<std::string> key(std::string const &inputFilePath,
+                                               std::string const &operation) const;
+
+  // puts the stored result at outputFilePath, false on a miss
+  bool fetch(std::string const &key, std::string const &outputFilePath);
+
+  // keeps outputFilePath under key and evicts down to maxBytes, outputs are always written to a
+  // fresh file so the shared link never sees a later write
+  bool store(std::string const &key, std::string const &outputFilePath);
+
+  [[nodiscard]] ResultCacheStats stats() const;
+
+  // lives in the output folder and holds up to 4 GiB
+  static ResultCache &global();
+
+private:
+  [[nodiscard]] std::string _entryPath(std::string const &key,
+                                       std::string const &outputFilePath) const;
+  void _evict();
+
+  std::string mDirectory;
+  uint64_t mMaxBytes;
+
+  mutable std::mutex mMutex;
+  ResultCacheStats mStats;
+};
+
+// what a command writing a mesh does before loading its input, true when the cached result is now
+// at outputFilePath, on a miss key is left for storeResult, it stays empty when the cache is off
+// or the input cannot be read
+bool fetchResult(std::string const &inputFilePath, std::string const &operation,
+                 std::string const &outputFilePath, std::optional<std::string> &key);
+
+// keeps the freshly written outputFilePath under key, nothing for an empty key
+void storeResult(std::optional<std::string> const &key, std::string const &outputFilePath);
+
+// on by default, the pipeline, the server and the sim, rem and rep commands check the result
+// cache before loading their input when enabled
+void setResultCacheEnabled(bool enabled);
+bool isResultCacheEnabled();
+
+} // namespace Io
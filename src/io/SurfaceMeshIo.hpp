@@ -0,0 +1,185 @@
+#pragma once
+
+// header only on purpose, the mesh type belongs to the including module and src-io itself does
+// not depend on CGAL
+
+#include <CGAL/Polygon_mesh_processing/IO/polygon_mesh_io.h>
+#include <CGAL/Polygon_mesh_processing/orient_polygon_soup.h>
+#include <CGAL/Polygon_mesh_processing/polygon_soup_to_polygon_mesh.h>
+#include <CGAL/Polygon_mesh_processing/repair_polygon_soup.h>
+#include <CGAL/Surface_mesh.h>
+
+#include "Compressed.hpp"
+#include "MeshBuffer.hpp"
+#include "MeshCache.hpp"
+#include "Obj.hpp"
+#include "Ply.hpp"
+#include "common/Instrument.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace Io {
+
+inline bool hasExtension(std::string const &filePath, std::string const &extension) {
+  return filePath.size() >= extension.size() &&
+         filePath.compare(filePath.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// fills mesh from flat arrays, reserving every element up front, inputs that are not a valid
+// polygon mesh go through the same soup repair as PMP::IO::read_polygon_mesh
+template <typename Mesh> bool buildSurfaceMesh(MeshView const &view, Mesh &mesh) {
+  Instrument::Zone zone("io.buildSurfaceMesh");
+
+  typedef typename Mesh::Point Point;
+  typedef typename Mesh::Vertex_index Vertex_index;
+
+  mesh.clear();
+  size_t const cornerCount = view.faceOffsets != nullptr ? view.faceOffsets[view.faceCount] : 0;
+  mesh.reserve(view.vertexCount, cornerCount / 2, view.faceCount);
+
+  std::vector<Vertex_index> vertices(view.vertexCount);
+  for (size_t v = 0; v < view.vertexCount; v++) {
+    double const *p = view.positions + 3 * v;
+    vertices[v]     = mesh.add_vertex(Point(p[0], p[1], p[2]));
+  }
+
+  bool valid = true;
+  std::vector<Vertex_index> faceVertices;
+  for (size_t f = 0; f < view.faceCount && valid; f++) {
+    faceVertices.clear();
+    for (uint32_t c = view.faceOffsets[f]; c < view.faceOffsets[f + 1]; c++) {
+      faceVertices.push_back(vertices[view.indices[c]]);
+    }
+    valid = mesh.add_face(faceVertices) != Mesh::null_face();
+  }
+  if (valid) {
+    return true;
+  }
+
+  namespace PMP = CGAL::Polygon_mesh_processing;
+
+  std::vector<Point> points;
+  points.reserve(view.vertexCount);
+  for (size_t v = 0; v < view.vertexCount; v++) {
+    double const *p = view.positions + 3 * v;
+    points.emplace_back(p[0], p[1], p[2]);
+  }
+  std::vector<std::vector<size_t>> polygons(view.faceCount);
+  for (size_t f = 0; f < view.faceCount; f++) {
+    polygons[f].assign(view.indices + view.faceOffsets[f], view.indices + view.faceOffsets[f + 1]);
+  }
+
+  mesh.clear();
+  PMP::repair_polygon_soup(points, polygons);
+  PMP::orient_polygon_soup(points, polygons);
+  PMP::polygon_soup_to_polygon_mesh(points, polygons, mesh);
+  return !mesh.is_empty();
+}
+
+// flattens mesh into buffer, skipping removed elements so it works on meshes with garbage
+template <typename Mesh> void extractMeshBuffer(Mesh const &mesh, MeshBuffer &buffer) {
+  Instrument::Zone zone("io.extractMeshBuffer");
+  buffer.clear();
+  buffer.positions.reserve(3 * mesh.number_of_vertices());
+  buffer.indices.reserve(3 * mesh.number_of_faces());
+  buffer.faceOffsets.reserve(mesh.number_of_faces() + 1);
+
+  std::vector<uint32_t> remap(mesh.num_vertices());
+  uint32_t next = 0;
+  for (auto v : mesh.vertices()) {
+    auto const &p = mesh.point(v);
+    buffer.positions.push_back(CGAL::to_double(p.x()));
+    buffer.positions.push_back(CGAL::to_double(p.y()));
+    buffer.positions.push_back(CGAL::to_double(p.z()));
+    remap[v] = next++;
+  }
+
+  for (auto f : mesh.faces()) {
+    for (auto v : vertices_around_face(mesh.halfedge(f), mesh)) {
+      buffer.indices.push_back(remap[v]);
+    }
+    buffer.faceOffsets.push_back(static_cast<uint32_t>(buffer.indices.size()));
+  }
+}
+
+// OBJ goes through the binary cache or the fast parser, binary PLY and the compressed format
+// through their own readers, anything else through CGAL
+template <typename Mesh> bool readSurfaceMesh(std::string const &filePath, Mesh &mesh) {
+  Instrument::Zone zone("io.readSurfaceMesh");
+  if (hasExtension(filePath, kCompressedExtension)) {
+    MeshBuffer buffer;
+    return readCompressed(filePath, buffer) && buildSurfaceMesh(buffer.view(), mesh);
+  }
+  if (hasExtension(filePath, ".ply")) {
+    // ASCII and unusual layouts are left to CGAL
+    MeshBuffer buffer;
+    if (readPly(filePath, buffer)) {
+      return buildSurfaceMesh(buffer.view(), mesh);
+    }
+    return CGAL::Polygon_mesh_processing::IO::read_polygon_mesh(filePath, mesh);
+  }
+  if (!hasExtension(filePath, ".obj")) {
+    return CGAL::Polygon_mesh_processing::IO::read_polygon_mesh(filePath, mesh);
+  }
+
+  if (isMeshCacheEnabled()) {
+    CachedMesh cached;
+    if (!loadObjCached(filePath, cached)) {
+      return false;
+    }
+    return buildSurfaceMesh(cached.view(), mesh);
+  }
+
+  MeshBuffer buffer;
+  if (!readObj(filePath, buffer)) {
+    return false;
+  }
+  return buildSurfaceMesh(buffer.view(), mesh);
+}
+
+// reads and validates a triangle mesh, the mesh is built inside the optional and moved out
+template <typename Mesh> std::optional<Mesh> loadTriangleMesh(std::string const &filePath) {
+  std::cout << "Loading mesh from path (" << filePath << ")..." << std::endl;
+
+  std::optional<Mesh> mesh(std::in_place);
+  if (!readSurfaceMesh(filePath, *mesh)) {
+    std::cerr << "Cannot read polygon mesh" << std::endl;
+    return std::nullopt;
+  }
+  if (!CGAL::is_triangle_mesh(*mesh)) {
+    std::cerr << "Input geometry is not triangulated." << std::endl;
+    return std::nullopt;
+  }
+
+  std::cout << "Faces: " << num_faces(*mesh) << std::endl;
+  return mesh;
+}
+
+template <typename Mesh> bool writeSurfaceMesh(std::string const &filePath, Mesh const &mesh) {
+  Instrument::Zone zone("io.writeSurfaceMesh");
+  // a fresh file every time, the old one may be a hard link into the result cache
+  std::error_code error;
+  std::filesystem::remove(filePath, error);
+
+  bool const isCompressed = hasExtension(filePath, kCompressedExtension);
+  bool const isPly        = hasExtension(filePath, ".ply");
+  if (!isCompressed && !isPly && !hasExtension(filePath, ".obj")) {
+    return CGAL::IO::write_polygon_mesh(filePath, mesh, CGAL::parameters::stream_precision(17));
+  }
+
+  MeshBuffer buffer;
+  extractMeshBuffer(mesh, buffer);
+  if (isCompressed) {
+    return writeCompressed(filePath, buffer.view(), compressedPositionBits());
+  } else if (isPly) {
+    return writePly(filePath, buffer.view());
+  }
+  return writeObj(filePath, buffer.view());
+}
+
+} // namespace Io
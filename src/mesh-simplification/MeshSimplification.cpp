@@ -1,114 +1,726 @@
 #include "MeshSimplification.hpp"
 
-#include <CGAL/Simple_cartesian.h>
-#include <CGAL/Surface_mesh.h>
+#include <CGAL/Polygon_mesh_processing/bbox.h>
+#include <CGAL/Polygon_mesh_processing/distance.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Bounded_distance_placement.h>
 #include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Bounded_normal_change_placement.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Constrained_placement.h>
 #include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Face_count_stop_predicate.h>
 #include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/GarlandHeckbert_policies.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/LindstromTurk_placement.h>
+#include <CGAL/Surface_mesh_simplification/Edge_collapse_visitor_base.h>
 #include <CGAL/Surface_mesh_simplification/edge_collapse.h>
+#include <CGAL/boost/graph/Euler_operations.h>
 
+#include "common/Instrument.hpp"
+#include "common/Memory.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/Timing.hpp"
 #include "common/defines.hpp"
+#include "intersection/Intersection.hpp"
 #include "io/Io.hpp"
+#include "io/ResultCache.hpp"
+#include "io/SurfaceMeshIo.hpp"
+#include "partition/Partition.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <limits>
 #include <iostream>
 #include <optional>
-
-typedef CGAL::Simple_cartesian<double> Kernel;
-typedef CGAL::Surface_mesh<Kernel::Point_3> Mesh;
+#include <sstream>
+#include <thread>
+#include <type_traits>
 
 namespace SMS = CGAL::Surface_mesh_simplification;
 
-typedef SMS::GarlandHeckbert_plane_policies<Mesh, Kernel> Classic_plane;
-typedef SMS::GarlandHeckbert_probabilistic_plane_policies<Mesh, Kernel> Prob_plane;
-typedef SMS::GarlandHeckbert_triangle_policies<Mesh, Kernel> Classic_tri;
-typedef SMS::GarlandHeckbert_probabilistic_triangle_policies<Mesh, Kernel> Prob_tri;
-
-template <typename GHPolicies> void collapse_gh(Mesh &mesh, size_t outputFaceCount) {}
+// the policies always compute in Kernel, a CompactMesh hands them its points through
+// CompactPointMap
+template <typename MeshT> using Classic_plane = SMS::GarlandHeckbert_plane_policies<MeshT, Kernel>;
+template <typename MeshT>
+using Prob_plane = SMS::GarlandHeckbert_probabilistic_plane_policies<MeshT, Kernel>;
+template <typename MeshT> using Classic_tri = SMS::GarlandHeckbert_triangle_policies<MeshT, Kernel>;
+template <typename MeshT>
+using Prob_tri = SMS::GarlandHeckbert_probabilistic_triangle_policies<MeshT, Kernel>;
 
 namespace {
 
-std::optional<Mesh> _readMesh(const std::string &filePath) {
-  std::cout << "Loading mesh from path (" << filePath << ")..." << std::endl;
+// hands the mesh to onLod each time the face count reaches the next target, targets descending
+struct LodRecorder {
+  std::vector<size_t> faceCounts;
+  size_t nextTarget                                        = 0;
+  std::function<void(size_t, Mesh const &)> const *onLod   = nullptr;
+  std::vector<MeshSimplification::CollapseRecord> *records = nullptr;
+};
 
-  Mesh mesh;
-  if (!CGAL::IO::read_polygon_mesh(filePath, mesh)) {
-    std::cerr << "Cannot read polygon mesh" << std::endl;
-    return std::nullopt;
+// who else wants to hear about the collapses besides Instrument
+struct CollapseObservers {
+  Intersection::Index *index = nullptr;
+  LodRecorder *lods          = nullptr;
+};
+
+// counts collapses, rejections and placement failures locally and reports them to Instrument once
+// the collapse finishes, the remaining edge count is sampled as a proxy for the queue size, with an
+// index the two faces of every collapsed edge and the faces around the kept vertex are marked, with
+// a LOD recorder every collapse is recorded and the targets it crosses are handed out, observers
+// only follow a Mesh
+template <typename MeshT> class CollapseVisitor : public SMS::Edge_collapse_visitor_base<MeshT> {
+public:
+  explicit CollapseVisitor(CollapseObservers observers) : mObservers(observers) {}
+
+  void OnStarted(MeshT &) {
+    if (mEnabled) {
+      mStart = Instrument::Clock::now();
+    }
   }
-  if (!CGAL::is_triangle_mesh(mesh)) {
-    std::cerr << "Input geometry is not triangulated." << std::endl;
-    return std::nullopt;
+
+  template <typename Profile, typename Cost> void OnCollected(Profile const &, Cost const &) {
+    ++mCollected;
+  }
+
+  template <typename Profile, typename Cost, typename Size>
+  void OnSelected(Profile const &, Cost const &, Size, Size currentEdgeCount) {
+    if (mEnabled && (++mSelected % kSampleInterval) == 0) {
+      Instrument::recordValue("sms.remainingEdges", static_cast<double>(currentEdgeCount));
+    }
+  }
+
+  // an empty placement means the placement policy refused the edge
+  template <typename Profile, typename Placement>
+  void OnCollapsing(Profile const &profile, Placement const &placement) {
+    if (!placement) {
+      ++mPlacementFailures;
+    } else if constexpr (kObserved) {
+      if (mObservers.index != nullptr) {
+        mObservers.index->markFace(profile.surface_mesh().face(profile.v0_v1()));
+        mObservers.index->markFace(profile.surface_mesh().face(profile.v1_v0()));
+      }
+    }
+  }
+
+  template <typename Profile> void OnNonCollapsable(Profile const &) { ++mNonCollapsable; }
+
+  template <typename Profile, typename Vertex>
+  void OnCollapsed(Profile const &profile, Vertex const &vertex) {
+    ++mCollapsed;
+    if constexpr (kObserved) {
+      if (mObservers.index != nullptr) {
+        mObservers.index->markVertex(vertex);
+      }
+      if (mObservers.lods != nullptr) {
+        _recordLod(*mObservers.lods, profile.surface_mesh(),
+                   vertex == profile.v0() ? profile.v1() : profile.v0(), vertex);
+      }
+    }
+  }
+
+  void OnFinished(MeshT &) {
+    if (!mEnabled) {
+      return;
+    }
+    std::chrono::duration<double> const elapsed = Instrument::Clock::now() - mStart;
+    Instrument::count("sms.collected", mCollected);
+    Instrument::count("sms.collapsed", mCollapsed);
+    Instrument::count("sms.nonCollapsable", mNonCollapsable);
+    Instrument::count("sms.placementFailures", mPlacementFailures);
+    Instrument::recordValue("sms.collapsesPerSecond", mCollapsed / elapsed.count());
+  }
+
+private:
+  static int64_t constexpr kSampleInterval = 4096;
+  static bool constexpr kObserved           = std::is_same_v<MeshT, Mesh>;
+
+  static void _recordLod(LodRecorder &lods, Mesh const &mesh, Mesh::Vertex_index removed,
+                         Mesh::Vertex_index kept) {
+    if (lods.records != nullptr) {
+      Kernel::Point_3 const &point = mesh.point(kept);
+      lods.records->push_back({static_cast<uint32_t>(removed), static_cast<uint32_t>(kept),
+                               point.x(), point.y(), point.z()});
+    }
+    while (lods.nextTarget < lods.faceCounts.size() &&
+           mesh.number_of_faces() <= lods.faceCounts[lods.nextTarget]) {
+      (*lods.onLod)(lods.faceCounts[lods.nextTarget++], mesh);
+    }
+  }
+
+  CollapseObservers mObservers;
+  bool mEnabled = Instrument::isEnabled();
+  Instrument::Clock::time_point mStart;
+  int64_t mCollected         = 0;
+  int64_t mSelected          = 0;
+  int64_t mCollapsed         = 0;
+  int64_t mNonCollapsable    = 0;
+  int64_t mPlacementFailures = 0;
+};
+
+// the collapse reads and writes the points through these, so either mesh gets Kernel points
+Mesh::Property_map<Mesh::Vertex_index, Kernel::Point_3> _pointMap(Mesh &mesh) {
+  return mesh.points();
+}
+
+CompactPointMap _pointMap(CompactMesh &mesh) { return CompactPointMap{&mesh}; }
+
+// stops at outputFaceCount faces or at the first edge costing more than maxCost, the queue hands
+// out the cheapest edge first so no later edge would cost less
+template <typename MeshT> class BoundedCostStopPredicate {
+public:
+  BoundedCostStopPredicate(size_t outputFaceCount, double maxCost)
+      : mFaceCount(outputFaceCount), mMaxCost(maxCost) {}
+
+  template <typename FT, typename Profile>
+  bool operator()(FT const &cost, Profile const &profile, size_t initialEdgeCount,
+                  size_t currentEdgeCount) const {
+    return cost > mMaxCost || mFaceCount(cost, profile, initialEdgeCount, currentEdgeCount);
   }
 
-  std::cout << "Faces: " << num_faces(mesh) << std::endl;
-  return std::optional<Mesh>(mesh);
+private:
+  SMS::Face_count_stop_predicate<MeshT> mFaceCount;
+  double mMaxCost;
+};
+
+// a Garland-Heckbert cost is a sum of squared distances to the input planes merged into the
+// vertex, so its root bounds how far the collapse moved the surface, 0 means no bound
+double _maxCost(double maxError) {
+  return maxError > 0.0 ? maxError * maxError : std::numeric_limits<double>::infinity();
+}
+
+// every policy and bound combination is its own instantiation, kLocked keeps border edges and
+// their vertices in place so a patch still fits its neighbours afterwards, a positive maxError
+// stops on the cost and on a Mesh also rejects placements further than maxError from the input
+template <typename GHPolicies, bool kBounded, bool kLocked, typename MeshT>
+void _collapseGh(MeshT &mesh, size_t outputFaceCount, double maxError,
+                 CollapseObservers observers) {
+  BoundedCostStopPredicate<MeshT> stop(outputFaceCount, _maxCost(maxError));
+
+  typedef typename GHPolicies::Get_cost GH_cost;
+  typedef typename GHPolicies::Get_placement GH_placement;
+  typedef std::conditional_t<kBounded, SMS::Bounded_normal_change_placement<GH_placement>,
+                             GH_placement>
+      Base_placement;
+  GHPolicies gh_policies(mesh);
+  const GH_cost &gh_cost = gh_policies.get_cost();
+  Base_placement base_placement(gh_policies.get_placement());
+
+  CollapseVisitor<MeshT> visitor(observers);
+
+  if constexpr (kLocked) {
+    Partition::BorderEdgeMap locked{&mesh};
+    SMS::Constrained_placement<Base_placement, Partition::BorderEdgeMap> placement(locked,
+                                                                                   base_placement);
+    SMS::edge_collapse(mesh, stop,
+                       CGAL::parameters::edge_is_constrained_map(locked)
+                           .get_cost(gh_cost)
+                           .get_placement(placement)
+                           .visitor(visitor));
+  } else {
+    auto collapse = [&](auto const &placement) {
+      SMS::edge_collapse(mesh, stop,
+                         CGAL::parameters::vertex_point_map(_pointMap(mesh))
+                             .get_cost(gh_cost)
+                             .get_placement(placement)
+                             .visitor(visitor));
+    };
+    // the distance check indexes the input in an AABB tree, which wants Kernel points in place
+    if constexpr (std::is_same_v<MeshT, Mesh>) {
+      if (maxError > 0.0) {
+        collapse(SMS::Bounded_distance_placement<Base_placement>(maxError, base_placement));
+        return;
+      }
+    }
+    collapse(base_placement);
+  }
 }
 
-void _processMesh(Mesh &mesh, size_t outputFaceCount,
-                  MeshSimplification::GarlandHeckbertPolicy policy) {
-  SMS::Face_count_stop_predicate<Mesh> stop(outputFaceCount);
+// the CGAL default, Lindstrom-Turk cost and placement, the cost mixes volume and area terms so a
+// positive maxError only bounds the placements
+template <bool kLocked, typename MeshT>
+void _collapseDefault(MeshT &mesh, size_t outputFaceCount, double maxError,
+                      CollapseObservers observers) {
+  SMS::Face_count_stop_predicate<MeshT> stop(outputFaceCount);
+
+  CollapseVisitor<MeshT> visitor(observers);
 
-  typedef typename Classic_plane::Get_cost GH_cost;
-  typedef typename Classic_plane::Get_placement GH_placement;
-  typedef SMS::Bounded_normal_change_placement<GH_placement> Bounded_GH_placement;
-  Classic_plane gh_policies(mesh);
-  const GH_cost &gh_cost           = gh_policies.get_cost();
-  const GH_placement &gh_placement = gh_policies.get_placement();
-  Bounded_GH_placement placement(gh_placement);
-  SMS::edge_collapse(mesh, stop, CGAL::parameters::get_cost(gh_cost).get_placement(placement));
+  if constexpr (kLocked) {
+    Partition::BorderEdgeMap locked{&mesh};
+    SMS::Constrained_placement<SMS::LindstromTurk_placement<Mesh>, Partition::BorderEdgeMap>
+        placement(locked);
+    SMS::edge_collapse(mesh, stop,
+                       CGAL::parameters::edge_is_constrained_map(locked)
+                           .get_placement(placement)
+                           .visitor(visitor));
+  } else {
+    if constexpr (std::is_same_v<MeshT, Mesh>) {
+      if (maxError > 0.0) {
+        SMS::Bounded_distance_placement<SMS::LindstromTurk_placement<Mesh>> placement(maxError);
+        SMS::edge_collapse(mesh, stop,
+                           CGAL::parameters::get_placement(placement).visitor(visitor));
+        return;
+      }
+    }
+    SMS::edge_collapse(mesh, stop,
+                       CGAL::parameters::vertex_point_map(_pointMap(mesh)).visitor(visitor));
+  }
 }
 
-void edgeCollapseDefault(std::string const &filename, size_t outputFaceCount) {
-  std::string const inputFilePath  = Io::makeFullInputPath(filename);
-  std::string const outputFilePath = Io::makeFullOutputPath(filename);
+template <bool kLocked, typename GHPolicies, typename MeshT>
+void _collapseBounded(MeshT &mesh, size_t outputFaceCount, bool boundNormalChange, double maxError,
+                      CollapseObservers observers) {
+  if (boundNormalChange) {
+    _collapseGh<GHPolicies, true, kLocked>(mesh, outputFaceCount, maxError, observers);
+  } else {
+    _collapseGh<GHPolicies, false, kLocked>(mesh, outputFaceCount, maxError, observers);
+  }
+}
+
+template <bool kLocked, typename MeshT>
+void _collapse(MeshT &mesh, size_t outputFaceCount,
+               MeshSimplification::GarlandHeckbertPolicy policy, bool boundNormalChange,
+               CollapseObservers observers, double maxError = 0.0) {
+  Instrument::Zone zone(kLocked ? "sms.edge_collapse.patch" : "sms.edge_collapse");
+
+  switch (policy) {
+  case MeshSimplification::GarlandHeckbertPolicy::kNone:
+    _collapseDefault<kLocked>(mesh, outputFaceCount, maxError, observers);
+    break;
+  case MeshSimplification::GarlandHeckbertPolicy::kClassicPlane:
+    _collapseBounded<kLocked, Classic_plane<MeshT>>(mesh, outputFaceCount, boundNormalChange,
+                                                    maxError, observers);
+    break;
+  case MeshSimplification::GarlandHeckbertPolicy::kProbabilisticPlane:
+    _collapseBounded<kLocked, Prob_plane<MeshT>>(mesh, outputFaceCount, boundNormalChange,
+                                                 maxError, observers);
+    break;
+  case MeshSimplification::GarlandHeckbertPolicy::kClassicTriangle:
+    _collapseBounded<kLocked, Classic_tri<MeshT>>(mesh, outputFaceCount, boundNormalChange,
+                                                  maxError, observers);
+    break;
+  case MeshSimplification::GarlandHeckbertPolicy::kProbabilisticTriangle:
+    _collapseBounded<kLocked, Prob_tri<MeshT>>(mesh, outputFaceCount, boundNormalChange, maxError,
+                                               observers);
+    break;
+  }
+}
+
+// ties a collapse stream to the mesh it was recorded on
+struct StreamHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  uint64_t vertexCount;
+  uint64_t faceCount;
+  uint64_t recordCount;
+};
+static_assert(sizeof(StreamHeader) % 8 == 0);
+
+char constexpr kStreamMagic[8]    = {'C', 'O', 'L', 'L', 'A', 'P', 'S', 'E'};
+uint32_t constexpr kStreamVersion = 1;
+
+std::string _lodFilename(std::string const &filename, std::string const &suffix) {
+  size_t const dot = filename.find_last_of('.');
+  if (dot == std::string::npos) {
+    return filename + suffix;
+  }
+  return filename.substr(0, dot) + suffix + filename.substr(dot);
+}
+
+std::string _streamFilename(std::string const &filename) {
+  size_t const dot = filename.find_last_of('.');
+  return (dot == std::string::npos ? filename : filename.substr(0, dot)) +
+         MeshSimplification::kCollapseStreamExtension;
+}
+
+} // namespace
+
+namespace MeshSimplification {
+
+std::optional<GarlandHeckbertPolicy> policyFromName(std::string const &name) {
+  if (name == "none") {
+    return GarlandHeckbertPolicy::kNone;
+  } else if (name == "cp") {
+    return GarlandHeckbertPolicy::kClassicPlane;
+  } else if (name == "pp") {
+    return GarlandHeckbertPolicy::kProbabilisticPlane;
+  } else if (name == "ct") {
+    return GarlandHeckbertPolicy::kClassicTriangle;
+  } else if (name == "pt") {
+    return GarlandHeckbertPolicy::kProbabilisticTriangle;
+  }
+  return std::nullopt;
+}
+
+void simplify(Mesh &mesh, size_t outputFaceCount, GarlandHeckbertPolicy policy,
+              bool boundNormalChange, Intersection::Index *index) {
+  CollapseObservers observers;
+  observers.index = index;
+  _collapse<false>(mesh, outputFaceCount, policy, boundNormalChange, observers);
+}
+
+void simplifyToError(Mesh &mesh, double maxError, GarlandHeckbertPolicy policy,
+                     bool boundNormalChange) {
+  _collapse<false>(mesh, 0, policy, boundNormalChange, CollapseObservers{}, maxError);
+}
+
+void simplify(CompactMesh &mesh, size_t outputFaceCount, GarlandHeckbertPolicy policy,
+              bool boundNormalChange) {
+  _collapse<false>(mesh, outputFaceCount, policy, boundNormalChange, CollapseObservers{});
+}
+
+void simplifyPatch(Mesh &mesh, size_t outputFaceCount, GarlandHeckbertPolicy policy,
+                   bool boundNormalChange) {
+  _collapse<true>(mesh, outputFaceCount, policy, boundNormalChange, CollapseObservers{});
+}
+
+void simplifyParallel(Mesh &mesh, size_t outputFaceCount, GarlandHeckbertPolicy policy,
+                      size_t threadCount, bool boundNormalChange, size_t patchCount) {
+  size_t const faceCount = num_faces(mesh);
+  threadCount            = threadCount != 0 ? threadCount : std::thread::hardware_concurrency();
+  patchCount             = patchCount != 0 ? patchCount : threadCount;
+  if (faceCount <= outputFaceCount || patchCount <= 1) {
+    simplify(mesh, outputFaceCount, policy, boundNormalChange);
+    return;
+  }
+
+  std::unique_ptr<ThreadPool> const pool = ThreadPool::withThreads(threadCount);
+
+  std::vector<std::vector<Partition::Face_index>> groups = Partition::splitFaces(mesh, patchCount);
+  std::vector<std::optional<Partition::Patch>> patches(groups.size());
+  pool->parallelFor(groups.size(), [&](size_t i) {
+    patches[i] = Partition::extractPatch(mesh, groups[i]);
+    if (patches[i] == std::nullopt) {
+      return;
+    }
+    // each patch gets its share of the target, the seam pass below settles the exact count
+    size_t const share = outputFaceCount * groups[i].size() / faceCount;
+    simplifyPatch(patches[i]->mesh, share, policy, boundNormalChange);
+  });
+
+  std::vector<Partition::Patch> simplifiedPatches;
+  simplifiedPatches.reserve(patches.size());
+  for (auto &patch : patches) {
+    if (patch == std::nullopt) {
+      std::cerr << "Patch is not a valid mesh on its own, simplifying serially" << std::endl;
+      simplify(mesh, outputFaceCount, policy, boundNormalChange);
+      return;
+    }
+    simplifiedPatches.emplace_back(std::move(patch.value()));
+  }
+
+  Mesh merged;
+  if (!Partition::mergePatches(simplifiedPatches, merged)) {
+    std::cerr << "Cannot merge patches, simplifying serially" << std::endl;
+    simplify(mesh, outputFaceCount, policy, boundNormalChange);
+    return;
+  }
+  mesh = std::move(merged);
+
+  // seam pass, borders are unlocked and one global queue brings the mesh to the exact target
+  simplify(mesh, outputFaceCount, policy, boundNormalChange);
+}
 
-  auto maybeMesh = _readMesh(inputFilePath);
+void reportParallelScaling(std::string const &filename, size_t outputFaceCount,
+                           GarlandHeckbertPolicy policy, std::vector<size_t> const &threadCounts) {
+  std::string const inputFilePath = Io::makeFullInputPath(filename);
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
   if (maybeMesh == std::nullopt) {
     return;
   }
-  auto &mesh = maybeMesh.value();
+  Mesh const &input = maybeMesh.value();
 
-  SMS::Face_count_stop_predicate<Mesh> stop(outputFaceCount);
+  Mesh serial = input;
+  auto start  = Timing::Clock::now();
+  simplify(serial, outputFaceCount, policy);
+  double const serialSeconds = Timing::secondsSince(start);
+  std::cout << "serial: " << serialSeconds << "s, " << num_faces(serial) << " faces" << std::endl;
 
-  SMS::edge_collapse(mesh, stop);
+  for (size_t threadCount : threadCounts) {
+    Mesh parallel = input;
+    start         = Timing::Clock::now();
+    simplifyParallel(parallel, outputFaceCount, policy, threadCount);
+    double const parallelSeconds = Timing::secondsSince(start);
+    std::cout << threadCount << " threads: " << parallelSeconds << "s, " << num_faces(parallel)
+              << " faces, speedup " << serialSeconds / parallelSeconds << "x" << std::endl;
+  }
+}
 
-  CGAL::IO::write_polygon_mesh(outputFilePath, mesh, CGAL::parameters::stream_precision(17));
+void reportPolicyMatrix(std::string const &filename, size_t outputFaceCount) {
+  std::string const inputFilePath = Io::makeFullInputPath(filename);
 
-  std::cout << "Remeshed mesh written to path (" << outputFilePath << ")" << std::endl;
-  // auto remeshedMeshOpt = _readMesh(outputFilePath);
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return;
+  }
+  Mesh const &input = maybeMesh.value();
+
+  CGAL::Bbox_3 const box = CGAL::Polygon_mesh_processing::bbox(input);
+  double const diagonal =
+      std::sqrt(CGAL::square(box.xmax() - box.xmin()) + CGAL::square(box.ymax() - box.ymin()) +
+                CGAL::square(box.zmax() - box.zmin()));
+
+  // the peak only covers one run when the platform can reset it, otherwise it is the process peak
+  if (!Memory::resetPeakResident()) {
+    std::cout << "Peak memory cannot be reset, reporting the process peak" << std::endl;
+  }
+
+  std::cout << "policy, bounded, seconds, faces, peak MiB, hausdorff, hausdorff / diagonal"
+            << std::endl;
+  for (char const *name : {"none", "cp", "pp", "ct", "pt"}) {
+    GarlandHeckbertPolicy const policy = policyFromName(name).value();
+    for (bool boundNormalChange : {true, false}) {
+      // the bound does not apply to the Lindstrom-Turk default
+      if (policy == GarlandHeckbertPolicy::kNone && !boundNormalChange) {
+        continue;
+      }
+
+      Mesh output = input;
+      Memory::resetPeakResident();
+      auto start = Timing::Clock::now();
+      simplify(output, outputFaceCount, policy, boundNormalChange);
+      double const seconds = Timing::secondsSince(start);
+      double const peakMiB = Memory::peakResidentBytes() / (1024.0 * 1024.0);
+      output.collect_garbage();
+
+      double const hausdorff =
+          CGAL::Polygon_mesh_processing::approximate_symmetric_Hausdorff_distance<
+              CGAL::Sequential_tag>(input, output);
+      std::cout << name << ", " << (boundNormalChange ? "yes" : "no") << ", " << seconds << ", "
+                << num_faces(output) << ", " << peakMiB << ", " << hausdorff << ", "
+                << hausdorff / diagonal << std::endl;
+    }
+  }
 }
 
-void edgeCollapseGarlandHeckbert(std::string const &filename, size_t outputFaceCount,
-                                 MeshSimplification::GarlandHeckbertPolicy policy) {
+void edgeCollapse(std::string const &filename, size_t outputFaceCount,
+                  GarlandHeckbertPolicy policy, bool compact, double maxError) {
   std::string const inputFilePath  = Io::makeFullInputPath(filename);
-  std::string const outputFilePath = Io::makeFullOutputPath(filename);
+  std::string const outputFilePath = Io::makeMeshOutputPath(filename);
+
+  std::stringstream operation;
+  operation << std::setprecision(17) << "sim:" << outputFaceCount << ":"
+            << static_cast<int>(policy) << ":" << compact << ":" << maxError;
+  std::optional<std::string> resultKey;
+  if (Io::fetchResult(inputFilePath, operation.str(), outputFilePath, resultKey)) {
+    return;
+  }
 
-  auto maybeMesh = _readMesh(inputFilePath);
+  if (compact && maxError <= 0.0) {
+    auto maybeMesh = Io::loadTriangleMesh<CompactMesh>(inputFilePath);
+    if (maybeMesh == std::nullopt) {
+      return;
+    }
+    simplify(maybeMesh.value(), outputFaceCount, policy);
+    if (Io::writeSurfaceMesh(outputFilePath, maybeMesh.value())) {
+      Io::storeResult(resultKey, outputFilePath);
+    }
+    std::cout << "Remeshed mesh written to path (" << outputFilePath << ")" << std::endl;
+    return;
+  }
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
   if (maybeMesh == std::nullopt) {
     return;
   }
   auto &mesh = maybeMesh.value();
 
-  _processMesh(mesh, outputFaceCount, policy);
+  if (maxError > 0.0) {
+    simplifyToError(mesh, maxError, policy);
+    std::cout << "Faces within " << maxError << ": " << num_faces(mesh) << std::endl;
+  } else {
+    simplify(mesh, outputFaceCount, policy);
+  }
 
-  CGAL::IO::write_polygon_mesh(outputFilePath, mesh, CGAL::parameters::stream_precision(17));
+  if (Io::writeSurfaceMesh(outputFilePath, mesh)) {
+    Io::storeResult(resultKey, outputFilePath);
+  }
 
   std::cout << "Remeshed mesh written to path (" << outputFilePath << ")" << std::endl;
   // auto remeshedMeshOpt = _readMesh(outputFilePath);
 }
 
-} // namespace
+char const *const kCollapseStreamExtension = ".collapses";
 
-namespace MeshSimplification {
+void simplifyLods(Mesh &mesh, std::vector<size_t> faceCounts, GarlandHeckbertPolicy policy,
+                  std::function<void(size_t faceCount, Mesh const &lod)> const &onLod,
+                  std::vector<CollapseRecord> *records) {
+  Instrument::Zone zone("sms.lods");
 
-void edgeCollapse(std::string const &filename, size_t outputFaceCount,
-                  GarlandHeckbertPolicy policy) {
-  if (policy == GarlandHeckbertPolicy::kNone) {
-    edgeCollapseDefault(filename, outputFaceCount);
-  } else {
-    edgeCollapseGarlandHeckbert(filename, outputFaceCount, policy);
+  std::sort(faceCounts.begin(), faceCounts.end(), std::greater<size_t>());
+  faceCounts.erase(std::unique(faceCounts.begin(), faceCounts.end()), faceCounts.end());
+  if (faceCounts.empty()) {
+    return;
+  }
+
+  LodRecorder lods;
+  lods.faceCounts = faceCounts;
+  lods.onLod      = &onLod;
+  lods.records    = records;
+
+  // targets at or above the input size need no collapse at all
+  while (lods.nextTarget < faceCounts.size() &&
+         mesh.number_of_faces() <= faceCounts[lods.nextTarget]) {
+    onLod(faceCounts[lods.nextTarget++], mesh);
+  }
+
+  CollapseObservers observers;
+  observers.lods = &lods;
+  _collapse<false>(mesh, faceCounts.back(), policy, true, observers);
+
+  // the collapse gives up early when no edge can go without breaking the mesh
+  while (lods.nextTarget < faceCounts.size()) {
+    std::cerr << "Cannot reach " << faceCounts[lods.nextTarget] << " faces, stopped at "
+              << mesh.number_of_faces() << std::endl;
+    onLod(faceCounts[lods.nextTarget++], mesh);
   }
 }
 
+bool replayCollapses(Mesh &mesh, std::vector<CollapseRecord> const &records,
+                     size_t outputFaceCount) {
+  Instrument::Zone zone("sms.replayCollapses");
+
+  // the collapse may keep the other vertex than it did while recording, alias maps every recorded
+  // vertex to whichever vertex stands for it now
+  std::vector<Mesh::Vertex_index> alias(mesh.number_of_vertices() +
+                                        mesh.number_of_removed_vertices());
+  for (size_t i = 0; i < alias.size(); i++) {
+    alias[i] = Mesh::Vertex_index(static_cast<uint32_t>(i));
+  }
+
+  for (CollapseRecord const &record : records) {
+    if (mesh.number_of_faces() <= outputFaceCount) {
+      break;
+    }
+    Mesh::Halfedge_index const h =
+        record.removedVertex < alias.size() && record.keptVertex < alias.size()
+            ? mesh.halfedge(alias[record.removedVertex], alias[record.keptVertex])
+            : Mesh::null_halfedge();
+    if (h == Mesh::null_halfedge() ||
+        !CGAL::Euler::does_satisfy_link_condition(mesh.edge(h), mesh)) {
+      std::cerr << "Collapse stream does not match the mesh" << std::endl;
+      return false;
+    }
+    Mesh::Vertex_index const survivor = CGAL::Euler::collapse_edge(mesh.edge(h), mesh);
+    mesh.point(survivor)              = Kernel::Point_3(record.x, record.y, record.z);
+    alias[record.keptVertex]          = survivor;
+  }
+  return true;
+}
+
+bool writeCollapseStream(std::string const &filePath, size_t sourceVertexCount,
+                         size_t sourceFaceCount, std::vector<CollapseRecord> const &records) {
+  StreamHeader header{};
+  std::memcpy(header.magic, kStreamMagic, sizeof(kStreamMagic));
+  header.version     = kStreamVersion;
+  header.recordSize  = sizeof(CollapseRecord);
+  header.vertexCount = sourceVertexCount;
+  header.faceCount   = sourceFaceCount;
+  header.recordCount = records.size();
+
+  std::FILE *file = std::fopen(filePath.c_str(), "wb");
+  if (file == nullptr) {
+    std::cerr << "Cannot write collapse stream (" << filePath << ")" << std::endl;
+    return false;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(records.data(), sizeof(CollapseRecord), records.size(), file) ==
+                records.size();
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok) {
+    std::cerr << "Cannot write collapse stream (" << filePath << ")" << std::endl;
+  }
+  return ok;
+}
+
+std::optional<std::vector<CollapseRecord>> readCollapseStream(std::string const &filePath,
+                                                              Mesh const &source) {
+  std::FILE *file = std::fopen(filePath.c_str(), "rb");
+  if (file == nullptr) {
+    std::cerr << "Cannot open collapse stream (" << filePath << ")" << std::endl;
+    return std::nullopt;
+  }
+
+  StreamHeader header{};
+  std::vector<CollapseRecord> records;
+  bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+            std::memcmp(header.magic, kStreamMagic, sizeof(kStreamMagic)) == 0 &&
+            header.version == kStreamVersion && header.recordSize == sizeof(CollapseRecord);
+  if (ok) {
+    records.resize(header.recordCount);
+    ok = std::fread(records.data(), sizeof(CollapseRecord), records.size(), file) ==
+         records.size();
+  }
+  std::fclose(file);
+  if (!ok) {
+    std::cerr << "Invalid collapse stream (" << filePath << ")" << std::endl;
+    return std::nullopt;
+  }
+
+  if (header.vertexCount != source.number_of_vertices() ||
+      header.faceCount != source.number_of_faces()) {
+    std::cerr << "Collapse stream was recorded on another mesh (" << filePath << ")" << std::endl;
+    return std::nullopt;
+  }
+  return records;
+}
+
+void generateLods(std::string const &filename, std::vector<size_t> const &faceCounts,
+                  GarlandHeckbertPolicy policy, bool writeStream) {
+  std::string const inputFilePath = Io::makeFullInputPath(filename);
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return;
+  }
+  Mesh &mesh                     = maybeMesh.value();
+  size_t const sourceVertexCount = mesh.number_of_vertices();
+  size_t const sourceFaceCount   = mesh.number_of_faces();
+
+  std::vector<CollapseRecord> records;
+  simplifyLods(
+      mesh, faceCounts, policy,
+      [&filename](size_t faceCount, Mesh const &lod) {
+        std::string const outputFilePath =
+            Io::makeMeshOutputPath(_lodFilename(filename, ".lod" + std::to_string(faceCount)));
+        Io::writeSurfaceMesh(outputFilePath, lod);
+        std::cout << "LOD " << faceCount << " (" << lod.number_of_faces()
+                  << " faces) written to path (" << outputFilePath << ")" << std::endl;
+      },
+      writeStream ? &records : nullptr);
+
+  if (writeStream) {
+    std::string const streamFilePath = Io::makeFullOutputPath(_streamFilename(filename));
+    if (writeCollapseStream(streamFilePath, sourceVertexCount, sourceFaceCount, records)) {
+      std::cout << records.size() << " collapses written to path (" << streamFilePath << ")"
+                << std::endl;
+    }
+  }
+}
+
+void reconstructLod(std::string const &filename, size_t outputFaceCount) {
+  std::string const inputFilePath  = Io::makeFullInputPath(filename);
+  std::string const streamFilePath = Io::makeFullOutputPath(_streamFilename(filename));
+  std::string const outputFilePath =
+      Io::makeMeshOutputPath(_lodFilename(filename, ".lod" + std::to_string(outputFaceCount)));
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return;
+  }
+  Mesh &mesh = maybeMesh.value();
+
+  auto records = readCollapseStream(streamFilePath, mesh);
+  if (records == std::nullopt || !replayCollapses(mesh, records.value(), outputFaceCount)) {
+    return;
+  }
+
+  Io::writeSurfaceMesh(outputFilePath, mesh);
+  std::cout << "LOD (" << mesh.number_of_faces() << " faces) written to path (" << outputFilePath
+            << ")" << std::endl;
+}
+
 } // namespace MeshSimplification
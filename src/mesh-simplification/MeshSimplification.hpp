@@ -1,6 +1,16 @@
 #pragma once
 
+#include "common/Mesh.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
 #include <string>
+#include <vector>
+
+namespace Intersection {
+class Index;
+} // namespace Intersection
 
 namespace MeshSimplification {
 
@@ -12,8 +22,89 @@ enum class GarlandHeckbertPolicy {
   kProbabilisticTriangle,
 };
 
+// "none", "cp", "pp", "ct" or "pt", as typed at the simplify prompt
+std::optional<GarlandHeckbertPolicy> policyFromName(std::string const &name);
+
+// collapses edges in place until outputFaceCount faces remain, boundNormalChange wraps the
+// Garland-Heckbert placement in Bounded_normal_change_placement and has no effect on kNone, an
+// index gets every face the collapses touch marked for its next update
+void simplify(Mesh &mesh, size_t outputFaceCount, GarlandHeckbertPolicy policy,
+              bool boundNormalChange = true, Intersection::Index *index = nullptr);
+
+// collapses until the next edge would move the surface further than maxError from the input, one
+// run gives the smallest mesh within the tolerance, a Garland-Heckbert cost is a sum of squared
+// distances to input planes so the run stops at the first edge costing more than maxError
+// squared, every placement is also checked against an AABB tree of the input, kNone has a
+// Lindstrom-Turk cost which is not a distance and only gets the placement check
+void simplifyToError(Mesh &mesh, double maxError, GarlandHeckbertPolicy policy,
+                     bool boundNormalChange = true);
+
+// simplify on single precision storage, costs and placements are still computed in Kernel and
+// only the final positions are rounded to float
+void simplify(CompactMesh &mesh, size_t outputFaceCount, GarlandHeckbertPolicy policy,
+              bool boundNormalChange = true);
+
+// simplify with border edges and their vertices locked, so the mesh still fits the faces it was
+// cut from
+void simplifyPatch(Mesh &mesh, size_t outputFaceCount, GarlandHeckbertPolicy policy,
+                   bool boundNormalChange = true);
+
+// splits the mesh into patches and simplifies them concurrently with their borders locked, a
+// final serial pass over the merged mesh collapses the seams down to outputFaceCount, threadCount
+// 0 means all hardware threads, patchCount 0 means one patch per thread, a fixed patchCount keeps
+// the work the same whatever the thread count
+void simplifyParallel(Mesh &mesh, size_t outputFaceCount, GarlandHeckbertPolicy policy,
+                      size_t threadCount, bool boundNormalChange = true, size_t patchCount = 0);
+
+// times simplify against simplifyParallel at every thread count on the same input
+void reportParallelScaling(std::string const &filename, size_t outputFaceCount,
+                           GarlandHeckbertPolicy policy, std::vector<size_t> const &threadCounts);
+
+// runs every policy, with and without the normal change bound, on the same input and prints the
+// time, peak memory and symmetric Hausdorff distance to the input of each
+void reportPolicyMatrix(std::string const &filename, size_t outputFaceCount);
+
+// compact loads the input as a CompactMesh, for inputs where the point memory matters, a positive
+// maxError runs simplifyToError instead and ignores outputFaceCount and compact
 void edgeCollapse(std::string const &filename, size_t outputFaceCount,
-                  GarlandHeckbertPolicy policy);
+                  GarlandHeckbertPolicy policy, bool compact = false, double maxError = 0.0);
+
+// one collapse of a recorded run, the vertex indices are those of the mesh as it was loaded and
+// the position is where the kept vertex ended up
+struct CollapseRecord {
+  uint32_t removedVertex;
+  uint32_t keptVertex;
+  double x, y, z;
+};
+
+// extension of the collapse stream written next to the LODs
+extern char const *const kCollapseStreamExtension;
+
+// a single collapse run down to the smallest face count, onLod sees the mesh each time its face
+// count reaches one of the targets, largest first, the mesh still holds garbage at that point,
+// records receives every collapse when not null
+void simplifyLods(Mesh &mesh, std::vector<size_t> faceCounts, GarlandHeckbertPolicy policy,
+                  std::function<void(size_t faceCount, Mesh const &lod)> const &onLod,
+                  std::vector<CollapseRecord> *records = nullptr);
+
+// applies records to the mesh they were recorded on until at most outputFaceCount faces remain,
+// false if a record doesn't fit the mesh
+bool replayCollapses(Mesh &mesh, std::vector<CollapseRecord> const &records,
+                     size_t outputFaceCount);
+
+// the vertex and face counts of the source are stored so a stream is never replayed on another mesh
+bool writeCollapseStream(std::string const &filePath, size_t sourceVertexCount,
+                         size_t sourceFaceCount, std::vector<CollapseRecord> const &records);
+std::optional<std::vector<CollapseRecord>> readCollapseStream(std::string const &filePath,
+                                                              Mesh const &source);
+
+// loads the input once and writes <stem>.lod<faceCount><extension> for every target, writeStream
+// adds the collapse stream so reconstructLod can rebuild any level later
+void generateLods(std::string const &filename, std::vector<size_t> const &faceCounts,
+                  GarlandHeckbertPolicy policy, bool writeStream);
+
+// replays the stream generateLods wrote for the input instead of simplifying again
+void reconstructLod(std::string const &filename, size_t outputFaceCount);
 
 
-} // namespace MeshSimplification
\ No newline at end of file
+} // namespace MeshSimplification
@@ -0,0 +1,695 @@
+#include "OutOfCore.hpp"
+
+#include <CGAL/boost/graph/helpers.h>
+
+#include "common/Instrument.hpp"
+#include "common/Memory.hpp"
+#include "io/Io.hpp"
+#include "io/Obj.hpp"
+#include "io/SurfaceMeshIo.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// rough in-core cost of one triangle while it collapses, the mesh itself plus the queue, the cost
+// and placement caches and the quadrics
+size_t constexpr kBytesPerFace = 512;
+
+size_t constexpr kStreamBatchSize = size_t{1} << 16;
+
+// a bucket still over budget after this many splits has its faces bunched in one spot and is
+// taken as it is
+int constexpr kMaxSplitDepth = 8;
+
+uint32_t constexpr kNoWeld = UINT32_MAX;
+
+// vertices per page of the positions window
+size_t constexpr kPageVertexCount = size_t{1} << 12;
+
+typedef std::array<uint32_t, 3> Triangle;
+typedef std::array<double, 3> Vector;
+
+// a triangle as it is binned, its corner positions travel with it so the buckets never go back
+// to the positions file
+struct FaceRecord {
+  Triangle vertices;
+  std::array<double, 9> corners;
+};
+
+// removes the scratch files however the run ends
+struct ScratchDirectory {
+  std::string path;
+
+  explicit ScratchDirectory(std::string directory) : path(std::move(directory)) {
+    std::error_code error;
+    std::filesystem::create_directories(path, error);
+  }
+
+  ~ScratchDirectory() {
+    std::error_code error;
+    std::filesystem::remove_all(path, error);
+  }
+};
+
+// a uniform grid over a box, flat axes get a single cell
+struct Grid {
+  Vector lower{};
+  Vector cellSize{};
+  std::array<size_t, 3> cellCounts{1, 1, 1};
+
+  Grid(Vector const &lowerCorner, Vector const &upperCorner, size_t cellsPerAxis)
+      : lower(lowerCorner) {
+    for (int axis = 0; axis < 3; axis++) {
+      double const extent = upperCorner[axis] - lowerCorner[axis];
+      cellCounts[axis]    = extent > 0.0 ? std::max<size_t>(1, cellsPerAxis) : 1;
+      cellSize[axis]      = extent / cellCounts[axis];
+    }
+  }
+
+  [[nodiscard]] size_t cellCount() const { return cellCounts[0] * cellCounts[1] * cellCounts[2]; }
+
+  [[nodiscard]] size_t cellOf(Vector const &point) const {
+    size_t cell   = 0;
+    size_t stride = 1;
+    for (int axis = 0; axis < 3; axis++) {
+      size_t index = 0;
+      if (cellSize[axis] > 0.0) {
+        double const offset = std::max(0.0, (point[axis] - lower[axis]) / cellSize[axis]);
+        index               = std::min(static_cast<size_t>(offset), cellCounts[axis] - 1);
+      }
+      cell += index * stride;
+      stride *= cellCounts[axis];
+    }
+    return cell;
+  }
+};
+
+// positions files pass 2 GB long before the budget matters, so the seek takes a 64-bit offset
+bool _seek(std::FILE *file, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// reads the spilled positions back a page at a time and keeps at most a fixed number of pages,
+// the least recently used one makes room for the next
+class PositionWindow {
+public:
+  PositionWindow(std::string const &filePath, size_t vertexCount, size_t capacityBytes)
+      : mFile(std::fopen(filePath.c_str(), "rb")), mVertexCount(vertexCount),
+        mPageCapacity(
+            std::max<size_t>(1, capacityBytes / (3 * sizeof(double) * kPageVertexCount))) {}
+
+  ~PositionWindow() {
+    if (mFile != nullptr) {
+      std::fclose(mFile);
+    }
+  }
+
+  PositionWindow(PositionWindow const &)            = delete;
+  PositionWindow &operator=(PositionWindow const &) = delete;
+
+  [[nodiscard]] bool isOpen() const { return mFile != nullptr; }
+  [[nodiscard]] size_t loadCount() const { return mLoadCount; }
+
+  // nullptr if the page cannot be read
+  double const *position(uint32_t vertex) {
+    size_t const pageIndex = vertex / kPageVertexCount;
+    auto const found       = mPages.find(pageIndex);
+    if (found != mPages.end()) {
+      mRecent.splice(mRecent.begin(), mRecent, found->second);
+    } else if (!_load(pageIndex)) {
+      return nullptr;
+    }
+    return mRecent.front().positions.data() + 3 * (vertex % kPageVertexCount);
+  }
+
+private:
+  struct Page {
+    size_t index = 0;
+    std::vector<double> positions;
+  };
+
+  bool _load(size_t pageIndex) {
+    Page page;
+    if (mRecent.size() >= mPageCapacity) {
+      page = std::move(mRecent.back());
+      mPages.erase(page.index);
+      mRecent.pop_back();
+    }
+    size_t const first = pageIndex * kPageVertexCount;
+    page.index         = pageIndex;
+    page.positions.resize(3 * std::min(kPageVertexCount, mVertexCount - first));
+    ++mLoadCount;
+    if (!_seek(mFile, 3 * sizeof(double) * uint64_t{first}) ||
+        std::fread(page.positions.data(), sizeof(double), page.positions.size(), mFile) !=
+            page.positions.size()) {
+      return false;
+    }
+    mRecent.push_front(std::move(page));
+    mPages[pageIndex] = mRecent.begin();
+    return true;
+  }
+
+  std::FILE *mFile;
+  size_t mVertexCount;
+  size_t mPageCapacity;
+  size_t mLoadCount = 0;
+  std::list<Page> mRecent;
+  std::unordered_map<size_t, std::list<Page>::iterator> mPages;
+};
+
+// bins triangles into one file per cell, a cell buffers a few and appends them to its file when
+// the buffer fills, so no file stays open and the cell count is not bound by the descriptor limit
+class BucketWriter {
+public:
+  BucketWriter(std::string prefix, size_t cellCount, size_t bufferSize)
+      : mPrefix(std::move(prefix)), mBufferSize(bufferSize), mBuffers(cellCount),
+        mFaceCounts(cellCount, 0) {}
+
+  bool add(size_t cell, FaceRecord const &record) {
+    mBuffers[cell].push_back(record);
+    ++mFaceCounts[cell];
+    return mBuffers[cell].size() < mBufferSize || _flush(cell);
+  }
+
+  bool flush() {
+    bool ok = true;
+    for (size_t cell = 0; cell < mBuffers.size(); cell++) {
+      ok = _flush(cell) && ok;
+    }
+    return ok;
+  }
+
+  [[nodiscard]] size_t cellCount() const { return mBuffers.size(); }
+  [[nodiscard]] size_t faceCount(size_t cell) const { return mFaceCounts[cell]; }
+  [[nodiscard]] std::string path(size_t cell) const {
+    return mPrefix + std::to_string(cell) + ".bin";
+  }
+
+private:
+  bool _flush(size_t cell) {
+    std::vector<FaceRecord> &buffer = mBuffers[cell];
+    if (buffer.empty()) {
+      return true;
+    }
+    std::string const filePath = path(cell);
+    std::FILE *file            = std::fopen(filePath.c_str(), "ab");
+
+    bool ok = file != nullptr &&
+              std::fwrite(buffer.data(), sizeof(FaceRecord), buffer.size(), file) == buffer.size();
+    ok = file != nullptr && std::fclose(file) == 0 && ok;
+    if (!ok) {
+      std::cerr << "Cannot write bucket (" << filePath << ")" << std::endl;
+    }
+    buffer.clear();
+    return ok;
+  }
+
+  std::string mPrefix;
+  size_t mBufferSize;
+  std::vector<std::vector<FaceRecord>> mBuffers;
+  std::vector<size_t> mFaceCounts;
+};
+
+// what a chunk leaves for the stitch, weldIds hold the input index of the vertices that still sit
+// where the input put them and may be shared with another chunk, kNoWeld for the others
+struct Chunk {
+  std::vector<double> positions;
+  std::vector<uint32_t> weldIds;
+  std::vector<Triangle> triangles;
+};
+
+// the state of one out-of-core run
+struct Run {
+  size_t vertexCount = 0;
+  size_t faceCount   = 0;
+
+  size_t outputFaceCount = 0;
+  size_t chunkFaceBudget = 0;
+  MeshSimplification::GarlandHeckbertPolicy policy;
+  bool boundNormalChange = true;
+
+  std::string scratchPrefix;
+  std::vector<std::string> chunkFilePaths;
+  size_t passedThroughCount = 0;
+};
+
+Vector _centroid(FaceRecord const &record) {
+  Vector centroid{0.0, 0.0, 0.0};
+  for (size_t k = 0; k < 3; k++) {
+    for (int axis = 0; axis < 3; axis++) {
+      centroid[axis] += record.corners[3 * k + axis] / 3.0;
+    }
+  }
+  return centroid;
+}
+
+void _extend(Vector &lower, Vector &upper, Vector const &point) {
+  for (int axis = 0; axis < 3; axis++) {
+    lower[axis] = std::min(lower[axis], point[axis]);
+    upper[axis] = std::max(upper[axis], point[axis]);
+  }
+}
+
+// hands the records of a bucket file to function a block at a time
+template <typename Function> bool _forEachBlock(std::string const &filePath, Function &&function) {
+  std::FILE *file = std::fopen(filePath.c_str(), "rb");
+  if (file == nullptr) {
+    std::cerr << "Cannot open bucket (" << filePath << ")" << std::endl;
+    return false;
+  }
+  std::vector<FaceRecord> block(kStreamBatchSize);
+  size_t count = 0;
+  while ((count = std::fread(block.data(), sizeof(FaceRecord), block.size(), file)) > 0) {
+    function(block.data(), count);
+  }
+  std::fclose(file);
+  return true;
+}
+
+bool _writeChunk(std::string const &filePath, Chunk const &chunk) {
+  uint64_t const counts[2] = {chunk.weldIds.size(), chunk.triangles.size()};
+
+  std::FILE *file = std::fopen(filePath.c_str(), "wb");
+  if (file == nullptr) {
+    std::cerr << "Cannot write chunk (" << filePath << ")" << std::endl;
+    return false;
+  }
+  bool ok =
+      std::fwrite(counts, sizeof(counts), 1, file) == 1 &&
+      std::fwrite(chunk.positions.data(), sizeof(double), chunk.positions.size(), file) ==
+          chunk.positions.size() &&
+      std::fwrite(chunk.weldIds.data(), sizeof(uint32_t), chunk.weldIds.size(), file) ==
+          chunk.weldIds.size() &&
+      std::fwrite(chunk.triangles.data(), sizeof(Triangle), chunk.triangles.size(), file) ==
+          chunk.triangles.size();
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok) {
+    std::cerr << "Cannot write chunk (" << filePath << ")" << std::endl;
+  }
+  return ok;
+}
+
+std::optional<Chunk> _readChunk(std::string const &filePath) {
+  std::FILE *file = std::fopen(filePath.c_str(), "rb");
+  if (file == nullptr) {
+    std::cerr << "Cannot open chunk (" << filePath << ")" << std::endl;
+    return std::nullopt;
+  }
+  Chunk chunk;
+  uint64_t counts[2] = {0, 0};
+  bool ok            = std::fread(counts, sizeof(counts), 1, file) == 1;
+  if (ok) {
+    chunk.positions.resize(3 * counts[0]);
+    chunk.weldIds.resize(counts[0]);
+    chunk.triangles.resize(counts[1]);
+    ok = std::fread(chunk.positions.data(), sizeof(double), chunk.positions.size(), file) ==
+             chunk.positions.size() &&
+         std::fread(chunk.weldIds.data(), sizeof(uint32_t), chunk.weldIds.size(), file) ==
+             chunk.weldIds.size() &&
+         std::fread(chunk.triangles.data(), sizeof(Triangle), chunk.triangles.size(), file) ==
+             chunk.triangles.size();
+  }
+  std::fclose(file);
+  if (!ok) {
+    std::cerr << "Invalid chunk (" << filePath << ")" << std::endl;
+    return std::nullopt;
+  }
+  return chunk;
+}
+
+// first pass, positions go to a flat scratch file and the box, faces are only counted as the
+// triangles they split into
+bool _spillPositions(std::string const &inputFilePath, std::string const &positionFilePath,
+                     Run &run, Vector &lower, Vector &upper) {
+  Instrument::Zone zone("sms.outOfCore.spill");
+
+  std::FILE *file = std::fopen(positionFilePath.c_str(), "wb");
+  if (file == nullptr) {
+    std::cerr << "Cannot write positions (" << positionFilePath << ")" << std::endl;
+    return false;
+  }
+
+  lower.fill(std::numeric_limits<double>::max());
+  upper.fill(std::numeric_limits<double>::lowest());
+  bool ok = Io::streamObj(
+      inputFilePath, kStreamBatchSize, [&](Io::MeshBuffer const &batch, size_t) {
+        for (size_t v = 0; v < batch.vertexCount(); v++) {
+          double const *p = batch.positions.data() + 3 * v;
+          _extend(lower, upper, Vector{p[0], p[1], p[2]});
+        }
+        for (size_t f = 0; f < batch.faceCount(); f++) {
+          size_t const cornerCount = batch.faceOffsets[f + 1] - batch.faceOffsets[f];
+          run.faceCount += cornerCount >= 3 ? cornerCount - 2 : 0;
+        }
+        run.vertexCount += batch.vertexCount();
+        return std::fwrite(batch.positions.data(), sizeof(double), batch.positions.size(),
+                           file) == batch.positions.size();
+      });
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok) {
+    std::cerr << "Cannot spill positions of (" << inputFilePath << ")" << std::endl;
+  }
+  return ok;
+}
+
+// second pass, every triangle goes to the bucket of its centroid with its corner positions, the
+// positions come through the window
+bool _binFaces(std::string const &inputFilePath, Run const &run, Grid const &grid,
+               PositionWindow &window, BucketWriter &buckets) {
+  Instrument::Zone zone("sms.outOfCore.bin");
+
+  bool const ok = Io::streamObj(
+      inputFilePath, kStreamBatchSize, [&](Io::MeshBuffer const &batch, size_t) {
+        for (size_t f = 0; f < batch.faceCount(); f++) {
+          uint32_t const *corners  = batch.indices.data() + batch.faceOffsets[f];
+          size_t const cornerCount = batch.faceOffsets[f + 1] - batch.faceOffsets[f];
+          for (size_t c = 0; c < cornerCount; c++) {
+            if (corners[c] >= run.vertexCount) {
+              std::cerr << "Face index out of range in (" << inputFilePath << ")" << std::endl;
+              return false;
+            }
+          }
+          // polygons are split into fans
+          for (size_t c = 2; c < cornerCount; c++) {
+            FaceRecord record{};
+            record.vertices = {corners[0], corners[c - 1], corners[c]};
+            for (size_t k = 0; k < 3; k++) {
+              double const *p = window.position(record.vertices[k]);
+              if (p == nullptr) {
+                std::cerr << "Cannot read back positions of (" << inputFilePath << ")"
+                          << std::endl;
+                return false;
+              }
+              std::copy(p, p + 3, record.corners.begin() + 3 * k);
+            }
+            if (!buckets.add(grid.cellOf(_centroid(record)), record)) {
+              return false;
+            }
+          }
+        }
+        return true;
+      });
+  return buckets.flush() && ok;
+}
+
+// the faces of a bucket as they are, every vertex keeps its input index
+void _passThrough(std::vector<FaceRecord> const &records, Chunk &chunk) {
+  std::unordered_map<uint32_t, uint32_t> local;
+  for (FaceRecord const &record : records) {
+    Triangle &out = chunk.triangles.emplace_back();
+    for (size_t k = 0; k < 3; k++) {
+      auto [it, inserted] =
+          local.try_emplace(record.vertices[k], static_cast<uint32_t>(chunk.weldIds.size()));
+      if (inserted) {
+        double const *p = record.corners.data() + 3 * k;
+        chunk.positions.insert(chunk.positions.end(), {p[0], p[1], p[2]});
+        chunk.weldIds.push_back(record.vertices[k]);
+      }
+      out[k] = it->second;
+    }
+  }
+}
+
+// the locked border is all a chunk shares with its neighbours, so only border vertices are welded
+void _extractChunk(Mesh const &mesh, std::vector<uint32_t> const &sources, Chunk &chunk) {
+  std::vector<uint32_t> remap(mesh.num_vertices());
+  for (Mesh::Vertex_index v : mesh.vertices()) {
+    Kernel::Point_3 const &p = mesh.point(v);
+    remap[v]                 = static_cast<uint32_t>(chunk.weldIds.size());
+    chunk.positions.insert(chunk.positions.end(), {p.x(), p.y(), p.z()});
+    chunk.weldIds.push_back(mesh.is_border(v) ? sources[v] : kNoWeld);
+  }
+  for (Mesh::Face_index f : mesh.faces()) {
+    Triangle &out = chunk.triangles.emplace_back();
+    size_t k      = 0;
+    for (Mesh::Vertex_index v : vertices_around_face(mesh.halfedge(f), mesh)) {
+      out[k++] = remap[v];
+    }
+  }
+}
+
+// simplifies one bucket in core with its border locked and writes what is left, a bucket that is
+// not a valid mesh on its own (a fan touching another in one vertex) goes through untouched
+bool _simplifyBucket(Run &run, std::string const &filePath, size_t faceCount) {
+  Instrument::Zone zone("sms.outOfCore.chunk");
+
+  std::vector<FaceRecord> records;
+  records.reserve(faceCount);
+  bool const ok = _forEachBlock(filePath, [&](FaceRecord const *block, size_t count) {
+    records.insert(records.end(), block, block + count);
+  });
+  std::error_code error;
+  std::filesystem::remove(filePath, error);
+  if (!ok) {
+    return false;
+  }
+
+  Mesh mesh;
+  std::vector<uint32_t> sources;
+  sources.reserve(records.size());
+  std::unordered_map<uint32_t, Mesh::Vertex_index> local;
+  local.reserve(records.size());
+
+  bool valid = true;
+  for (size_t i = 0; i < records.size() && valid; i++) {
+    std::array<Mesh::Vertex_index, 3> corners;
+    for (size_t k = 0; k < 3; k++) {
+      auto [it, inserted] = local.try_emplace(records[i].vertices[k]);
+      if (inserted) {
+        double const *p = records[i].corners.data() + 3 * k;
+        it->second      = mesh.add_vertex(Kernel::Point_3(p[0], p[1], p[2]));
+        sources.push_back(records[i].vertices[k]);
+      }
+      corners[k] = it->second;
+    }
+    valid = mesh.add_face(corners[0], corners[1], corners[2]) != Mesh::null_face();
+  }
+  valid = valid && CGAL::is_valid_polygon_mesh(mesh);
+  local = {};
+
+  Chunk chunk;
+  if (valid) {
+    // each chunk gets its share of the target, the final pass settles the exact count
+    size_t const share =
+        std::max<size_t>(1, run.outputFaceCount * records.size() / run.faceCount);
+    records = {};
+    MeshSimplification::simplifyPatch(mesh, share, run.policy, run.boundNormalChange);
+    _extractChunk(mesh, sources, chunk);
+  } else {
+    ++run.passedThroughCount;
+    _passThrough(records, chunk);
+  }
+
+  std::string const chunkFilePath =
+      run.scratchPrefix + "chunk" + std::to_string(run.chunkFilePaths.size()) + ".bin";
+  run.chunkFilePaths.push_back(chunkFilePath);
+  return _writeChunk(chunkFilePath, chunk);
+}
+
+bool _processBucket(Run &run, std::string const &filePath, size_t faceCount, int depth);
+
+// an oversized bucket is cut in eight by the box of its centroids, dense regions of the input
+// end up in smaller cells this way
+bool _splitBucket(Run &run, std::string const &filePath, int depth) {
+  Vector lower;
+  Vector upper;
+  lower.fill(std::numeric_limits<double>::max());
+  upper.fill(std::numeric_limits<double>::lowest());
+  bool ok = _forEachBlock(filePath, [&](FaceRecord const *block, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      _extend(lower, upper, _centroid(block[i]));
+    }
+  });
+
+  Grid const grid(lower, upper, 2);
+  BucketWriter children(filePath.substr(0, filePath.size() - 4) + ".", grid.cellCount(),
+                        kStreamBatchSize / grid.cellCount());
+
+  bool written          = true;
+  auto const distribute = [&](FaceRecord const *block, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      written = children.add(grid.cellOf(_centroid(block[i])), block[i]) && written;
+    }
+  };
+  ok = ok && _forEachBlock(filePath, distribute);
+  ok = children.flush() && written && ok;
+  std::error_code error;
+  std::filesystem::remove(filePath, error);
+
+  for (size_t cell = 0; cell < children.cellCount() && ok; cell++) {
+    if (children.faceCount(cell) > 0) {
+      ok = _processBucket(run, children.path(cell), children.faceCount(cell), depth + 1);
+    }
+  }
+  return ok;
+}
+
+bool _processBucket(Run &run, std::string const &filePath, size_t faceCount, int depth) {
+  if (faceCount > run.chunkFaceBudget && depth < kMaxSplitDepth) {
+    return _splitBucket(run, filePath, depth);
+  }
+  return _simplifyBucket(run, filePath, faceCount);
+}
+
+// welds the chunks back into one indexed mesh, chunk files are removed as they are read
+bool _stitch(std::vector<std::string> const &chunkFilePaths, Io::MeshBuffer &buffer) {
+  Instrument::Zone zone("sms.outOfCore.stitch");
+
+  std::unordered_map<uint32_t, uint32_t> welded;
+  for (std::string const &chunkFilePath : chunkFilePaths) {
+    std::optional<Chunk> chunk = _readChunk(chunkFilePath);
+    std::error_code error;
+    std::filesystem::remove(chunkFilePath, error);
+    if (chunk == std::nullopt) {
+      return false;
+    }
+
+    std::vector<uint32_t> remap(chunk->weldIds.size());
+    for (size_t v = 0; v < chunk->weldIds.size(); v++) {
+      uint32_t const next = static_cast<uint32_t>(buffer.vertexCount());
+      remap[v]            = next;
+      if (chunk->weldIds[v] != kNoWeld) {
+        auto [it, inserted] = welded.try_emplace(chunk->weldIds[v], next);
+        remap[v]            = it->second;
+        if (!inserted) {
+          continue;
+        }
+      }
+      buffer.positions.insert(buffer.positions.end(), chunk->positions.begin() + 3 * v,
+                              chunk->positions.begin() + 3 * v + 3);
+    }
+    for (Triangle const &triangle : chunk->triangles) {
+      for (uint32_t vertex : triangle) {
+        buffer.indices.push_back(remap[vertex]);
+      }
+      buffer.faceOffsets.push_back(static_cast<uint32_t>(buffer.indices.size()));
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+namespace MeshSimplification {
+
+bool simplifyOutOfCore(std::string const &inputFilePath, std::string const &outputFilePath,
+                       size_t outputFaceCount, GarlandHeckbertPolicy policy,
+                       OutOfCoreOptions const &options) {
+  Instrument::Zone zone("sms.outOfCore");
+
+  if (!Io::hasExtension(inputFilePath, ".obj")) {
+    std::cerr << "Out-of-core simplification reads OBJ only (" << inputFilePath << ")"
+              << std::endl;
+    return false;
+  }
+
+  ScratchDirectory const scratch(outputFilePath + ".chunks");
+
+  Run run;
+  run.outputFaceCount   = outputFaceCount;
+  run.chunkFaceBudget   = std::max<size_t>(1, options.memoryBudgetBytes / (2 * kBytesPerFace));
+  run.policy            = policy;
+  run.boundNormalChange = options.boundNormalChange;
+  run.scratchPrefix     = scratch.path + "/";
+
+  std::string const positionFilePath = run.scratchPrefix + "positions.bin";
+  Vector lower;
+  Vector upper;
+  if (!_spillPositions(inputFilePath, positionFilePath, run, lower, upper)) {
+    return false;
+  }
+  if (run.vertexCount >= kNoWeld || run.faceCount == 0) {
+    std::cerr << "Cannot simplify (" << inputFilePath << ") with " << run.vertexCount
+              << " vertices and " << run.faceCount << " faces out of core" << std::endl;
+    return false;
+  }
+
+  // the bucket buffers take at most a quarter of the budget
+  size_t const bucketCount  = (run.faceCount + run.chunkFaceBudget - 1) / run.chunkFaceBudget;
+  size_t const cellsPerAxis = static_cast<size_t>(std::ceil(std::cbrt(double(bucketCount))));
+  Grid const grid(lower, upper, cellsPerAxis);
+  size_t const bufferSize =
+      std::clamp<size_t>(options.memoryBudgetBytes / 4 / sizeof(FaceRecord) / grid.cellCount(),
+                         256, kStreamBatchSize);
+  BucketWriter buckets(run.scratchPrefix + "bucket", grid.cellCount(), bufferSize);
+  {
+    // read back at random while binning, through a window of another quarter of the budget so
+    // the resident size does not follow the input, the buckets carry their positions from here
+    PositionWindow window(positionFilePath, run.vertexCount, options.memoryBudgetBytes / 4);
+    if (!window.isOpen()) {
+      std::cerr << "Cannot open positions (" << positionFilePath << ")" << std::endl;
+      return false;
+    }
+    if (!_binFaces(inputFilePath, run, grid, window, buckets)) {
+      return false;
+    }
+    Instrument::count("sms.outOfCore.positionPages", static_cast<int64_t>(window.loadCount()));
+  }
+  std::error_code error;
+  std::filesystem::remove(positionFilePath, error);
+  std::cout << "Binned " << run.faceCount << " faces into " << grid.cellCount() << " buckets"
+            << std::endl;
+
+  for (size_t cell = 0; cell < buckets.cellCount(); cell++) {
+    if (buckets.faceCount(cell) > 0 &&
+        !_processBucket(run, buckets.path(cell), buckets.faceCount(cell), 0)) {
+      return false;
+    }
+  }
+  std::cout << "Simplified " << run.chunkFilePaths.size() << " chunks, "
+            << run.passedThroughCount << " passed through as they are not valid meshes"
+            << std::endl;
+
+  Mesh mesh;
+  {
+    Io::MeshBuffer buffer;
+    if (!_stitch(run.chunkFilePaths, buffer) || !Io::buildSurfaceMesh(buffer.view(), mesh)) {
+      std::cerr << "Cannot stitch chunks" << std::endl;
+      return false;
+    }
+  }
+  std::cout << "Stitched: " << mesh.number_of_faces() << " faces" << std::endl;
+  if (mesh.number_of_faces() * kBytesPerFace > options.memoryBudgetBytes) {
+    std::cerr << "Stitched mesh is over the memory budget, the final pass may exceed it"
+              << std::endl;
+  }
+
+  // the seams are still at full resolution, one global queue brings them down with the rest
+  simplify(mesh, outputFaceCount, policy, options.boundNormalChange);
+  return Io::writeSurfaceMesh(outputFilePath, mesh);
+}
+
+void streamingCollapse(std::string const &filename, size_t outputFaceCount,
+                       GarlandHeckbertPolicy policy, size_t memoryBudgetMiB) {
+  std::string const inputFilePath  = Io::makeFullInputPath(filename);
+  std::string const outputFilePath = Io::makeFullOutputPath(filename);
+
+  OutOfCoreOptions options;
+  options.memoryBudgetBytes = memoryBudgetMiB << 20;
+
+  Memory::resetPeakResident();
+  if (!simplifyOutOfCore(inputFilePath, outputFilePath, outputFaceCount, policy, options)) {
+    return;
+  }
+
+  std::cout << "Simplified mesh written to path (" << outputFilePath << "), peak memory "
+            << Memory::peakResidentBytes() / (1024.0 * 1024.0) << " MiB of a " << memoryBudgetMiB
+            << " MiB budget" << std::endl;
+}
+
+} // namespace MeshSimplification
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "MeshSimplification.hpp"
+
+#include <string>
+
+namespace MeshSimplification {
+
+struct OutOfCoreOptions {
+  // what the chunks and the final pass are sized for, the input size does not matter
+  size_t memoryBudgetBytes = size_t(1) << 30;
+
+  bool boundNormalChange = true;
+};
+
+// simplifies an OBJ that does not fit in memory, the input is streamed twice, once to spill the
+// positions to a scratch file and once to bin the faces by centroid into spatial buckets sized
+// for the budget, the faces take their corner positions along, read back through a bounded
+// window, each bucket is then simplified alone with its borders locked and written out,
+// the much smaller stitched result gets a final in-core pass down to outputFaceCount, scratch
+// files live next to the output and are removed afterwards
+bool simplifyOutOfCore(std::string const &inputFilePath, std::string const &outputFilePath,
+                       size_t outputFaceCount, GarlandHeckbertPolicy policy,
+                       OutOfCoreOptions const &options);
+
+// simplifyOutOfCore between the input and output folders, reporting the peak memory
+void streamingCollapse(std::string const &filename, size_t outputFaceCount,
+                       GarlandHeckbertPolicy policy, size_t memoryBudgetMiB);
+
+} // namespace MeshSimplification
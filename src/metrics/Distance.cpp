@@ -0,0 +1,214 @@
+#include "Distance.hpp"
+
+#include <CGAL/AABB_face_graph_triangle_primitive.h>
+#include <CGAL/AABB_traits.h>
+#include <CGAL/AABB_tree.h>
+#include <CGAL/Polygon_mesh_processing/bbox.h>
+
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/Timing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef Mesh::Face_index Face_index;
+typedef CGAL::AABB_face_graph_triangle_primitive<Mesh> Primitive;
+typedef CGAL::AABB_traits<Kernel, Primitive> AabbTraits;
+typedef CGAL::AABB_tree<AabbTraits> AabbTree;
+
+// points or faces per parallel task
+size_t constexpr kBlockSize = 4096;
+// fixed so two runs over the same meshes report the same distances
+uint32_t constexpr kSeed = 0x5eed;
+
+size_t _blockCount(size_t count) { return (count + kBlockSize - 1) / kBlockSize; }
+
+// every vertex plus sampleCount points spread over the faces by area, a face gets its share
+// give or take one and its points are uniform inside it
+std::vector<Kernel::Point_3> _samplePoints(Mesh const &mesh, size_t sampleCount) {
+  Instrument::Zone zone("metrics.distance.sample");
+
+  std::vector<Face_index> const faces(mesh.faces().begin(), mesh.faces().end());
+  std::vector<double> areas(faces.size());
+  ThreadPool &pool = ThreadPool::global();
+  pool.parallelFor(_blockCount(faces.size()), [&](size_t block) {
+    size_t const end = std::min(faces.size(), (block + 1) * kBlockSize);
+    for (size_t i = block * kBlockSize; i < end; i++) {
+      Mesh::Halfedge_index const h = mesh.halfedge(faces[i]);
+      areas[i] = std::sqrt(CGAL::squared_area(mesh.point(mesh.source(h)),
+                                              mesh.point(mesh.target(h)),
+                                              mesh.point(mesh.target(mesh.next(h)))));
+    }
+  });
+
+  double totalArea = 0.0;
+  for (double area : areas) {
+    totalArea += area;
+  }
+
+  // samples of face i go to [offsets[i], offsets[i + 1]), after the vertices
+  size_t const vertexCount = mesh.number_of_vertices();
+  double const scale       = totalArea > 0.0 ? static_cast<double>(sampleCount) / totalArea : 0.0;
+  std::vector<size_t> offsets(faces.size() + 1, vertexCount);
+  double cumulativeArea = 0.0;
+  for (size_t i = 0; i < faces.size(); i++) {
+    cumulativeArea += areas[i];
+    size_t const share = static_cast<size_t>(cumulativeArea * scale);
+    offsets[i + 1]     = vertexCount + std::min(sampleCount, share);
+  }
+
+  std::vector<Kernel::Point_3> samples(offsets.back());
+  size_t next = 0;
+  for (Mesh::Vertex_index v : mesh.vertices()) {
+    samples[next++] = mesh.point(v);
+  }
+
+  pool.parallelFor(_blockCount(faces.size()), [&](size_t block) {
+    std::mt19937 generator(kSeed + static_cast<uint32_t>(block));
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    size_t const end = std::min(faces.size(), (block + 1) * kBlockSize);
+    for (size_t i = block * kBlockSize; i < end; i++) {
+      Mesh::Halfedge_index const h = mesh.halfedge(faces[i]);
+      Kernel::Point_3 const &a     = mesh.point(mesh.source(h));
+      Kernel::Vector_3 const ab    = mesh.point(mesh.target(h)) - a;
+      Kernel::Vector_3 const ac    = mesh.point(mesh.target(mesh.next(h))) - a;
+      for (size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+        double const r1 = std::sqrt(unit(generator));
+        double const r2 = unit(generator);
+        samples[k]      = a + (r1 * (1.0 - r2)) * ab + (r1 * r2) * ac;
+      }
+    }
+  });
+  return samples;
+}
+
+struct DistanceSummary {
+  double maxSquared = 0.0;
+  double sumSquared = 0.0;
+};
+
+DistanceSummary _query(AabbTree const &tree, std::vector<Kernel::Point_3> const &points) {
+  Instrument::Zone zone("metrics.distance.query");
+
+  std::vector<DistanceSummary> summaries(_blockCount(points.size()));
+  ThreadPool::global().parallelFor(summaries.size(), [&](size_t block) {
+    DistanceSummary &summary = summaries[block];
+    size_t const end         = std::min(points.size(), (block + 1) * kBlockSize);
+    for (size_t i = block * kBlockSize; i < end; i++) {
+      double const squared = tree.squared_distance(points[i]);
+      summary.maxSquared   = std::max(summary.maxSquared, squared);
+      summary.sumSquared += squared;
+    }
+  });
+
+  DistanceSummary total;
+  for (DistanceSummary const &summary : summaries) {
+    total.maxSquared = std::max(total.maxSquared, summary.maxSquared);
+    total.sumSquared += summary.sumSquared;
+  }
+  return total;
+}
+
+// complete, search structure included, so _query's blocks only read it and its cost lands in
+// buildTime rather than in the first block's queryTime
+void _buildTree(Mesh const &mesh, AabbTree &tree) {
+  Instrument::Zone zone("metrics.distance.build");
+
+  tree.insert(faces(mesh).first, faces(mesh).second, mesh);
+  tree.build();
+  tree.accelerate_distance_queries();
+}
+
+} // namespace
+
+namespace Metrics {
+
+// the tree points into the mesh, both live behind one pointer so moving the oracle keeps them
+struct DistanceOracle::Reference {
+  Mesh mesh;
+  AabbTree tree;
+  std::vector<Kernel::Point_3> samples;
+  double diagonal = 0.0;
+};
+
+DistanceOracle::DistanceOracle(Mesh const &reference, size_t sampleCount)
+    : mReference(std::make_unique<Reference>()) {
+  auto start = Timing::Clock::now();
+
+  mReference->mesh = reference;
+  if (reference.number_of_faces() != 0) {
+    _buildTree(mReference->mesh, mReference->tree);
+    mReference->samples = _samplePoints(mReference->mesh, sampleCount);
+
+    CGAL::Bbox_3 const box = CGAL::Polygon_mesh_processing::bbox(reference);
+    mReference->diagonal =
+        std::sqrt(CGAL::square(box.xmax() - box.xmin()) + CGAL::square(box.ymax() - box.ymin()) +
+                  CGAL::square(box.zmax() - box.zmin()));
+  }
+
+  mBuildTime = Timing::secondsSince(start);
+}
+
+DistanceOracle::DistanceOracle(DistanceOracle &&) noexcept = default;
+DistanceOracle::~DistanceOracle()                          = default;
+
+std::optional<DistanceReport> DistanceOracle::measure(Mesh const &mesh, size_t sampleCount) const {
+  Instrument::Zone zone("metrics.distance");
+
+  if (mesh.number_of_faces() == 0 || mReference->samples.empty()) {
+    std::cerr << "Cannot measure the distance of a mesh without faces" << std::endl;
+    return std::nullopt;
+  }
+
+  DistanceReport report;
+  report.referenceDiagonal = mReference->diagonal;
+
+  auto start                                 = Timing::Clock::now();
+  std::vector<Kernel::Point_3> const samples = _samplePoints(mesh, sampleCount);
+  report.sampleTime                          = Timing::secondsSince(start);
+
+  start = Timing::Clock::now();
+  AabbTree tree;
+  _buildTree(mesh, tree);
+  report.buildTime = Timing::secondsSince(start);
+
+  start                          = Timing::Clock::now();
+  DistanceSummary const forward  = _query(mReference->tree, samples);
+  DistanceSummary const backward = _query(tree, mReference->samples);
+  report.queryTime               = Timing::secondsSince(start);
+
+  report.forwardSampleCount  = samples.size();
+  report.backwardSampleCount = mReference->samples.size();
+  report.forwardHausdorff    = std::sqrt(forward.maxSquared);
+  report.backwardHausdorff   = std::sqrt(backward.maxSquared);
+  report.symmetricHausdorff  = std::max(report.forwardHausdorff, report.backwardHausdorff);
+
+  double const forwardCount  = static_cast<double>(report.forwardSampleCount);
+  double const backwardCount = static_cast<double>(report.backwardSampleCount);
+  report.forwardRms          = std::sqrt(forward.sumSquared / forwardCount);
+  report.backwardRms         = std::sqrt(backward.sumSquared / backwardCount);
+  return report;
+}
+
+void printReport(DistanceReport const &report) {
+  double const diagonal = report.referenceDiagonal > 0.0 ? report.referenceDiagonal : 1.0;
+  std::cout << "Hausdorff: " << report.forwardHausdorff << " forward, " << report.backwardHausdorff
+            << " backward, " << report.symmetricHausdorff << " symmetric ("
+            << report.symmetricHausdorff / diagonal << " of the diagonal)" << std::endl;
+  std::cout << "RMS: " << report.forwardRms << " forward, " << report.backwardRms << " backward"
+            << std::endl;
+  std::cout << "Samples: " << report.forwardSampleCount << " forward, "
+            << report.backwardSampleCount << " backward" << std::endl;
+  std::cout << "Distance time: " << report.sampleTime << "s sampling, " << report.buildTime
+            << "s tree, " << report.queryTime << "s queries" << std::endl;
+}
+
+} // namespace Metrics
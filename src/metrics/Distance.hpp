@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common/Mesh.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+namespace Metrics {
+
+// forward goes from the measured mesh to the reference, backward the other way, sample counts
+// include the vertices
+struct DistanceReport {
+  size_t forwardSampleCount  = 0;
+  size_t backwardSampleCount = 0;
+
+  double forwardHausdorff   = 0.0;
+  double backwardHausdorff  = 0.0;
+  double symmetricHausdorff = 0.0;
+  double forwardRms         = 0.0;
+  double backwardRms        = 0.0;
+
+  // bounding box diagonal of the reference, to read the distances relative to the model size
+  double referenceDiagonal = 0.0;
+
+  // seconds, the reference side is built once by the oracle and not counted
+  double sampleTime = 0.0;
+  double buildTime  = 0.0;
+  double queryTime  = 0.0;
+};
+
+// approximate Hausdorff and RMS distances to one reference mesh, the reference is copied, sampled
+// and put in an AABB tree once so every measurement only samples the measured mesh and builds
+// its tree, sampling and queries run in parallel blocks
+class DistanceOracle {
+public:
+  // sampleCount area weighted points on top of the vertices
+  explicit DistanceOracle(Mesh const &reference, size_t sampleCount = 100000);
+  DistanceOracle(DistanceOracle &&) noexcept;
+  ~DistanceOracle();
+
+  // nullopt if the mesh has no faces, sampleCount as for the reference
+  [[nodiscard]] std::optional<DistanceReport> measure(Mesh const &mesh,
+                                                      size_t sampleCount = 100000) const;
+
+  // seconds spent copying, sampling and indexing the reference
+  [[nodiscard]] double buildTime() const { return mBuildTime; }
+
+private:
+  struct Reference;
+  std::unique_ptr<Reference> mReference;
+  double mBuildTime = 0.0;
+};
+
+void printReport(DistanceReport const &report);
+
+} // namespace Metrics
@@ -0,0 +1,375 @@
+#include "Metrics.hpp"
+
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/defines.hpp"
+#include "io/Io.hpp"
+#include "io/SurfaceMeshIo.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <optional>
+
+namespace {
+
+// faces per task, large enough to amortize scheduling and small enough to balance
+size_t constexpr kBlockSize = 16384;
+
+// per face results of the vectorized pass, kept as arrays for the same reason as the triangles
+template <typename Real> struct FaceValues {
+  std::vector<Real> minCos;
+  std::vector<Real> maxCos;
+  std::vector<Real> area;
+  std::vector<Real> edge0, edge1, edge2;
+  std::vector<uint8_t> flags;
+};
+
+uint8_t constexpr kCapFlag        = 1;
+uint8_t constexpr kNeedleFlag     = 2;
+uint8_t constexpr kDegenerateFlag = 4;
+
+struct BlockSummary {
+  double minCos       = std::numeric_limits<double>::max();
+  double maxCos       = std::numeric_limits<double>::lowest();
+  double aspectSum    = 0.0;
+  double maxAspect    = 0.0;
+  double areaSum      = 0.0;
+  double minEdge      = std::numeric_limits<double>::max();
+  double maxEdge      = 0.0;
+  double minArea      = std::numeric_limits<double>::max();
+  double maxArea      = 0.0;
+  size_t regularCount = 0;
+};
+
+// straight-line arithmetic without branches or calls that set errno, the arrays are __restrict
+// parameters because the compiler gives up on vectorizing rather than check every pair at runtime
+template <typename Real>
+void _faceKernel(size_t count, Real const *__restrict ax, Real const *__restrict ay,
+                 Real const *__restrict az, Real const *__restrict bx, Real const *__restrict by,
+                 Real const *__restrict bz, Real const *__restrict cx, Real const *__restrict cy,
+                 Real const *__restrict cz, Real *__restrict minCos, Real *__restrict maxCos,
+                 Real *__restrict area, Real *__restrict edge0, Real *__restrict edge1,
+                 Real *__restrict edge2) {
+  for (size_t i = 0; i < count; i++) {
+    Real const abx = bx[i] - ax[i];
+    Real const aby = by[i] - ay[i];
+    Real const abz = bz[i] - az[i];
+    Real const bcx = cx[i] - bx[i];
+    Real const bcy = cy[i] - by[i];
+    Real const bcz = cz[i] - bz[i];
+    Real const cax = ax[i] - cx[i];
+    Real const cay = ay[i] - cy[i];
+    Real const caz = az[i] - cz[i];
+
+    Real const nx = aby * bcz - abz * bcy;
+    Real const ny = abz * bcx - abx * bcz;
+    Real const nz = abx * bcy - aby * bcx;
+    Real const ab = std::sqrt(abx * abx + aby * aby + abz * abz);
+    Real const bc = std::sqrt(bcx * bcx + bcy * bcy + bcz * bcz);
+    Real const ca = std::sqrt(cax * cax + cay * cay + caz * caz);
+
+    // the angle at a corner is between the two edges leaving it
+    Real const cosA = -(abx * cax + aby * cay + abz * caz) / (ab * ca);
+    Real const cosB = -(abx * bcx + aby * bcy + abz * bcz) / (ab * bc);
+    Real const cosC = -(bcx * cax + bcy * cay + bcz * caz) / (bc * ca);
+
+    minCos[i] = std::min(cosA, std::min(cosB, cosC));
+    maxCos[i] = std::max(cosA, std::max(cosB, cosC));
+    area[i]   = Real(0.5) * std::sqrt(nx * nx + ny * ny + nz * nz);
+    edge0[i]  = ab;
+    edge1[i]  = bc;
+    edge2[i]  = ca;
+  }
+}
+
+// flags every face of the block and folds it into one summary
+template <typename Real>
+BlockSummary _summarize(FaceValues<Real> &values, size_t begin, size_t end, double capCos,
+                        double needleRatio) {
+  double const kAspectScale = 1.0 / (4.0 * std::sqrt(3.0));
+
+  BlockSummary summary;
+  for (size_t i = begin; i < end; i++) {
+    double const area     = values.area[i];
+    double const minEdge  = std::min(values.edge0[i], std::min(values.edge1[i], values.edge2[i]));
+    double const maxEdge  = std::max(values.edge0[i], std::max(values.edge1[i], values.edge2[i]));
+    bool const degenerate = !(area > 0.0);
+
+    values.flags[i] = static_cast<uint8_t>((values.minCos[i] < capCos ? kCapFlag : 0) |
+                                           (maxEdge >= needleRatio * minEdge ? kNeedleFlag : 0) |
+                                           (degenerate ? kDegenerateFlag : 0));
+
+    summary.minEdge = std::min(summary.minEdge, minEdge);
+    summary.maxEdge = std::max(summary.maxEdge, maxEdge);
+    summary.minArea = std::min(summary.minArea, area);
+    // degenerate triangles have no meaningful angles or aspect ratio
+    if (degenerate) {
+      continue;
+    }
+
+    double const aspect = maxEdge * (values.edge0[i] + values.edge1[i] + values.edge2[i]) *
+                          kAspectScale / area;
+    summary.minCos    = std::min<double>(summary.minCos, values.minCos[i]);
+    summary.maxCos    = std::max<double>(summary.maxCos, values.maxCos[i]);
+    summary.maxAspect = std::max(summary.maxAspect, aspect);
+    summary.maxArea   = std::max(summary.maxArea, area);
+    summary.aspectSum += aspect;
+    summary.areaSum += area;
+    ++summary.regularCount;
+  }
+  return summary;
+}
+
+size_t _bin(double value, double min, double scale, size_t binCount) {
+  auto const bin = static_cast<size_t>(std::max(0.0, (value - min) * scale));
+  return std::min(bin, binCount - 1);
+}
+
+template <typename Real>
+void _fillHistogram(Metrics::Histogram &histogram, size_t binCount, size_t faceCount,
+                    ThreadPool &pool, std::vector<Real> const *const *arrays, size_t arrayCount) {
+  histogram.counts.assign(binCount, 0);
+  double const range = histogram.max - histogram.min;
+  double const scale = range > 0.0 ? binCount / range : 0.0;
+
+  size_t const blockCount = (faceCount + kBlockSize - 1) / kBlockSize;
+  std::vector<std::vector<size_t>> blockCounts(blockCount, std::vector<size_t>(binCount, 0));
+  pool.parallelFor(blockCount, [&](size_t block) {
+    size_t const begin = block * kBlockSize;
+    size_t const end   = std::min(faceCount, begin + kBlockSize);
+
+    std::vector<size_t> &counts = blockCounts[block];
+    for (size_t a = 0; a < arrayCount; a++) {
+      std::vector<Real> const &values = *arrays[a];
+      for (size_t i = begin; i < end; i++) {
+        ++counts[_bin(values[i], histogram.min, scale, binCount)];
+      }
+    }
+  });
+
+  for (auto const &counts : blockCounts) {
+    for (size_t bin = 0; bin < binCount; bin++) {
+      histogram.counts[bin] += counts[bin];
+    }
+  }
+}
+
+double _degrees(double cosine) { return std::acos(std::clamp(cosine, -1.0, 1.0)) / kDegToRad; }
+
+void _printHistogram(char const *name, Metrics::Histogram const &histogram) {
+  std::cout << name << " histogram [" << histogram.min << ", " << histogram.max << "]:";
+  for (size_t count : histogram.counts) {
+    std::cout << " " << count;
+  }
+  std::cout << std::endl;
+}
+
+template <typename MeshT, typename Real>
+void _extractTriangles(MeshT const &mesh, Metrics::BasicTriangleBuffer<Real> &buffer) {
+  Instrument::Zone zone("metrics.extractTriangles");
+
+  buffer.faces.clear();
+  buffer.faces.reserve(mesh.number_of_faces());
+  for (typename MeshT::Face_index f : mesh.faces()) {
+    if (mesh.degree(f) == 3) {
+      buffer.faces.push_back(f);
+    }
+  }
+
+  size_t const faceCount = buffer.faces.size();
+  for (auto *coordinates : {&buffer.ax, &buffer.ay, &buffer.az, &buffer.bx, &buffer.by, &buffer.bz,
+                            &buffer.cx, &buffer.cy, &buffer.cz}) {
+    coordinates->resize(faceCount);
+  }
+
+  // faces are independent and every write goes to its own slot
+  ThreadPool::global().parallelFor((faceCount + kBlockSize - 1) / kBlockSize, [&](size_t block) {
+    size_t const end = std::min(faceCount, (block + 1) * kBlockSize);
+    for (size_t i = block * kBlockSize; i < end; i++) {
+      typename MeshT::Halfedge_index const h = mesh.halfedge(buffer.faces[i]);
+      typename MeshT::Point const &a         = mesh.point(mesh.source(h));
+      typename MeshT::Point const &b         = mesh.point(mesh.target(h));
+      typename MeshT::Point const &c         = mesh.point(mesh.target(mesh.next(h)));
+      buffer.ax[i]                           = static_cast<Real>(a.x());
+      buffer.ay[i]                           = static_cast<Real>(a.y());
+      buffer.az[i]                           = static_cast<Real>(a.z());
+      buffer.bx[i]                           = static_cast<Real>(b.x());
+      buffer.by[i]                           = static_cast<Real>(b.y());
+      buffer.bz[i]                           = static_cast<Real>(b.z());
+      buffer.cx[i]                           = static_cast<Real>(c.x());
+      buffer.cy[i]                           = static_cast<Real>(c.y());
+      buffer.cz[i]                           = static_cast<Real>(c.z());
+    }
+  });
+}
+
+template <typename Real>
+Metrics::Report _computeMetrics(Metrics::BasicTriangleBuffer<Real> const &buffer,
+                                Metrics::Options const &options) {
+  Instrument::Zone zone("metrics.computeMetrics");
+
+  Metrics::Report report;
+  report.faceCount = buffer.size();
+  if (report.faceCount == 0) {
+    return report;
+  }
+
+  size_t const faceCount  = buffer.size();
+  size_t const blockCount = (faceCount + kBlockSize - 1) / kBlockSize;
+  double const capCos     = std::cos(options.capAngle * kDegToRad);
+
+  FaceValues<Real> values;
+  for (auto *array : {&values.minCos, &values.maxCos, &values.area, &values.edge0, &values.edge1,
+                      &values.edge2}) {
+    array->resize(faceCount);
+  }
+  values.flags.resize(faceCount);
+
+  ThreadPool &pool = ThreadPool::global();
+  std::vector<BlockSummary> summaries(blockCount);
+  pool.parallelFor(blockCount, [&](size_t block) {
+    size_t const begin = block * kBlockSize;
+    size_t const end   = std::min(faceCount, begin + kBlockSize);
+    _faceKernel(end - begin, &buffer.ax[begin], &buffer.ay[begin], &buffer.az[begin],
+                &buffer.bx[begin], &buffer.by[begin], &buffer.bz[begin], &buffer.cx[begin],
+                &buffer.cy[begin], &buffer.cz[begin], &values.minCos[begin], &values.maxCos[begin],
+                &values.area[begin], &values.edge0[begin], &values.edge1[begin],
+                &values.edge2[begin]);
+    summaries[block] = _summarize(values, begin, end, capCos, options.needleRatio);
+  });
+
+  BlockSummary total;
+  for (BlockSummary const &summary : summaries) {
+    total.minCos    = std::min(total.minCos, summary.minCos);
+    total.maxCos    = std::max(total.maxCos, summary.maxCos);
+    total.maxAspect = std::max(total.maxAspect, summary.maxAspect);
+    total.minEdge   = std::min(total.minEdge, summary.minEdge);
+    total.maxEdge   = std::max(total.maxEdge, summary.maxEdge);
+    total.minArea   = std::min(total.minArea, summary.minArea);
+    total.maxArea   = std::max(total.maxArea, summary.maxArea);
+    total.aspectSum += summary.aspectSum;
+    total.areaSum += summary.areaSum;
+    total.regularCount += summary.regularCount;
+  }
+
+  if (total.regularCount > 0) {
+    // the smallest angle has the largest cosine
+    report.minAngle        = _degrees(total.maxCos);
+    report.maxAngle        = _degrees(total.minCos);
+    report.meanAspectRatio = total.aspectSum / total.regularCount;
+    report.maxAspectRatio  = total.maxAspect;
+  }
+  report.totalArea = total.areaSum;
+
+  for (size_t i = 0; i < faceCount; i++) {
+    uint8_t const flags = values.flags[i];
+    if (flags == 0) {
+      continue;
+    }
+    if (flags & kCapFlag) {
+      report.capFaces.push_back(buffer.faces[i]);
+    }
+    if (flags & kNeedleFlag) {
+      report.needleFaces.push_back(buffer.faces[i]);
+    }
+    if (flags & kDegenerateFlag) {
+      report.degenerateFaces.push_back(buffer.faces[i]);
+    }
+  }
+
+  report.edgeLengths.min = total.minEdge;
+  report.edgeLengths.max = total.maxEdge;
+  std::vector<Real> const *edgeArrays[] = {&values.edge0, &values.edge1, &values.edge2};
+  _fillHistogram(report.edgeLengths, options.histogramBinCount, faceCount, pool, edgeArrays, 3);
+
+  report.areas.min = total.minArea;
+  report.areas.max = std::max(total.maxArea, total.minArea);
+  std::vector<Real> const *areaArrays[] = {&values.area};
+  _fillHistogram(report.areas, options.histogramBinCount, faceCount, pool, areaArrays, 1);
+
+  return report;
+}
+
+template <typename MeshT, typename Real>
+void _printReport(std::string const &inputFilePath, Metrics::Options const &options) {
+  auto maybeMesh = Io::loadTriangleMesh<MeshT>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return;
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  Metrics::BasicTriangleBuffer<Real> buffer;
+  _extractTriangles(maybeMesh.value(), buffer);
+  auto extracted = std::chrono::high_resolution_clock::now();
+  Metrics::Report const report = _computeMetrics(buffer, options);
+  auto end                     = std::chrono::high_resolution_clock::now();
+
+  Metrics::printReport(report);
+  std::chrono::duration<double, std::milli> const extractTime = extracted - start;
+  std::chrono::duration<double, std::milli> const computeTime = end - extracted;
+  std::cout << "Extraction: " << extractTime.count() << "ms, metrics: " << computeTime.count()
+            << "ms" << std::endl;
+}
+
+} // namespace
+
+namespace Metrics {
+
+void extractTriangles(Mesh const &mesh, TriangleBuffer &buffer) {
+  _extractTriangles(mesh, buffer);
+}
+
+void extractTriangles(Mesh const &mesh, CompactTriangleBuffer &buffer) {
+  _extractTriangles(mesh, buffer);
+}
+
+void extractTriangles(CompactMesh const &mesh, CompactTriangleBuffer &buffer) {
+  _extractTriangles(mesh, buffer);
+}
+
+Report computeMetrics(TriangleBuffer const &buffer, Options const &options) {
+  return _computeMetrics(buffer, options);
+}
+
+Report computeMetrics(CompactTriangleBuffer const &buffer, Options const &options) {
+  return _computeMetrics(buffer, options);
+}
+
+Report computeMetrics(Mesh const &mesh, Options const &options) {
+  TriangleBuffer buffer;
+  extractTriangles(mesh, buffer);
+  return computeMetrics(buffer, options);
+}
+
+Report computeMetrics(CompactMesh const &mesh, Options const &options) {
+  CompactTriangleBuffer buffer;
+  extractTriangles(mesh, buffer);
+  return computeMetrics(buffer, options);
+}
+
+void printReport(Report const &report) {
+  std::cout << report.faceCount << " triangles, area " << report.totalArea << std::endl;
+  std::cout << "Angles: min " << report.minAngle << ", max " << report.maxAngle << std::endl;
+  std::cout << "Aspect ratio: mean " << report.meanAspectRatio << ", max "
+            << report.maxAspectRatio << std::endl;
+  std::cout << report.capFaces.size() << " cap triangles found." << std::endl;
+  std::cout << report.needleFaces.size() << " needle triangles found." << std::endl;
+  std::cout << report.degenerateFaces.size() << " degenerate triangles found." << std::endl;
+  _printHistogram("Edge length", report.edgeLengths);
+  _printHistogram("Area", report.areas);
+}
+
+void printReport(std::string const &filename, Options const &options, bool compact) {
+  std::string const inputFilePath = Io::makeFullInputPath(filename);
+  if (compact) {
+    _printReport<CompactMesh, float>(inputFilePath, options);
+  } else {
+    _printReport<Mesh, double>(inputFilePath, options);
+  }
+}
+
+} // namespace Metrics
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "common/Mesh.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Metrics {
+
+// the corners of every triangle as separate coordinate arrays, so the kernels stream through
+// contiguous memory and the compiler can vectorize them, float halves the bytes streamed per
+// triangle and doubles the lanes per vector
+template <typename Real> struct BasicTriangleBuffer {
+  std::vector<Real> ax, ay, az;
+  std::vector<Real> bx, by, bz;
+  std::vector<Real> cx, cy, cz;
+  std::vector<Mesh::Face_index> faces;
+
+  [[nodiscard]] size_t size() const { return faces.size(); }
+};
+
+typedef BasicTriangleBuffer<double> TriangleBuffer;
+typedef BasicTriangleBuffer<float> CompactTriangleBuffer;
+
+// non-triangle faces are skipped
+void extractTriangles(Mesh const &mesh, TriangleBuffer &buffer);
+void extractTriangles(Mesh const &mesh, CompactTriangleBuffer &buffer);
+void extractTriangles(CompactMesh const &mesh, CompactTriangleBuffer &buffer);
+
+struct Options {
+  // a triangle with an angle above capAngle (degrees) is a cap, as PMP::is_cap_triangle_face
+  double capAngle = 160.0;
+  // longest over shortest edge at or above needleRatio is a needle, as PMP::is_needle_triangle_face
+  double needleRatio = 4.0;
+  size_t histogramBinCount = 20;
+};
+
+// bins are spread evenly over [min, max]
+struct Histogram {
+  double min = 0.0;
+  double max = 0.0;
+  std::vector<size_t> counts;
+};
+
+struct Report {
+  size_t faceCount = 0;
+
+  // degrees
+  double minAngle = 0.0;
+  double maxAngle = 0.0;
+
+  // longest edge times perimeter over 4 sqrt(3) area, 1 for an equilateral triangle
+  double meanAspectRatio = 0.0;
+  double maxAspectRatio  = 0.0;
+
+  double totalArea = 0.0;
+
+  // flagged faces in face order, a flat triangle with a straight angle is both a cap and degenerate
+  std::vector<Mesh::Face_index> capFaces;
+  std::vector<Mesh::Face_index> needleFaces;
+  std::vector<Mesh::Face_index> degenerateFaces;
+
+  // every triangle contributes its three edges, so interior edges are counted twice
+  Histogram edgeLengths;
+  Histogram areas;
+};
+
+Report computeMetrics(TriangleBuffer const &buffer, Options const &options);
+// per face values in float and totals in double, a triangle within float rounding of the cap or
+// needle threshold may be flagged differently than in double
+Report computeMetrics(CompactTriangleBuffer const &buffer, Options const &options);
+Report computeMetrics(Mesh const &mesh, Options const &options);
+Report computeMetrics(CompactMesh const &mesh, Options const &options);
+
+void printReport(Report const &report);
+
+// loads the file, times the extraction and the kernels separately and prints the report, compact
+// loads a CompactMesh and runs the float kernels
+void printReport(std::string const &filename, Options const &options, bool compact = false);
+
+} // namespace Metrics
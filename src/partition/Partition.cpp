@@ -0,0 +1,177 @@
+#include "Partition.hpp"
+
+#include <CGAL/boost/graph/helpers.h>
+
+#include "io/MeshBuffer.hpp"
+#include "io/SurfaceMeshIo.hpp"
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+namespace {
+
+struct Centroid {
+  std::array<double, 3> position;
+  Partition::Face_index face;
+};
+
+void _splitRecursive(std::vector<Centroid>::iterator begin, std::vector<Centroid>::iterator end,
+                     size_t patchCount, std::vector<std::vector<Partition::Face_index>> &groups) {
+  if (patchCount <= 1 || end - begin <= 1) {
+    std::vector<Partition::Face_index> &group = groups.emplace_back();
+    group.reserve(end - begin);
+    for (auto it = begin; it != end; ++it) {
+      group.push_back(it->face);
+    }
+    return;
+  }
+
+  std::array<double, 3> lower = begin->position;
+  std::array<double, 3> upper = begin->position;
+  for (auto it = begin; it != end; ++it) {
+    for (int axis = 0; axis < 3; axis++) {
+      lower[axis] = std::min(lower[axis], it->position[axis]);
+      upper[axis] = std::max(upper[axis], it->position[axis]);
+    }
+  }
+  int axis = 0;
+  for (int i = 1; i < 3; i++) {
+    if (upper[i] - lower[i] > upper[axis] - lower[axis]) {
+      axis = i;
+    }
+  }
+
+  // uneven patch counts split the faces in the same ratio as the patches
+  size_t const lowerPatchCount = patchCount / 2;
+  auto const middle            = begin + (end - begin) * lowerPatchCount / patchCount;
+  std::nth_element(begin, middle, end, [axis](Centroid const &a, Centroid const &b) {
+    return a.position[axis] < b.position[axis];
+  });
+
+  _splitRecursive(begin, middle, lowerPatchCount, groups);
+  _splitRecursive(middle, end, patchCount - lowerPatchCount, groups);
+}
+
+} // namespace
+
+namespace Partition {
+
+std::vector<std::vector<Face_index>> splitFaces(Mesh const &mesh, size_t patchCount) {
+  std::vector<Centroid> centroids;
+  centroids.reserve(mesh.number_of_faces());
+  for (Face_index f : mesh.faces()) {
+    Centroid centroid{{0.0, 0.0, 0.0}, f};
+    int cornerCount = 0;
+    for (Vertex_index v : vertices_around_face(mesh.halfedge(f), mesh)) {
+      Kernel::Point_3 const &p = mesh.point(v);
+      centroid.position[0] += p.x();
+      centroid.position[1] += p.y();
+      centroid.position[2] += p.z();
+      ++cornerCount;
+    }
+    for (double &coordinate : centroid.position) {
+      coordinate /= cornerCount;
+    }
+    centroids.push_back(centroid);
+  }
+
+  std::vector<std::vector<Face_index>> groups;
+  groups.reserve(patchCount);
+  if (!centroids.empty()) {
+    _splitRecursive(centroids.begin(), centroids.end(), std::max<size_t>(1, patchCount), groups);
+  }
+  return groups;
+}
+
+std::optional<Patch> extractPatch(Mesh const &mesh, std::vector<Face_index> const &faces) {
+  Patch patch;
+  patch.mesh.set_recycle_garbage(false);
+  patch.mesh.reserve(faces.size(), 2 * faces.size(), faces.size());
+  patch.sourceVertices.reserve(faces.size());
+  std::unordered_map<Vertex_index, Vertex_index> patchVertices;
+  patchVertices.reserve(faces.size());
+
+  std::vector<Vertex_index> faceVertices;
+  for (Face_index f : faces) {
+    faceVertices.clear();
+    for (Vertex_index v : vertices_around_face(mesh.halfedge(f), mesh)) {
+      auto [it, inserted] = patchVertices.try_emplace(v);
+      if (inserted) {
+        it->second = patch.mesh.add_vertex(mesh.point(v));
+        patch.sourceVertices.push_back(v);
+      }
+      faceVertices.push_back(it->second);
+    }
+    if (patch.mesh.add_face(faceVertices) == Mesh::null_face()) {
+      return std::nullopt;
+    }
+  }
+
+  if (!CGAL::is_valid_polygon_mesh(patch.mesh)) {
+    return std::nullopt;
+  }
+  return patch;
+}
+
+Vertex_index sourceVertex(Patch const &patch, Vertex_index v) {
+  return v < patch.sourceVertices.size() ? patch.sourceVertices[v] : Mesh::null_vertex();
+}
+
+bool mergePatches(std::vector<Patch> const &patches, Mesh &mesh,
+                  std::vector<Vertex_index> *seamVertices) {
+  Io::MeshBuffer buffer;
+
+  // source vertex -> merged index, only border vertices can be met by more than one patch
+  std::unordered_map<Vertex_index, uint32_t> welded;
+  std::vector<bool> isSeam;
+
+  for (Patch const &patch : patches) {
+    Mesh const &patchMesh = patch.mesh;
+
+    std::vector<uint32_t> remap(patchMesh.num_vertices());
+    for (Vertex_index v : patchMesh.vertices()) {
+      Vertex_index const sourceV = sourceVertex(patch, v);
+      if (sourceV != Mesh::null_vertex() && patchMesh.is_border(v)) {
+        auto [it, inserted] = welded.try_emplace(sourceV, static_cast<uint32_t>(isSeam.size()));
+        remap[v]            = it->second;
+        if (!inserted) {
+          isSeam[it->second] = true;
+          continue;
+        }
+      } else {
+        remap[v] = static_cast<uint32_t>(isSeam.size());
+      }
+
+      Kernel::Point_3 const &p = patchMesh.point(v);
+      buffer.positions.insert(buffer.positions.end(), {p.x(), p.y(), p.z()});
+      isSeam.push_back(false);
+    }
+
+    for (Face_index f : patchMesh.faces()) {
+      for (Vertex_index v : vertices_around_face(patchMesh.halfedge(f), patchMesh)) {
+        buffer.indices.push_back(remap[v]);
+      }
+      buffer.faceOffsets.push_back(static_cast<uint32_t>(buffer.indices.size()));
+    }
+  }
+
+  if (!Io::buildSurfaceMesh(buffer.view(), mesh)) {
+    return false;
+  }
+
+  // buildSurfaceMesh adds vertices in buffer order unless it had to repair the soup
+  if (seamVertices != nullptr) {
+    seamVertices->clear();
+    if (mesh.number_of_vertices() == isSeam.size()) {
+      for (size_t i = 0; i < isSeam.size(); i++) {
+        if (isSeam[i]) {
+          seamVertices->push_back(Vertex_index(static_cast<Mesh::size_type>(i)));
+        }
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace Partition
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "common/Mesh.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace Partition {
+
+typedef Mesh::Vertex_index Vertex_index;
+typedef Mesh::Face_index Face_index;
+
+// a standalone copy of some faces of a larger mesh, sourceVertices maps the patch vertices back,
+// garbage recycling is off so vertices added later never inherit a stale source
+struct Patch {
+  Mesh mesh;
+  std::vector<Vertex_index> sourceVertices;
+};
+
+// groups faces into patchCount spatially coherent sets of similar size, by recursive median
+// splits of the face centroids along the longest axis
+std::vector<std::vector<Face_index>> splitFaces(Mesh const &mesh, size_t patchCount);
+
+// copies faces into a patch, nullopt if the selection is not a valid polygon mesh on its own (for
+// example two fans touching in a single vertex)
+std::optional<Patch> extractPatch(Mesh const &mesh, std::vector<Face_index> const &faces);
+
+// the source vertex of a patch vertex, null for vertices that did not come from the source mesh
+Vertex_index sourceVertex(Patch const &patch, Vertex_index v);
+
+// rebuilds a single mesh out of patches that left their borders untouched, border vertices with
+// the same source are welded, seamVertices receives the welded vertices of the result
+bool mergePatches(std::vector<Patch> const &patches, Mesh &mesh,
+                  std::vector<Vertex_index> *seamVertices = nullptr);
+
+// marks border edges as constrained, for CGAL functions taking an edge_is_constrained_map
+struct BorderEdgeMap {
+  typedef boost::graph_traits<Mesh>::edge_descriptor key_type;
+  typedef bool value_type;
+  typedef value_type reference;
+  typedef boost::readable_property_map_tag category;
+
+  Mesh const *mesh = nullptr;
+
+  friend value_type get(BorderEdgeMap const &map, key_type const &edge) {
+    return CGAL::is_border(edge, *map.mesh);
+  }
+};
+
+// marks border vertices as constrained, for CGAL functions taking a vertex_is_constrained_map
+struct BorderVertexMap {
+  typedef boost::graph_traits<Mesh>::vertex_descriptor key_type;
+  typedef bool value_type;
+  typedef value_type reference;
+  typedef boost::readable_property_map_tag category;
+
+  Mesh const *mesh = nullptr;
+
+  friend value_type get(BorderVertexMap const &map, key_type const &vertex) {
+    return map.mesh->is_border(vertex);
+  }
+};
+
+} // namespace Partition
@@ -0,0 +1,356 @@
+#include "Pipeline.hpp"
+
+#include "benchmark/Benchmark.hpp"
+#include "common/Instrument.hpp"
+#include "intersection/Intersection.hpp"
+#include "io/Io.hpp"
+#include "io/ResultCache.hpp"
+#include "io/SurfaceMeshIo.hpp"
+#include "metrics/Distance.hpp"
+#include "metrics/Metrics.hpp"
+#include "remesh/Remesh.hpp"
+#include "repair/Repair.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+namespace {
+
+std::vector<std::string> _split(std::string const &text, char separator) {
+  std::vector<std::string> parts;
+  std::stringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, separator)) {
+    parts.push_back(part);
+  }
+  return parts;
+}
+
+// the whole token has to be a number, "6050abc" is rejected
+template <typename T> bool _parseNumber(std::string const &text, T &value) {
+  // streams read "-1" into an unsigned as its wrapped value
+  if (std::is_unsigned_v<T> && text.find('-') != std::string::npos) {
+    return false;
+  }
+  std::stringstream stream(text);
+  stream >> value;
+  return !stream.fail() && stream.eof();
+}
+
+std::optional<Pipeline::Stage> _parseStage(std::string const &token) {
+  std::vector<std::string> const fields = _split(token, ':');
+  if (fields.empty()) {
+    return std::nullopt;
+  }
+
+  Pipeline::Stage stage{};
+  stage.name = fields[0];
+
+  if (fields[0] == "rep" || fields[0] == "ben" || fields[0] == "met") {
+    stage.kind = fields[0] == "rep"   ? Pipeline::StageKind::kRepair
+                 : fields[0] == "ben" ? Pipeline::StageKind::kBenchmark
+                                      : Pipeline::StageKind::kMetrics;
+    // reporting defaults to the stricter cap angle of the metrics, not the repair threshold
+    if (stage.kind == Pipeline::StageKind::kMetrics) {
+      stage.thresholdAngle = static_cast<float>(Metrics::Options{}.capAngle);
+    }
+    if (fields.size() > 2 ||
+        (fields.size() == 2 && !_parseNumber(fields[1], stage.thresholdAngle))) {
+      return std::nullopt;
+    }
+    return stage;
+  }
+
+  if (fields[0] == "dst") {
+    stage.kind = Pipeline::StageKind::kDistance;
+    if (fields.size() > 2 || (fields.size() == 2 && !_parseNumber(fields[1], stage.sampleCount)) ||
+        stage.sampleCount == 0) {
+      return std::nullopt;
+    }
+    return stage;
+  }
+
+  if (fields[0] == "ord") {
+    stage.kind = Pipeline::StageKind::kReorder;
+    if (fields.size() > 2) {
+      return std::nullopt;
+    }
+    if (fields.size() == 2) {
+      auto curve = Reorder::curveFromName(fields[1]);
+      if (curve == std::nullopt) {
+        return std::nullopt;
+      }
+      stage.curve = curve.value();
+    }
+    return stage;
+  }
+
+  if (fields[0] == "chk") {
+    stage.kind = Pipeline::StageKind::kIntersectionCheck;
+    return fields.size() == 1 ? std::optional<Pipeline::Stage>(stage) : std::nullopt;
+  }
+
+  if (fields[0] == "sim" || fields[0] == "psi") {
+    bool const parallel = fields[0] == "psi";
+    stage.kind = parallel ? Pipeline::StageKind::kSimplifyParallel : Pipeline::StageKind::kSimplify;
+    if (fields.size() > (parallel ? 4 : 3) ||
+        (fields.size() >= 2 && !_parseNumber(fields[1], stage.outputFaceCount))) {
+      return std::nullopt;
+    }
+    if (fields.size() == 4 && !_parseNumber(fields[3], stage.threadCount)) {
+      return std::nullopt;
+    }
+    if (fields.size() >= 3) {
+      auto policy = MeshSimplification::policyFromName(fields[2]);
+      if (policy == std::nullopt) {
+        return std::nullopt;
+      }
+      stage.policy = policy.value();
+    }
+    return stage;
+  }
+
+  if (fields[0] == "tol") {
+    // the cost bound needs a Garland-Heckbert policy, kNone would only bound the placements
+    stage.kind   = Pipeline::StageKind::kSimplifyToError;
+    stage.policy = MeshSimplification::GarlandHeckbertPolicy::kClassicPlane;
+    if (fields.size() > 3 || (fields.size() >= 2 && !_parseNumber(fields[1], stage.maxError))) {
+      return std::nullopt;
+    }
+    if (fields.size() == 3) {
+      auto policy = MeshSimplification::policyFromName(fields[2]);
+      if (policy == std::nullopt) {
+        return std::nullopt;
+      }
+      stage.policy = policy.value();
+    }
+    return stage;
+  }
+
+  if (fields[0] == "rem" || fields[0] == "prm" || fields[0] == "lrm") {
+    if (fields[0] == "rem") {
+      stage.kind = Pipeline::StageKind::kRemesh;
+      if (fields.size() > 2) {
+        return std::nullopt;
+      }
+    } else if (fields[0] == "prm") {
+      stage.kind = Pipeline::StageKind::kRemeshParallel;
+      if (fields.size() > 3 ||
+          (fields.size() == 3 && !_parseNumber(fields[2], stage.threadCount))) {
+        return std::nullopt;
+      }
+    } else {
+      stage.kind = Pipeline::StageKind::kRemeshDefects;
+      if (fields.size() > 4 || (fields.size() >= 3 && !_parseNumber(fields[2], stage.ringCount)) ||
+          (fields.size() == 4 && !_parseNumber(fields[3], stage.thresholdAngle))) {
+        return std::nullopt;
+      }
+    }
+    if (fields.size() >= 2) {
+      std::vector<std::string> const values = _split(fields[1], 'x');
+      if (values.empty() || values.size() > 2 || !_parseNumber(values[0], stage.targetEdgeLength) ||
+          (values.size() == 2 && !_parseNumber(values[1], stage.nbIter))) {
+        return std::nullopt;
+      }
+    }
+    return stage;
+  }
+
+  return std::nullopt;
+}
+
+void _checkIntersections(Mesh const &mesh, std::optional<Intersection::Index> &index) {
+  if (index == std::nullopt) {
+    index.emplace(mesh);
+  } else {
+    index->update();
+  }
+  std::cout << index->intersectingPairCount() << " pairs of triangles intersect, "
+            << index->lastTestedFaceCount() << " faces tested." << std::endl;
+}
+
+void _runStage(Mesh &mesh, Pipeline::Stage const &stage, std::optional<Intersection::Index> &index,
+               std::optional<Metrics::DistanceOracle> const &reference) {
+  Instrument::Zone zone("stage." + stage.name);
+
+  switch (stage.kind) {
+  case Pipeline::StageKind::kRepair: {
+    Repair::RepairReport report;
+    bool success = Repair::removeDegenerateFaces(mesh, stage.thresholdAngle, &report);
+    Repair::printReport(report);
+    std::cout << "Mesh repair state: " << (success ? "success" : "failed") << std::endl;
+    break;
+  }
+  case Pipeline::StageKind::kSimplify:
+    // the collapse visitor reports its changes to the index, no diff needed afterwards
+    MeshSimplification::simplify(mesh, stage.outputFaceCount, stage.policy, true,
+                                 index != std::nullopt ? &index.value() : nullptr);
+    return;
+  case Pipeline::StageKind::kSimplifyParallel:
+    MeshSimplification::simplifyParallel(mesh, stage.outputFaceCount, stage.policy,
+                                         stage.threadCount);
+    break;
+  case Pipeline::StageKind::kSimplifyToError:
+    MeshSimplification::simplifyToError(mesh, stage.maxError, stage.policy);
+    break;
+  case Pipeline::StageKind::kRemesh:
+    Remesh::isoRemesh(mesh, stage.targetEdgeLength, stage.nbIter);
+    break;
+  case Pipeline::StageKind::kRemeshParallel:
+    Remesh::isoRemeshParallel(mesh, stage.targetEdgeLength, stage.nbIter, stage.threadCount);
+    break;
+  case Pipeline::StageKind::kRemeshDefects:
+    Remesh::isoRemeshDefects(mesh, stage.targetEdgeLength, stage.nbIter, stage.thresholdAngle,
+                             stage.ringCount);
+    break;
+  case Pipeline::StageKind::kReorder:
+    // every face is renumbered, the next chk indexes from scratch
+    Reorder::reorder(mesh, stage.curve);
+    index.reset();
+    return;
+  case Pipeline::StageKind::kBenchmark:
+    Benchmark::benchmark(mesh, stage.thresholdAngle);
+    return;
+  case Pipeline::StageKind::kMetrics: {
+    Metrics::Options options;
+    options.capAngle = stage.thresholdAngle;
+    Metrics::printReport(Metrics::computeMetrics(mesh, options));
+    return;
+  }
+  case Pipeline::StageKind::kIntersectionCheck:
+    _checkIntersections(mesh, index);
+    return;
+  case Pipeline::StageKind::kDistance: {
+    auto report = reference->measure(mesh, stage.sampleCount);
+    if (report != std::nullopt) {
+      Metrics::printReport(report.value());
+    }
+    return;
+  }
+  }
+
+  // the remaining stages edit the mesh without saying where
+  if (index != std::nullopt) {
+    index->markChangedFaces();
+  }
+}
+
+std::string _stemOf(std::string const &filename) {
+  size_t const dot = filename.find_last_of('.');
+  return dot == std::string::npos ? filename : filename.substr(0, dot);
+}
+
+} // namespace
+
+namespace Pipeline {
+
+std::optional<std::vector<Stage>> parseStages(std::string const &spec) {
+  std::vector<Stage> stages;
+  for (auto const &token : _split(spec, ',')) {
+    auto stage = _parseStage(token);
+    if (stage == std::nullopt) {
+      std::cerr << "Unknown pipeline stage (" << token << ")" << std::endl;
+      return std::nullopt;
+    }
+    stages.push_back(stage.value());
+  }
+  if (stages.empty()) {
+    std::cerr << "Empty pipeline" << std::endl;
+    return std::nullopt;
+  }
+  return stages;
+}
+
+void run(Mesh &mesh, std::vector<Stage> const &stages, std::string const &debugOutputStem) {
+  std::optional<Intersection::Index> index;
+
+  // indexed before any stage edits the mesh, sampled as densely as the densest dst asks for
+  std::optional<Metrics::DistanceOracle> reference;
+  bool hasDistance            = false;
+  size_t referenceSampleCount = 0;
+  for (Stage const &stage : stages) {
+    if (stage.kind == StageKind::kDistance) {
+      hasDistance          = true;
+      referenceSampleCount = std::max(referenceSampleCount, stage.sampleCount);
+    }
+  }
+  // keyed on the stage rather than the count, a dst stage always finds its reference
+  if (hasDistance) {
+    reference.emplace(mesh, referenceSampleCount);
+    std::cout << "Distance reference built, time taken: " << reference->buildTime() << "s"
+              << std::endl;
+  }
+
+  for (size_t i = 0; i < stages.size(); i++) {
+    Stage const &stage = stages[i];
+    std::cout << "[" << i + 1 << "/" << stages.size() << "] " << stage.name << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    _runStage(mesh, stage, index, reference);
+    auto end                              = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    std::cout << "Faces: " << num_faces(mesh) << ", time taken: " << elapsed.count() << "s"
+              << std::endl;
+
+    if (!debugOutputStem.empty()) {
+      std::stringstream name;
+      name << debugOutputStem << "." << std::setw(2) << std::setfill('0') << i + 1 << "-"
+           << stage.name << ".obj";
+      std::string const debugFilePath = Io::makeFullOutputPath(name.str());
+      Io::writeSurfaceMesh(debugFilePath, mesh);
+      std::cout << "Intermediate mesh written to path (" << debugFilePath << ")" << std::endl;
+    }
+  }
+}
+
+std::string cacheOperation(std::vector<Stage> const &stages) {
+  std::stringstream operation;
+  operation << std::setprecision(17) << "pipeline";
+  for (Stage const &stage : stages) {
+    if (stage.kind == StageKind::kBenchmark || stage.kind == StageKind::kMetrics ||
+        stage.kind == StageKind::kIntersectionCheck || stage.kind == StageKind::kDistance) {
+      return {};
+    }
+    operation << "|" << stage.name << ":" << static_cast<int>(stage.kind) << ":"
+              << stage.thresholdAngle << ":" << stage.outputFaceCount << ":"
+              << static_cast<int>(stage.policy) << ":" << stage.threadCount << ":"
+              << stage.maxError << ":" << stage.targetEdgeLength << ":" << stage.nbIter << ":"
+              << stage.ringCount << ":" << static_cast<int>(stage.curve);
+  }
+  return operation.str();
+}
+
+bool run(std::string const &filename, std::vector<Stage> const &stages, bool writeIntermediates) {
+  std::string const inputFilePath  = Io::makeFullInputPath(filename);
+  std::string const outputFilePath = Io::makeMeshOutputPath(filename);
+
+  // intermediates only come out of an actual run
+  std::optional<std::string> resultKey;
+  std::string const operation = cacheOperation(stages);
+  if (!writeIntermediates && !operation.empty() &&
+      Io::fetchResult(inputFilePath, operation, outputFilePath, resultKey)) {
+    return true;
+  }
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return false;
+  }
+  Mesh &mesh = maybeMesh.value();
+
+  run(mesh, stages, writeIntermediates ? _stemOf(filename) : std::string{});
+
+  if (!Io::writeSurfaceMesh(outputFilePath, mesh)) {
+    return false;
+  }
+  std::cout << "Pipeline result written to path (" << outputFilePath << ")" << std::endl;
+
+  Io::storeResult(resultKey, outputFilePath);
+  return true;
+}
+
+} // namespace Pipeline
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "common/Mesh.hpp"
+#include "mesh-simplification/MeshSimplification.hpp"
+#include "reorder/Reorder.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Pipeline {
+
+enum class StageKind {
+  kRepair,
+  kSimplify,
+  kSimplifyParallel,
+  kSimplifyToError,
+  kRemesh,
+  kRemeshParallel,
+  kRemeshDefects,
+  kReorder,
+  kBenchmark,
+  kMetrics,
+  kIntersectionCheck,
+  kDistance,
+};
+
+// one step of a pipeline, parameters that don't apply to the kind are ignored
+struct Stage {
+  StageKind kind = StageKind::kRepair;
+  std::string name;
+
+  float thresholdAngle = 130;
+
+  size_t outputFaceCount = 6050;
+  MeshSimplification::GarlandHeckbertPolicy policy =
+      MeshSimplification::GarlandHeckbertPolicy::kNone;
+  size_t threadCount = 0;
+  double maxError    = 0.01;
+
+  double targetEdgeLength = 0.04;
+  unsigned int nbIter     = 10;
+  unsigned int ringCount  = 2;
+
+  size_t sampleCount = 100000;
+
+  Reorder::Curve curve = Reorder::Curve::kHilbert;
+};
+
+// parses a comma separated list such as "rep,sim:6050,rem:0.04x10,ben", the forms are
+// rep[:angle], sim[:faceCount[:policy]], psi[:faceCount[:policy[:threads]]], tol[:error[:policy]],
+// rem[:edgeLength[xiterations]], prm[:edgeLength[xiterations[:threads]]],
+// lrm[:edgeLength[xiterations[:rings[:angle]]]], ord[:curve], ben[:angle], met[:capAngle], chk
+// and dst[:samples], counts are positive, a negative one is rejected rather than wrapped
+std::optional<std::vector<Stage>> parseStages(std::string const &spec);
+
+// runs every stage on the same mesh, debugOutputStem non-empty writes the mesh after each stage,
+// the first chk indexes the self-intersections and later ones retest only what changed since,
+// dst measures the distance to the mesh as it was handed in, which is indexed once up front
+void run(Mesh &mesh, std::vector<Stage> const &stages, std::string const &debugOutputStem);
+
+// every stage with all of its parameters, what the result cache keys a pipeline on, empty when a
+// stage only reports since its output is the point of running it
+std::string cacheOperation(std::vector<Stage> const &stages);
+
+// loads the input once, runs the stages and writes only the final mesh, a pipeline that ran on
+// the same input bytes before is taken from the result cache without loading anything
+bool run(std::string const &filename, std::vector<Stage> const &stages, bool writeIntermediates);
+
+} // namespace Pipeline
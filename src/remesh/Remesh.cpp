@@ -1,95 +1,367 @@
 #include "Remesh.hpp"
 
-#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
-#include <CGAL/Polygon_mesh_processing/IO/polygon_mesh_io.h>
-#include <CGAL/Polygon_mesh_processing/border.h>
 #include <CGAL/Polygon_mesh_processing/remesh.h>
-#include <CGAL/Surface_mesh.h>
-#include <boost/iterator/function_output_iterator.hpp>
+#include <CGAL/boost/graph/Euler_operations.h>
 
+#include "benchmark/Benchmark.hpp"
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
 #include "common/defines.hpp"
 #include "io/Io.hpp"
+#include "io/ResultCache.hpp"
+#include "io/SurfaceMeshIo.hpp"
+#include "partition/Partition.hpp"
 
+#include <iomanip>
 #include <iostream>
 #include <optional>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
-typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel;
-typedef CGAL::Surface_mesh<Kernel::Point_3> Mesh;
-
 typedef boost::graph_traits<Mesh>::halfedge_descriptor halfedge_descriptor;
 typedef boost::graph_traits<Mesh>::edge_descriptor edge_descriptor;
 typedef Kernel::Vector_3 Vector_3;
+typedef Mesh::Vertex_index Vertex_index;
 typedef Mesh::Face_index Face_index;
 typedef Mesh::Edge_index Edge_index;
 typedef Mesh::Halfedge_index Halfedge_index;
 
+typedef Mesh::Property_map<Edge_index, bool> EdgeConstraintMap;
+typedef Mesh::Property_map<Face_index, size_t> FacePatchMap;
+
 namespace PMP = CGAL::Polygon_mesh_processing;
 
 namespace {
-std::optional<Mesh> _readMesh(std::string const &filePath) {
-  std::cout << "Loading mesh from path (" << filePath << ")..." << std::endl;
 
-  Mesh mesh;
-  if (!PMP::IO::read_polygon_mesh(filePath, mesh)) {
-    std::cerr << "Cannot read polygon mesh" << std::endl;
-    return std::nullopt;
+// one flag per edge instead of a hash entry per edge, border edges start constrained
+EdgeConstraintMap _addBorderConstraints(Mesh &mesh) {
+  EdgeConstraintMap constrained =
+      mesh.add_property_map<Edge_index, bool>("e:remesh_constrained", false).first;
+  for (Edge_index e : mesh.edges()) {
+    constrained[e] = mesh.is_border(e);
   }
-  if (!CGAL::is_triangle_mesh(mesh)) {
-    std::cerr << "Input geometry is not triangulated." << std::endl;
-    return std::nullopt;
+  return constrained;
+}
+
+// h was just split, it is now followed by the new vertex, triangulates the quad on its side
+void _splitQuad(Mesh &mesh, Halfedge_index h, FacePatchMap &patchOf) {
+  Face_index const f = mesh.face(h);
+  if (f == Mesh::null_face()) {
+    return;
   }
+  size_t const patch = patchOf[f];
 
-  std::cout << "Faces: " << num_faces(mesh) << std::endl;
-  return std::optional<Mesh>(mesh);
+  Halfedge_index const diagonal = CGAL::Euler::split_face(h, mesh.next(mesh.next(h)), mesh);
+  patchOf[mesh.face(diagonal)]                = patch;
+  patchOf[mesh.face(mesh.opposite(diagonal))] = patch;
+}
+
+bool _isPatchCut(Mesh const &mesh, FacePatchMap const &patchOf, Edge_index e) {
+  Halfedge_index const h = mesh.halfedge(e);
+  return !mesh.is_border(e) && patchOf[mesh.face(h)] != patchOf[mesh.face(mesh.opposite(h))];
+}
+
+// patch borders are protected while the patches are remeshed, and isotropic_remeshing refuses to
+// protect edges longer than 4/3 of the target, so those are halved beforehand, the midpoints are
+// shared by both sides of a cut and the new faces stay in the patch of the face they split
+void _splitLongPatchBorders(Mesh &mesh, FacePatchMap &patchOf, double maxLength,
+                            bool includeMeshBorder) {
+  std::vector<Halfedge_index> pending;
+  for (Edge_index e : mesh.edges()) {
+    if ((includeMeshBorder && mesh.is_border(e)) || _isPatchCut(mesh, patchOf, e)) {
+      pending.push_back(mesh.halfedge(e));
+    }
+  }
+
+  double const maxSquaredLength = maxLength * maxLength;
+  while (!pending.empty()) {
+    Halfedge_index const h = pending.back();
+    pending.pop_back();
+
+    Kernel::Point_3 const source = mesh.point(mesh.source(h));
+    Kernel::Point_3 const target = mesh.point(mesh.target(h));
+    if (CGAL::squared_distance(source, target) <= maxSquaredLength) {
+      continue;
+    }
+
+    Halfedge_index const hNew     = CGAL::Euler::split_edge(h, mesh);
+    mesh.point(mesh.target(hNew)) = CGAL::midpoint(source, target);
+    _splitQuad(mesh, hNew, patchOf);
+    _splitQuad(mesh, mesh.opposite(h), patchOf);
+
+    pending.push_back(h);
+    pending.push_back(hNew);
+  }
+}
+
+// one call whatever the instrumentation, splitting it per iteration would reproject onto the
+// previous iteration instead of the input and change the result, the split, collapse, flip,
+// smooth and project steps are internal to CGAL so the zone covers all of them
+template <typename NamedParameters>
+void _remeshWholeMesh(Mesh &mesh, double targetEdgeLength, unsigned int nbIter,
+                      NamedParameters const &np) {
+  Instrument::Zone zone("remesh.iterations");
+  PMP::isotropic_remeshing(faces(mesh), targetEdgeLength, mesh, np.number_of_iterations(nbIter));
+  Instrument::recordValue("remesh.faces", static_cast<double>(mesh.number_of_faces()));
+}
+
+void _remeshAll(Mesh &mesh, double targetEdgeLength, unsigned int nbIter) {
+  Instrument::Zone zone("remesh.isotropic_remeshing");
+  EdgeConstraintMap constrained = _addBorderConstraints(mesh);
+
+  _remeshWholeMesh(mesh, targetEdgeLength, nbIter,
+                   CGAL::parameters::collapse_constraints(true).edge_is_constrained_map(
+                       constrained)); // i.e. protect border, here
+
+  mesh.remove_property_map(constrained);
 }
+
 } // namespace
 
 namespace Remesh {
 
-struct halfedge2edge {
-  halfedge2edge(const Mesh &m, std::vector<edge_descriptor> &edges) : mMesh(m), mEdges(edges) {}
-  void operator()(const halfedge_descriptor &h) const { mEdges.push_back(edge(h, mMesh)); }
-  const Mesh &mMesh;
-  std::vector<edge_descriptor> &mEdges;
-};
+void isoRemesh(Mesh &mesh, double targetEdgeLength, unsigned int nbIter) {
+  _remeshAll(mesh, targetEdgeLength, nbIter);
+}
+
+void isoRemeshParallel(Mesh &mesh, double targetEdgeLength, unsigned int nbIter,
+                       size_t threadCount, size_t patchCount) {
+  threadCount = threadCount != 0 ? threadCount : std::thread::hardware_concurrency();
+  patchCount  = patchCount != 0 ? patchCount : threadCount;
+  if (patchCount <= 1) {
+    _remeshAll(mesh, targetEdgeLength, nbIter);
+    return;
+  }
+
+  std::vector<std::vector<Face_index>> groups = Partition::splitFaces(mesh, patchCount);
+
+  FacePatchMap patchOf = mesh.add_property_map<Face_index, size_t>("f:remesh_patch", 0).first;
+  for (size_t i = 0; i < groups.size(); i++) {
+    for (Face_index f : groups[i]) {
+      patchOf[f] = i;
+    }
+  }
+  {
+    Instrument::Zone zone("remesh.splitPatchBorders");
+    _splitLongPatchBorders(mesh, patchOf, targetEdgeLength * 4.0 / 3.0, true);
+  }
+
+  for (auto &group : groups) {
+    group.clear();
+  }
+  for (Face_index f : mesh.faces()) {
+    groups[patchOf[f]].push_back(f);
+  }
+  mesh.remove_property_map(patchOf);
+
+  std::unique_ptr<ThreadPool> const pool = ThreadPool::withThreads(threadCount);
+
+  std::vector<std::optional<Partition::Patch>> patches(groups.size());
+  pool->parallelFor(groups.size(), [&](size_t i) {
+    patches[i] = Partition::extractPatch(mesh, groups[i]);
+    if (patches[i] == std::nullopt) {
+      return;
+    }
+
+    Instrument::Zone zone("remesh.patch");
+    Mesh &patchMesh               = patches[i]->mesh;
+    EdgeConstraintMap constrained = _addBorderConstraints(patchMesh);
+    _remeshWholeMesh(
+        patchMesh, targetEdgeLength, nbIter,
+        CGAL::parameters::protect_constraints(true).edge_is_constrained_map(constrained));
+    patchMesh.remove_property_map(constrained);
+  });
+
+  std::vector<Partition::Patch> remeshedPatches;
+  remeshedPatches.reserve(patches.size());
+  for (auto &patch : patches) {
+    if (patch == std::nullopt) {
+      std::cerr << "Patch is not a valid mesh on its own, remeshing serially" << std::endl;
+      _remeshAll(mesh, targetEdgeLength, nbIter);
+      return;
+    }
+    remeshedPatches.emplace_back(std::move(patch.value()));
+  }
+
+  Mesh merged;
+  std::vector<Vertex_index> seamVertices;
+  if (!Partition::mergePatches(remeshedPatches, merged, &seamVertices)) {
+    std::cerr << "Cannot merge patches, remeshing serially" << std::endl;
+    _remeshAll(mesh, targetEdgeLength, nbIter);
+    return;
+  }
+  mesh = std::move(merged);
+
+  // no seam vertices means the merge had to repair the soup and the seams are unknown
+  if (seamVertices.empty()) {
+    _remeshAll(mesh, targetEdgeLength, nbIter);
+    return;
+  }
+
+  // seam pass, the seams and the input border were frozen in the patches, remesh their one ring
+  std::vector<bool> inSeamRing(mesh.num_faces(), false);
+  std::vector<Face_index> seamRing;
+  auto addRing = [&](Vertex_index v) {
+    for (Face_index f : faces_around_target(mesh.halfedge(v), mesh)) {
+      if (f != Mesh::null_face() && !inSeamRing[f]) {
+        inSeamRing[f] = true;
+        seamRing.push_back(f);
+      }
+    }
+  };
+  for (Vertex_index v : seamVertices) {
+    addRing(v);
+  }
+  for (Vertex_index v : mesh.vertices()) {
+    if (mesh.is_border(v)) {
+      addRing(v);
+    }
+  }
+
+  Instrument::Zone zone("remesh.seam");
+  EdgeConstraintMap constrained = _addBorderConstraints(mesh);
+  PMP::isotropic_remeshing(seamRing, targetEdgeLength, mesh,
+                           CGAL::parameters::number_of_iterations(nbIter)
+                               .collapse_constraints(true)
+                               .edge_is_constrained_map(constrained));
+  mesh.remove_property_map(constrained);
+}
+
+void isoRemeshDefects(Mesh &mesh, double targetEdgeLength, unsigned int nbIter,
+                      float thresholdAngle, unsigned int ringCount) {
+  Benchmark::Defects const defects = Benchmark::findDefects(mesh, thresholdAngle);
+
+  FacePatchMap inRegion = mesh.add_property_map<Face_index, size_t>("f:remesh_region", 0).first;
+  std::vector<Face_index> region;
+  auto addFace = [&](Face_index f) {
+    if (f != Mesh::null_face() && inRegion[f] == 0) {
+      inRegion[f] = 1;
+      region.push_back(f);
+    }
+  };
+  for (auto const &[f0, f1] : defects.intersectingPairs) {
+    addFace(f0);
+    addFace(f1);
+  }
+  for (Face_index f : defects.capFaces) {
+    addFace(f);
+  }
+  size_t const defectCount = region.size();
+
+  if (defectCount == 0) {
+    mesh.remove_property_map(inRegion);
+    std::cout << "No defective faces, nothing to remesh" << std::endl;
+    return;
+  }
+
+  // each ring adds every face sharing a vertex with the faces added by the previous one
+  size_t ringBegin = 0;
+  for (unsigned int ring = 0; ring < ringCount; ring++) {
+    size_t const ringEnd = region.size();
+    for (size_t i = ringBegin; i < ringEnd; i++) {
+      for (Vertex_index v : vertices_around_face(mesh.halfedge(region[i]), mesh)) {
+        for (Face_index f : faces_around_target(mesh.halfedge(v), mesh)) {
+          addFace(f);
+        }
+      }
+    }
+    ringBegin = ringEnd;
+  }
+
+  std::cout << "Remeshing " << region.size() << " of " << num_faces(mesh) << " faces around "
+            << defectCount << " defective faces" << std::endl;
+
+  // the region boundary and the mesh border inside it are protected so nothing outside the region
+  // moves and the outline of the mesh is kept, long protected edges are halved first and the
+  // halves stay in the region
+  _splitLongPatchBorders(mesh, inRegion, targetEdgeLength * 4.0 / 3.0, true);
+  region.clear();
+  for (Face_index f : mesh.faces()) {
+    if (inRegion[f] != 0) {
+      region.push_back(f);
+    }
+  }
+
+  EdgeConstraintMap constrained =
+      mesh.add_property_map<Edge_index, bool>("e:remesh_constrained", false).first;
+  for (Edge_index e : mesh.edges()) {
+    Halfedge_index const h = mesh.halfedge(e);
+    Face_index const inner = mesh.is_border(h) ? mesh.face(mesh.opposite(h)) : mesh.face(h);
+    constrained[e] = _isPatchCut(mesh, inRegion, e) || (mesh.is_border(e) && inRegion[inner] != 0);
+  }
+  mesh.remove_property_map(inRegion);
+
+  Instrument::Zone zone("remesh.defects");
+  PMP::isotropic_remeshing(region, targetEdgeLength, mesh,
+                           CGAL::parameters::number_of_iterations(nbIter)
+                               .protect_constraints(true)
+                               .edge_is_constrained_map(constrained));
+  mesh.remove_property_map(constrained);
+}
 
-void isoRemesh(std::string const &filename, double targetEdgeLength, unsigned int nbIter) {
+void isoRemesh(std::string const &filename, double targetEdgeLength, unsigned int nbIter,
+               size_t threadCount) {
   std::string const inputFilePath  = Io::makeFullInputPath(filename);
-  std::string const outputFilePath = Io::makeFullOutputPath(filename);
+  std::string const outputFilePath = Io::makeMeshOutputPath(filename);
+
+  // the patches follow the thread count, so it changes the output
+  std::stringstream operation;
+  operation << std::setprecision(17) << "rem:" << targetEdgeLength << ":" << nbIter << ":"
+            << threadCount;
+  std::optional<std::string> resultKey;
+  if (Io::fetchResult(inputFilePath, operation.str(), outputFilePath, resultKey)) {
+    return;
+  }
 
-  auto maybeMesh = _readMesh(inputFilePath);
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
   if (maybeMesh == std::nullopt) {
     return;
   }
   Mesh &mesh = maybeMesh.value();
 
-  std::vector<edge_descriptor> border;
-  PMP::border_halfedges(faces(mesh), mesh,
-                        boost::make_function_output_iterator(halfedge2edge(mesh, border)));
+  if (threadCount == 1) {
+    isoRemesh(mesh, targetEdgeLength, nbIter);
+  } else {
+    isoRemeshParallel(mesh, targetEdgeLength, nbIter, threadCount);
+  }
 
-  boost::unordered_map<edge_descriptor, bool> edge_constraints_map;
-  for (edge_descriptor ed : edges(mesh)) {
-    edge_constraints_map[ed] = false;
+  if (Io::writeSurfaceMesh(outputFilePath, mesh)) {
+    Io::storeResult(resultKey, outputFilePath);
   }
-  // add border as well, as the default code suggests
-  for (edge_descriptor ed : border) {
-    edge_constraints_map[ed] = true;
+
+  std::cout << "Remeshed mesh written to path (" << outputFilePath << ")" << std::endl;
+  std::cout << "Faces: " << num_faces(mesh) << std::endl;
+}
+
+void isoRemeshDefects(std::string const &filename, double targetEdgeLength, unsigned int nbIter,
+                      float thresholdAngle, unsigned int ringCount) {
+  std::string const inputFilePath  = Io::makeFullInputPath(filename);
+  std::string const outputFilePath = Io::makeMeshOutputPath(filename);
+
+  std::stringstream operation;
+  operation << std::setprecision(17) << "rem-defects:" << targetEdgeLength << ":" << nbIter << ":"
+            << thresholdAngle << ":" << ringCount;
+  std::optional<std::string> resultKey;
+  if (Io::fetchResult(inputFilePath, operation.str(), outputFilePath, resultKey)) {
+    return;
   }
 
-  auto edge_constraints_property_map = boost::make_assoc_property_map(edge_constraints_map);
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return;
+  }
+  Mesh &mesh = maybeMesh.value();
 
-  PMP::isotropic_remeshing(
-      faces(mesh), targetEdgeLength, mesh,
-      CGAL::parameters::number_of_iterations(nbIter)
-          .collapse_constraints(true)
-          .edge_is_constrained_map(edge_constraints_property_map)); // i.e. protect border, here
+  isoRemeshDefects(mesh, targetEdgeLength, nbIter, thresholdAngle, ringCount);
 
-  CGAL::IO::write_polygon_mesh(outputFilePath, mesh, CGAL::parameters::stream_precision(17));
+  if (Io::writeSurfaceMesh(outputFilePath, mesh)) {
+    Io::storeResult(resultKey, outputFilePath);
+  }
 
   std::cout << "Remeshed mesh written to path (" << outputFilePath << ")" << std::endl;
-  auto remeshedMeshOpt = _readMesh(outputFilePath);
+  std::cout << "Faces: " << num_faces(mesh) << std::endl;
 }
 
 } // namespace Remesh
@@ -1,9 +1,31 @@
 #pragma once
 
+#include "common/Mesh.hpp"
+
 #include <string>
 
 namespace Remesh {
 
-void isoRemesh(std::string const &filename, double targetEdgeLength, unsigned int nbIter);
+// isotropic remeshing of all faces in place, border edges are kept
+void isoRemesh(Mesh &mesh, double targetEdgeLength, unsigned int nbIter);
+
+// splits the mesh into patches and remeshes them concurrently with the cuts between them
+// protected, a serial pass then remeshes the one ring of the cuts and of the border, threadCount
+// 0 means all hardware threads, patchCount 0 means one patch per thread
+void isoRemeshParallel(Mesh &mesh, double targetEdgeLength, unsigned int nbIter,
+                       size_t threadCount, size_t patchCount = 0);
+
+// remeshes only the cap triangles and self-intersecting faces that Benchmark::findDefects reports,
+// grown by ringCount rings of neighbours, the boundary of that region and the mesh border in it are
+// protected
+void isoRemeshDefects(Mesh &mesh, double targetEdgeLength, unsigned int nbIter,
+                      float thresholdAngle, unsigned int ringCount);
+
+// threadCount 1 runs the serial isoRemesh, anything else isoRemeshParallel
+void isoRemesh(std::string const &filename, double targetEdgeLength, unsigned int nbIter,
+               size_t threadCount = 1);
+
+void isoRemeshDefects(std::string const &filename, double targetEdgeLength, unsigned int nbIter,
+                      float thresholdAngle, unsigned int ringCount);
 
-} // namespace Remesh
\ No newline at end of file
+} // namespace Remesh
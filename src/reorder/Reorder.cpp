@@ -0,0 +1,199 @@
+#include "Reorder.hpp"
+
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+#include "io/SurfaceMeshIo.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// bits per axis, three of them fill 63 bits of the key
+uint32_t constexpr kBits = 21;
+// vertices or faces per parallel task
+size_t constexpr kBlockSize = 16384;
+
+typedef std::pair<uint64_t, uint32_t> KeyedIndex;
+
+size_t _blockCount(size_t count) { return (count + kBlockSize - 1) / kBlockSize; }
+
+// spaces the low 21 bits of value two zero bits apart
+uint64_t _spread(uint32_t value) {
+  uint64_t x = value & ((1u << kBits) - 1);
+  x          = (x | x << 32) & 0x001f00000000ffffull;
+  x          = (x | x << 16) & 0x001f0000ff0000ffull;
+  x          = (x | x << 8) & 0x100f00f00f00f00full;
+  x          = (x | x << 4) & 0x10c30c30c30c30c3ull;
+  x          = (x | x << 2) & 0x1249249249249249ull;
+  return x;
+}
+
+uint64_t _morton(std::array<uint32_t, 3> const &cell) {
+  return _spread(cell[0]) << 2 | _spread(cell[1]) << 1 | _spread(cell[2]);
+}
+
+// Skilling's transform from "Programming the Hilbert curve" turns the coordinates into the
+// transposed Hilbert index, interleaving it like a Morton code gives the index itself
+uint64_t _hilbert(std::array<uint32_t, 3> cell) {
+  uint32_t constexpr kTop = 1u << (kBits - 1);
+
+  for (uint32_t q = kTop; q > 1; q >>= 1) {
+    uint32_t const p = q - 1;
+    for (size_t i = 0; i < 3; i++) {
+      if (cell[i] & q) {
+        cell[0] ^= p;
+      } else {
+        uint32_t const swap = (cell[0] ^ cell[i]) & p;
+        cell[0] ^= swap;
+        cell[i] ^= swap;
+      }
+    }
+  }
+
+  cell[1] ^= cell[0];
+  cell[2] ^= cell[1];
+  uint32_t flip = 0;
+  for (uint32_t q = kTop; q > 1; q >>= 1) {
+    if (cell[2] & q) {
+      flip ^= q - 1;
+    }
+  }
+  for (uint32_t &axis : cell) {
+    axis ^= flip;
+  }
+  return _morton(cell);
+}
+
+// maps points of the bounding cube to cells of a 2^21 grid along every axis, a cube and not the
+// box so the curve keeps its shape on flat models
+class Quantizer {
+public:
+  explicit Quantizer(std::vector<double> const &positions) {
+    double min[3] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                     std::numeric_limits<double>::max()};
+    double max[3] = {std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest(),
+                     std::numeric_limits<double>::lowest()};
+    for (size_t i = 0; i < positions.size(); i++) {
+      min[i % 3] = std::min(min[i % 3], positions[i]);
+      max[i % 3] = std::max(max[i % 3], positions[i]);
+    }
+
+    double extent = 0.0;
+    for (size_t axis = 0; axis < 3; axis++) {
+      mOrigin[axis] = min[axis];
+      extent        = std::max(extent, max[axis] - min[axis]);
+    }
+    mScale = extent > 0.0 ? static_cast<double>((1u << kBits) - 1) / extent : 0.0;
+  }
+
+  [[nodiscard]] std::array<uint32_t, 3> cell(double const *p) const {
+    std::array<uint32_t, 3> cell;
+    for (size_t axis = 0; axis < 3; axis++) {
+      double const scaled = (p[axis] - mOrigin[axis]) * mScale;
+      cell[axis] = static_cast<uint32_t>(std::clamp(scaled, 0.0, double((1u << kBits) - 1)));
+    }
+    return cell;
+  }
+
+private:
+  double mOrigin[3] = {};
+  double mScale     = 0.0;
+};
+
+// face centroids, xyz per face like the positions
+std::vector<double> _centroids(Io::MeshBuffer const &buffer) {
+  std::vector<double> centroids(3 * buffer.faceCount(), 0.0);
+  ThreadPool::global().parallelFor(_blockCount(buffer.faceCount()), [&](size_t block) {
+    size_t const end = std::min(buffer.faceCount(), (block + 1) * kBlockSize);
+    for (size_t f = block * kBlockSize; f < end; f++) {
+      uint32_t const begin = buffer.faceOffsets[f];
+      double const weight  = 1.0 / (buffer.faceOffsets[f + 1] - begin);
+      for (uint32_t c = begin; c < buffer.faceOffsets[f + 1]; c++) {
+        double const *p = buffer.positions.data() + 3 * buffer.indices[c];
+        for (size_t axis = 0; axis < 3; axis++) {
+          centroids[3 * f + axis] += weight * p[axis];
+        }
+      }
+    }
+  });
+  return centroids;
+}
+
+// sorted by key and then by the old index, so equal keys keep their relative order
+std::vector<KeyedIndex> _sortedKeys(std::vector<double> const &points, Reorder::Curve curve,
+                                    Quantizer const &quantizer) {
+  size_t const count = points.size() / 3;
+  std::vector<KeyedIndex> keys(count);
+  ThreadPool::global().parallelFor(_blockCount(count), [&](size_t block) {
+    size_t const end = std::min(count, (block + 1) * kBlockSize);
+    for (size_t i = block * kBlockSize; i < end; i++) {
+      std::array<uint32_t, 3> const cell = quantizer.cell(points.data() + 3 * i);
+      uint64_t const key = curve == Reorder::Curve::kHilbert ? _hilbert(cell) : _morton(cell);
+      keys[i]            = {key, static_cast<uint32_t>(i)};
+    }
+  });
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+} // namespace
+
+namespace Reorder {
+
+std::optional<Curve> curveFromName(std::string const &name) {
+  if (name == "morton") {
+    return Curve::kMorton;
+  } else if (name == "hilbert") {
+    return Curve::kHilbert;
+  }
+  return std::nullopt;
+}
+
+std::string curveName(Curve curve) { return curve == Curve::kHilbert ? "hilbert" : "morton"; }
+
+bool reorder(Mesh &mesh, Curve curve) {
+  Instrument::Zone zone("reorder");
+
+  Io::MeshBuffer buffer;
+  Io::extractMeshBuffer(mesh, buffer);
+  Quantizer const quantizer(buffer.positions);
+
+  std::vector<KeyedIndex> const vertexKeys = _sortedKeys(buffer.positions, curve, quantizer);
+  std::vector<KeyedIndex> const faceKeys   = _sortedKeys(_centroids(buffer), curve, quantizer);
+
+  Io::MeshBuffer sorted;
+  sorted.positions.resize(buffer.positions.size());
+  std::vector<uint32_t> remap(buffer.vertexCount());
+  for (size_t i = 0; i < vertexKeys.size(); i++) {
+    uint32_t const v = vertexKeys[i].second;
+    remap[v]         = static_cast<uint32_t>(i);
+    std::copy_n(buffer.positions.data() + 3 * v, 3, sorted.positions.data() + 3 * i);
+  }
+
+  sorted.indices.reserve(buffer.indices.size());
+  sorted.faceOffsets.reserve(buffer.faceOffsets.size());
+  for (KeyedIndex const &key : faceKeys) {
+    for (uint32_t c = buffer.faceOffsets[key.second]; c < buffer.faceOffsets[key.second + 1]; c++) {
+      sorted.indices.push_back(remap[buffer.indices[c]]);
+    }
+    sorted.faceOffsets.push_back(static_cast<uint32_t>(sorted.indices.size()));
+  }
+
+  // added in the new order, so the indices of the rebuilt mesh are the sorted ones
+  Mesh rebuilt;
+  if (!Io::buildSurfaceMesh(sorted.view(), rebuilt) ||
+      rebuilt.number_of_faces() != mesh.number_of_faces()) {
+    std::cerr << "Cannot rebuild the mesh in " << curveName(curve) << " order" << std::endl;
+    return false;
+  }
+  mesh = std::move(rebuilt);
+  return true;
+}
+
+} // namespace Reorder
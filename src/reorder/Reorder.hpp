@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common/Mesh.hpp"
+
+#include <optional>
+#include <string>
+
+namespace Reorder {
+
+enum class Curve {
+  kMorton,
+  kHilbert,
+};
+
+// "morton" or "hilbert"
+std::optional<Curve> curveFromName(std::string const &name);
+std::string curveName(Curve curve);
+
+// renumbers vertices by the curve index of their position and faces by that of their centroid and
+// rebuilds the connectivity in that order, so elements close in space sit close in the property
+// arrays and the mesh comes out without garbage, meant right after loading since any other
+// property map and every index held elsewhere are lost, false if the rebuild failed and the mesh
+// was left as it was
+bool reorder(Mesh &mesh, Curve curve);
+
+} // namespace Reorder
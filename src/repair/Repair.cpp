@@ -2,68 +2,333 @@
 
 #include <CGAL/Polygon_mesh_processing/repair_degeneracies.h>
 
-#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
-#include <CGAL/Polygon_mesh_processing/IO/polygon_mesh_io.h>
 #include <CGAL/Polygon_mesh_processing/shape_predicates.h>
-#include <CGAL/Surface_mesh.h>
 #include <boost/iterator/function_output_iterator.hpp>
 
+#include "common/Instrument.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/Timing.hpp"
 #include "common/defines.hpp"
 #include "io/Io.hpp"
+#include "io/MeshBuffer.hpp"
+#include "io/ResultCache.hpp"
+#include "io/SurfaceMeshIo.hpp"
+#include "metrics/Metrics.hpp"
+#include "partition/Partition.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <numeric>
 #include <optional>
+#include <sstream>
 #include <string>
-
-typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel;
-typedef CGAL::Surface_mesh<Kernel::Point_3> Mesh;
+#include <unordered_map>
 
 namespace PMP = CGAL::Polygon_mesh_processing;
 
 namespace {
-std::optional<Mesh> _readMesh(std::string const &filePath) {
-  std::cout << "Loading mesh from path (" << filePath << ")..." << std::endl;
+float getCosVal(float const angle) { return std::cos(angle * CGAL_PI / 180.0); }
+
+typedef Mesh::Face_index Face_index;
+typedef Mesh::Vertex_index Vertex_index;
+// rings of faces around every candidate handed to the repair, the flips and collapses that fix a
+// cap or a needle touch its neighbours
+int constexpr kNeighbourhoodRings = 2;
+// below this many candidates one serial call over the range beats extracting and merging patches
+size_t constexpr kParallelCandidateCount = 256;
+size_t constexpr kNoIndex                = std::numeric_limits<size_t>::max();
+
+// caps, needles and degenerate faces in face order, needleRatio matches the repair's default
+// needle_threshold
+std::vector<Face_index> _scanCandidates(Mesh const &mesh, float thresholdAngle) {
+  Instrument::Zone zone("repair.scan");
 
-  Mesh mesh;
-  if (!PMP::IO::read_polygon_mesh(filePath, mesh)) {
-    std::cerr << "Cannot read polygon mesh" << std::endl;
-    return std::nullopt;
+  Metrics::Options options;
+  options.capAngle = thresholdAngle;
+  Metrics::Report report = Metrics::computeMetrics(mesh, options);
+
+  std::vector<Face_index> candidates = std::move(report.capFaces);
+  candidates.insert(candidates.end(), report.needleFaces.begin(), report.needleFaces.end());
+  candidates.insert(candidates.end(), report.degenerateFaces.begin(), report.degenerateFaces.end());
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  return candidates;
+}
+
+// the candidates grown by kNeighbourhoodRings rings of faces
+std::vector<Face_index> _growRegion(Mesh const &mesh, std::vector<Face_index> const &candidates) {
+  std::vector<bool> inRegion(mesh.num_faces(), false);
+  std::vector<Face_index> region = candidates;
+  for (Face_index f : region) {
+    inRegion[f] = true;
   }
-  if (!CGAL::is_triangle_mesh(mesh)) {
-    std::cerr << "Input geometry is not triangulated." << std::endl;
-    return std::nullopt;
+
+  size_t ringBegin = 0;
+  for (int ring = 0; ring < kNeighbourhoodRings; ring++) {
+    size_t const ringEnd = region.size();
+    for (size_t i = ringBegin; i < ringEnd; i++) {
+      for (Vertex_index v : vertices_around_face(mesh.halfedge(region[i]), mesh)) {
+        for (Face_index neighbour : faces_around_target(mesh.halfedge(v), mesh)) {
+          if (neighbour != Mesh::null_face() && !inRegion[neighbour]) {
+            inRegion[neighbour] = true;
+            region.push_back(neighbour);
+          }
+        }
+      }
+    }
+    ringBegin = ringEnd;
   }
+  return region;
+}
 
-  std::cout << "Faces: " << num_faces(mesh) << std::endl;
-  return std::optional<Mesh>(mesh);
+size_t _findRoot(std::vector<size_t> &parents, size_t i) {
+  while (parents[i] != i) {
+    parents[i] = parents[parents[i]];
+    i          = parents[i];
+  }
+  return i;
 }
 
-float getCosVal(float const angle) { return std::cos(angle * CGAL_PI / 180.0); }
+// splits the region into clusters that share no vertex, so each one can be repaired on its own
+std::vector<std::vector<Face_index>> _clusterRegion(Mesh const &mesh,
+                                                    std::vector<Face_index> const &region) {
+  std::vector<size_t> parents(region.size());
+  std::iota(parents.begin(), parents.end(), size_t{0});
+
+  // vertex -> the first region face met around it
+  std::unordered_map<Vertex_index, size_t> firstFaces;
+  firstFaces.reserve(region.size());
+  for (size_t i = 0; i < region.size(); i++) {
+    for (Vertex_index v : vertices_around_face(mesh.halfedge(region[i]), mesh)) {
+      auto [it, inserted] = firstFaces.try_emplace(v, i);
+      if (!inserted) {
+        parents[_findRoot(parents, i)] = _findRoot(parents, it->second);
+      }
+    }
+  }
+
+  std::vector<std::vector<Face_index>> clusters;
+  std::vector<size_t> clusterOfRoot(region.size(), kNoIndex);
+  for (size_t i = 0; i < region.size(); i++) {
+    size_t const root = _findRoot(parents, i);
+    if (clusterOfRoot[root] == kNoIndex) {
+      clusterOfRoot[root] = clusters.size();
+      clusters.emplace_back();
+    }
+    clusters[clusterOfRoot[root]].push_back(region[i]);
+  }
+  return clusters;
+}
+
+// the faces of every cluster that was not extracted are kept as they are, the others are replaced
+// by their repaired patch whose border vertices are the mesh vertices they were copied from
+bool _mergeClusters(Mesh const &mesh, std::vector<std::vector<Face_index>> const &clusters,
+                    std::vector<std::optional<Partition::Patch>> const &patches, Mesh &merged) {
+  std::vector<bool> replaced(mesh.num_faces(), false);
+  for (size_t i = 0; i < clusters.size(); i++) {
+    if (patches[i] == std::nullopt) {
+      continue;
+    }
+    for (Face_index f : clusters[i]) {
+      replaced[f] = true;
+    }
+  }
+
+  Io::MeshBuffer buffer;
+  buffer.positions.reserve(3 * mesh.number_of_vertices());
+  buffer.indices.reserve(3 * mesh.number_of_faces());
+  buffer.faceOffsets.reserve(mesh.number_of_faces());
+
+  // mesh vertices are added when first used, the interior of a replaced cluster never is
+  uint32_t const kUnused = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> remap(mesh.num_vertices(), kUnused);
+  auto addPoint = [&buffer](Kernel::Point_3 const &p) {
+    buffer.positions.insert(buffer.positions.end(), {p.x(), p.y(), p.z()});
+    return static_cast<uint32_t>(buffer.positions.size() / 3 - 1);
+  };
+  auto meshVertex = [&](Vertex_index v) {
+    if (remap[v] == kUnused) {
+      remap[v] = addPoint(mesh.point(v));
+    }
+    return remap[v];
+  };
+
+  for (Face_index f : mesh.faces()) {
+    if (replaced[f]) {
+      continue;
+    }
+    for (Vertex_index v : vertices_around_face(mesh.halfedge(f), mesh)) {
+      buffer.indices.push_back(meshVertex(v));
+    }
+    buffer.faceOffsets.push_back(static_cast<uint32_t>(buffer.indices.size()));
+  }
+
+  for (auto const &patch : patches) {
+    if (patch == std::nullopt) {
+      continue;
+    }
+    Mesh const &patchMesh = patch->mesh;
+
+    std::vector<uint32_t> patchRemap(patchMesh.num_vertices());
+    for (Vertex_index v : patchMesh.vertices()) {
+      Vertex_index const sourceV = Partition::sourceVertex(patch.value(), v);
+      patchRemap[v] = sourceV != Mesh::null_vertex() && patchMesh.is_border(v)
+                          ? meshVertex(sourceV)
+                          : addPoint(patchMesh.point(v));
+    }
+    for (Face_index f : patchMesh.faces()) {
+      for (Vertex_index v : vertices_around_face(patchMesh.halfedge(f), patchMesh)) {
+        buffer.indices.push_back(patchRemap[v]);
+      }
+      buffer.faceOffsets.push_back(static_cast<uint32_t>(buffer.indices.size()));
+    }
+  }
+
+  return Io::buildSurfaceMesh(buffer.view(), merged);
+}
 
 } // namespace
 
 namespace Repair {
 
+bool removeDegenerateFaces(Mesh &mesh, float thresholdAngle, RepairReport *report) {
+  float const threshold = getCosVal(thresholdAngle);
+  RepairReport result;
+  result.scannedFaceCount = num_faces(mesh);
+
+  auto start = Timing::Clock::now();
+
+  std::vector<Face_index> const candidates            = _scanCandidates(mesh, thresholdAngle);
+  std::vector<Face_index> const region                = _growRegion(mesh, candidates);
+  std::vector<std::vector<Face_index>> const clusters = _clusterRegion(mesh, region);
+  result.candidateFaceCount                           = candidates.size();
+  result.clusterCount                                 = clusters.size();
+  result.scanTime                                     = Timing::secondsSince(start);
+
+  if (!candidates.empty()) {
+    Instrument::Zone zone("repair.repair");
+    start = Timing::Clock::now();
+
+    if (candidates.size() < kParallelCandidateCount || clusters.size() <= 1) {
+      PMP::remove_almost_degenerate_faces(region, mesh, CGAL::parameters::cap_threshold(threshold));
+      result.repairTime = Timing::secondsSince(start);
+    } else {
+      std::vector<std::optional<Partition::Patch>> patches(clusters.size());
+      ThreadPool::global().parallelFor(clusters.size(), [&](size_t i) {
+        patches[i] = Partition::extractPatch(mesh, clusters[i]);
+        if (patches[i] == std::nullopt) {
+          return;
+        }
+        Mesh &patchMesh = patches[i]->mesh;
+        PMP::remove_almost_degenerate_faces(
+            patchMesh, CGAL::parameters::cap_threshold(threshold)
+                           .edge_is_constrained_map(Partition::BorderEdgeMap{&patchMesh})
+                           .vertex_is_constrained_map(Partition::BorderVertexMap{&patchMesh}));
+      });
+      result.repairTime = Timing::secondsSince(start);
+
+      start = Timing::Clock::now();
+      Mesh merged;
+      if (_mergeClusters(mesh, clusters, patches, merged)) {
+        mesh = std::move(merged);
+      } else {
+        std::cerr << "Cannot merge repaired clusters, repairing serially" << std::endl;
+        PMP::remove_almost_degenerate_faces(region, mesh,
+                                            CGAL::parameters::cap_threshold(threshold));
+      }
+
+      // clusters that were not valid meshes on their own, and faces the locked borders kept from
+      // being fixed, get one serial pass
+      std::vector<Face_index> const leftover = _scanCandidates(mesh, thresholdAngle);
+      if (!leftover.empty()) {
+        PMP::remove_almost_degenerate_faces(_growRegion(mesh, leftover), mesh,
+                                            CGAL::parameters::cap_threshold(threshold));
+      }
+      result.mergeTime = Timing::secondsSince(start);
+    }
+  }
+
+  // faces the repair created count as unresolved too, so repaired is a lower bound
+  start = Timing::Clock::now();
+  if (!candidates.empty()) {
+    result.unresolvedFaceCount = _scanCandidates(mesh, thresholdAngle).size();
+  }
+  result.repairedFaceCount =
+      result.candidateFaceCount - std::min(result.candidateFaceCount, result.unresolvedFaceCount);
+  result.verifyTime = Timing::secondsSince(start);
+
+  if (report != nullptr) {
+    *report = result;
+  }
+  return result.unresolvedFaceCount == 0;
+}
+
+void printReport(RepairReport const &report) {
+  std::cout << "Faces scanned: " << report.scannedFaceCount << " (" << report.scanTime << "s)"
+            << std::endl;
+  std::cout << "Candidates: " << report.candidateFaceCount << " in " << report.clusterCount
+            << " clusters" << std::endl;
+  std::cout << "Faces repaired: " << report.repairedFaceCount << " (" << report.repairTime
+            << "s repair, " << report.mergeTime << "s merge)" << std::endl;
+  std::cout << "Faces unresolved: " << report.unresolvedFaceCount << " (" << report.verifyTime
+            << "s)" << std::endl;
+}
+
 void removeDegenerateFaces(std::string const &filename, float thresholdAngle) {
   std::string const inputFilePath  = Io::makeFullInputPath(filename);
-  std::string const outputFilePath = Io::makeFullOutputPath(filename);
+  std::string const outputFilePath = Io::makeMeshOutputPath(filename);
+
+  std::stringstream operation;
+  operation << std::setprecision(17) << "rep:" << thresholdAngle;
+  std::optional<std::string> resultKey;
+  if (Io::fetchResult(inputFilePath, operation.str(), outputFilePath, resultKey)) {
+    return;
+  }
 
-  auto maybeMesh = _readMesh(inputFilePath);
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
   if (maybeMesh == std::nullopt) {
     return;
   }
   Mesh &mesh = maybeMesh.value();
 
-  float const threshold = getCosVal(thresholdAngle);
-
-  bool success =
-      PMP::remove_almost_degenerate_faces(mesh, CGAL::parameters::cap_threshold(threshold));
+  RepairReport report;
+  bool success = removeDegenerateFaces(mesh, thresholdAngle, &report);
 
-  CGAL::IO::write_polygon_mesh(outputFilePath, mesh, CGAL::parameters::stream_precision(17));
+  if (Io::writeSurfaceMesh(outputFilePath, mesh)) {
+    Io::storeResult(resultKey, outputFilePath);
+  }
 
+  printReport(report);
   std::cout << "Mesh repair state: " << (success ? "success" : "failed") << std::endl;
   std::cout << "Mesh repaired and is written to path (" << outputFilePath << ")" << std::endl;
-  auto remeshedMeshOpt = _readMesh(outputFilePath);
+  std::cout << "Faces: " << num_faces(mesh) << std::endl;
+}
+
+std::vector<Mesh::Face_index> detectCaps(Mesh const &mesh, float thresholdAngle) {
+  Metrics::Options options;
+  options.capAngle = thresholdAngle;
+  return Metrics::computeMetrics(mesh, options).capFaces;
+}
+
+void detectCaps(std::string const &filename, float thresholdAngle) {
+  std::string const inputFilePath = Io::makeFullInputPath(filename);
+
+  auto maybeMesh = Io::loadTriangleMesh<Mesh>(inputFilePath);
+  if (maybeMesh == std::nullopt) {
+    return;
+  }
+
+  std::vector<Mesh::Face_index> const caps = detectCaps(maybeMesh.value(), thresholdAngle);
+
+  // a badly tessellated asset has thousands, the first few are enough to locate them
+  size_t constexpr kListedCount = 20;
+  std::cout << caps.size() << " cap triangles found." << std::endl;
+  for (size_t i = 0; i < std::min(caps.size(), kListedCount); i++) {
+    std::cout << "  " << caps[i] << std::endl;
+  }
 }
 
 } // namespace Repair
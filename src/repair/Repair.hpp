@@ -1,11 +1,39 @@
 #pragma once
 
+#include "common/Mesh.hpp"
+
 #include <string>
+#include <vector>
 
 namespace Repair {
 
+struct RepairReport {
+  size_t scannedFaceCount    = 0;
+  size_t candidateFaceCount  = 0;
+  size_t clusterCount        = 0;
+  size_t repairedFaceCount   = 0;
+  size_t unresolvedFaceCount = 0;
+
+  // seconds
+  double scanTime   = 0.0;
+  double repairTime = 0.0;
+  double mergeTime  = 0.0;
+  double verifyTime = 0.0;
+};
+
+// a parallel scan collects the caps and needles, only they and a few rings of faces around them
+// go to the repair, clusters sharing no vertex are repaired side by side as patches with their
+// borders locked and whatever they leave goes through a serial pass, returns false if some
+// degenerate faces could not be removed
+bool removeDegenerateFaces(Mesh &mesh, float thresholdAngle, RepairReport *report = nullptr);
+
+void printReport(RepairReport const &report);
+
 void removeDegenerateFaces(std::string const &filename, float thresholdAngle);
 
+// faces with an angle above thresholdAngle, in face order
+std::vector<Mesh::Face_index> detectCaps(Mesh const &mesh, float thresholdAngle);
+
 void detectCaps(std::string const &filename, float thresholdAngle);
 
 } // namespace Repair
\ No newline at end of file
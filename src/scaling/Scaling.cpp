@@ -0,0 +1,267 @@
+#include "Scaling.hpp"
+
+#include "common/Json.hpp"
+#include "common/Memory.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/Timing.hpp"
+#include "intersection/Intersection.hpp"
+#include "mesh-simplification/MeshSimplification.hpp"
+#include "remesh/Remesh.hpp"
+#include "repair/Repair.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// sim keeps this share of the faces
+double constexpr kSimplifyRatio              = 0.1;
+unsigned int constexpr kRemeshIterationCount = 3;
+// the default repair threshold of the pipeline
+float constexpr kRepairAngle = 130;
+
+struct Point {
+  std::string family;
+  size_t inputFaceCount = 0;
+  std::string operation;
+  size_t threadCount       = 0;
+  double medianSeconds     = 0.0;
+  double minSeconds        = 0.0;
+  double speedup           = 1.0;
+  size_t outputFaceCount   = 0;
+  size_t peakResidentBytes = 0;
+};
+
+// sim and rem cut the mesh into as many patches as the most threads swept, at every thread
+// count, so a curve times the same work
+size_t _patchCount(Scaling::Options const &options) {
+  return std::max<size_t>(
+      2, *std::max_element(options.threadCounts.begin(), options.threadCounts.end()));
+}
+
+double _meanEdgeLength(Mesh const &mesh) {
+  double total = 0.0;
+  for (Mesh::Edge_index e : mesh.edges()) {
+    Mesh::Halfedge_index const h = mesh.halfedge(e);
+    total += std::sqrt(
+        CGAL::squared_distance(mesh.point(mesh.source(h)), mesh.point(mesh.target(h))));
+  }
+  return mesh.number_of_edges() != 0 ? total / static_cast<double>(mesh.number_of_edges()) : 0.0;
+}
+
+void _runOperation(Scaling::Operation operation, Mesh &mesh, size_t threadCount,
+                   size_t patchCount, double edgeLength) {
+  switch (operation) {
+  case Scaling::Operation::kEdgeCollapse: {
+    size_t const outputFaceCount =
+        static_cast<size_t>(kSimplifyRatio * static_cast<double>(num_faces(mesh)));
+    MeshSimplification::simplifyParallel(mesh, outputFaceCount,
+                                         MeshSimplification::GarlandHeckbertPolicy::kNone,
+                                         threadCount, true, patchCount);
+    return;
+  }
+  case Scaling::Operation::kIsoRemesh:
+    Remesh::isoRemeshParallel(mesh, edgeLength, kRemeshIterationCount, threadCount, patchCount);
+    return;
+  case Scaling::Operation::kRepair:
+    Repair::removeDegenerateFaces(mesh, kRepairAngle);
+    return;
+  case Scaling::Operation::kIntersectionCheck: {
+    Intersection::Index index(mesh);
+    std::cout << index.intersectingPairCount() << " pairs of triangles intersect" << std::endl;
+    return;
+  }
+  }
+}
+
+bool _writeCsv(std::vector<Point> const &points, std::string const &filePath) {
+  std::ofstream file(filePath, std::ios::binary);
+  file << "family,faces,operation,threads,medianSeconds,minSeconds,speedup,facesPerSecond,"
+          "outputFaces,peakResidentBytes\n";
+  for (Point const &point : points) {
+    file << point.family << "," << point.inputFaceCount << "," << point.operation << ","
+         << point.threadCount << "," << point.medianSeconds << "," << point.minSeconds << ","
+         << point.speedup << "," << point.inputFaceCount / point.medianSeconds << ","
+         << point.outputFaceCount << "," << point.peakResidentBytes << "\n";
+  }
+  return static_cast<bool>(file);
+}
+
+Json::Value _toJson(std::vector<Point> const &points, Scaling::Options const &options) {
+  Json::Value document = Json::Value::object();
+  document.set("version", 1);
+  document.set("hardwareThreads", std::thread::hardware_concurrency());
+  document.set("repetitionCount", options.repetitionCount);
+  document.set("seed", options.seed);
+  document.set("patchCount", _patchCount(options));
+
+  Json::Value &entries = document.set("points", Json::Value::array());
+  for (Point const &point : points) {
+    Json::Value &entry = entries.push(Json::Value::object());
+    entry.set("family", point.family);
+    entry.set("faces", point.inputFaceCount);
+    entry.set("operation", point.operation);
+    entry.set("threads", point.threadCount);
+    entry.set("medianSeconds", point.medianSeconds);
+    entry.set("minSeconds", point.minSeconds);
+    entry.set("speedup", point.speedup);
+    entry.set("facesPerSecond", point.inputFaceCount / point.medianSeconds);
+    entry.set("outputFaces", point.outputFaceCount);
+    entry.set("peakResidentBytes", point.peakResidentBytes);
+  }
+  return document;
+}
+
+// rewritten after every point, an interrupted sweep keeps what it measured
+bool _write(std::vector<Point> const &points, Scaling::Options const &options) {
+  if (!options.csvFilePath.empty()) {
+    if (!_writeCsv(points, options.csvFilePath)) {
+      std::cerr << "Cannot write file (" << options.csvFilePath << ")" << std::endl;
+      return false;
+    }
+  }
+  if (!options.jsonFilePath.empty()) {
+    std::ofstream file(options.jsonFilePath, std::ios::binary);
+    file << Json::dump(_toJson(points, options)) << '\n';
+    if (!file) {
+      std::cerr << "Cannot write file (" << options.jsonFilePath << ")" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+namespace Scaling {
+
+std::optional<Operation> operationFromName(std::string const &name) {
+  if (name == "sim") {
+    return Operation::kEdgeCollapse;
+  } else if (name == "rem") {
+    return Operation::kIsoRemesh;
+  } else if (name == "rep") {
+    return Operation::kRepair;
+  } else if (name == "chk") {
+    return Operation::kIntersectionCheck;
+  }
+  return std::nullopt;
+}
+
+std::string operationName(Operation operation) {
+  switch (operation) {
+  case Operation::kEdgeCollapse:
+    return "sim";
+  case Operation::kIsoRemesh:
+    return "rem";
+  case Operation::kRepair:
+    return "rep";
+  case Operation::kIntersectionCheck:
+    return "chk";
+  }
+  return "";
+}
+
+std::vector<size_t> logSpaced(size_t min, size_t max, size_t count) {
+  std::vector<size_t> values;
+  if (count == 0 || min == 0 || max < min) {
+    return values;
+  }
+  if (count == 1) {
+    return {min};
+  }
+  double const ratio = std::log(static_cast<double>(max) / static_cast<double>(min));
+  for (size_t i = 0; i < count; i++) {
+    double const t = static_cast<double>(i) / static_cast<double>(count - 1);
+    values.push_back(static_cast<size_t>(std::llround(min * std::exp(ratio * t))));
+  }
+  return values;
+}
+
+bool run(Options const &options) {
+  if (options.repetitionCount == 0 || options.threadCounts.empty()) {
+    std::cerr << "Scaling needs at least one repetition and one thread count" << std::endl;
+    return false;
+  }
+
+  size_t const patchCount = _patchCount(options);
+  std::cout << "sim and rem cut every mesh into " << patchCount << " patches" << std::endl;
+
+  std::vector<Point> points;
+  for (Synthetic::Family family : options.families) {
+    for (size_t faceCount : options.faceCounts) {
+      auto start       = Timing::Clock::now();
+      Mesh const input = Synthetic::generate(family, faceCount, options.seed);
+      std::cout << Synthetic::familyName(family) << ": " << num_faces(input) << " faces generated, "
+                << Timing::secondsSince(start) << "s" << std::endl;
+      double const edgeLength = _meanEdgeLength(input);
+
+      for (Operation operation : options.operations) {
+        double baselineSeconds = 0.0;
+        for (size_t threadCount : options.threadCounts) {
+          if (operation == Operation::kIntersectionCheck &&
+              threadCount != options.threadCounts.front()) {
+            break;
+          }
+
+          std::unique_ptr<ThreadPool> const pool = ThreadPool::withThreads(threadCount);
+          ThreadPool::setGlobal(pool.get());
+
+          Point point;
+          point.family         = Synthetic::familyName(family);
+          point.inputFaceCount = num_faces(input);
+          point.operation      = operationName(operation);
+          point.threadCount    = threadCount;
+
+          std::vector<double> samples;
+          for (size_t i = 0; i < options.repetitionCount; i++) {
+            Mesh mesh = input;
+            Memory::resetPeakResident();
+            start = Timing::Clock::now();
+            _runOperation(operation, mesh, threadCount, patchCount, edgeLength);
+            samples.push_back(Timing::secondsSince(start));
+            point.outputFaceCount = num_faces(mesh);
+            point.peakResidentBytes =
+                std::max(point.peakResidentBytes, Memory::peakResidentBytes());
+          }
+          ThreadPool::setGlobal(nullptr);
+
+          std::sort(samples.begin(), samples.end());
+          size_t const middle = samples.size() / 2;
+          point.medianSeconds = samples.size() % 2 == 1
+                                    ? samples[middle]
+                                    : (samples[middle - 1] + samples[middle]) / 2.0;
+          point.minSeconds    = samples.front();
+          if (baselineSeconds == 0.0) {
+            baselineSeconds = point.medianSeconds;
+          }
+          point.speedup = baselineSeconds / point.medianSeconds;
+
+          std::cout << point.family << " " << point.inputFaceCount << " " << point.operation << " "
+                    << threadCount << " threads: median " << point.medianSeconds << "s, speedup "
+                    << point.speedup << "x, " << point.outputFaceCount << " faces, peak "
+                    << point.peakResidentBytes / (1024 * 1024) << " MiB" << std::endl;
+
+          points.push_back(point);
+          if (!_write(points, options)) {
+            return false;
+          }
+        }
+      }
+    }
+  }
+
+  if (!options.csvFilePath.empty()) {
+    std::cout << "Scaling curves written to path (" << options.csvFilePath << ")" << std::endl;
+  }
+  if (!options.jsonFilePath.empty()) {
+    std::cout << "Scaling curves written to path (" << options.jsonFilePath << ")" << std::endl;
+  }
+  return true;
+}
+
+} // namespace Scaling
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "synthetic/Synthetic.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Scaling {
+
+enum class Operation {
+  kEdgeCollapse,
+  kIsoRemesh,
+  kRepair,
+  kIntersectionCheck,
+};
+
+// "sim", "rem", "rep" or "chk", the names of the matching pipeline stages
+std::optional<Operation> operationFromName(std::string const &name);
+std::string operationName(Operation operation);
+
+// count face counts from min to max with a constant ratio between neighbours, rounded
+std::vector<size_t> logSpaced(size_t min, size_t max, size_t count);
+
+struct Options {
+  std::vector<Synthetic::Family> families = {
+      Synthetic::Family::kSphere, Synthetic::Family::kTerrain, Synthetic::Family::kDefects};
+  std::vector<Operation> operations = {Operation::kEdgeCollapse, Operation::kIsoRemesh,
+                                       Operation::kRepair, Operation::kIntersectionCheck};
+  std::vector<size_t> faceCounts   = logSpaced(10000, 1000000, 3);
+  std::vector<size_t> threadCounts = {1, 2, 4, 8};
+  size_t repetitionCount           = 3;
+  uint32_t seed                    = 1;
+
+  // written when non-empty
+  std::string csvFilePath = "scaling.csv";
+  std::string jsonFilePath;
+};
+
+// generates every family at every face count and runs every operation on a fresh copy at every
+// thread count, prints one line per run and writes the curves with the median time, the speedup
+// over the first thread count and the peak memory of each point, false if a file cannot be
+// written
+//
+// sim collapses to a tenth of the faces and rem remeshes at the mean edge length for three
+// iterations, both run their patch parallel versions at every thread count with as many patches
+// as the most threads swept, so one thread times the same work on the caller alone, rep runs with
+// the global pool swapped for one of the thread count, the caller counting as one of them, chk is
+// serial and only runs at the first thread count
+bool run(Options const &options);
+
+} // namespace Scaling
@@ -0,0 +1,546 @@
+#include "Server.hpp"
+
+#include "common/Instrument.hpp"
+#include "common/Json.hpp"
+#include "common/Mesh.hpp"
+#include "common/ThreadPool.hpp"
+#include "io/Io.hpp"
+#include "io/ResultCache.hpp"
+#include "io/SurfaceMeshIo.hpp"
+#include "pipeline/Pipeline.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// a request line longer than this closes the connection instead of growing the buffer forever
+size_t constexpr kMaxRequestBytes = 1 << 20;
+
+// the points and connectivity of a Surface_mesh including removed elements, property maps added
+// later by a job are not counted
+size_t _meshBytes(Mesh const &mesh) {
+  size_t const vertexCount   = mesh.number_of_vertices() + mesh.number_of_removed_vertices();
+  size_t const halfedgeCount = mesh.number_of_halfedges() + 2 * mesh.number_of_removed_edges();
+  size_t const faceCount     = mesh.number_of_faces() + mesh.number_of_removed_faces();
+  return vertexCount * (sizeof(Kernel::Point_3) + sizeof(Mesh::Halfedge_index) + 1) +
+         halfedgeCount * (4 * sizeof(Mesh::Vertex_index)) + halfedgeCount / 2 +
+         faceCount * (sizeof(Mesh::Halfedge_index) + 1);
+}
+
+// loaded meshes by input path, a cached mesh is never modified, jobs work on a copy, a miss still
+// goes through the Io sidecar cache
+class HotMeshCache {
+public:
+  explicit HotMeshCache(size_t capacityBytes) : mCapacityBytes(capacityBytes) {}
+
+  // nullptr if the file cannot be read, a file written since it was cached is loaded again
+  std::shared_ptr<Mesh const> get(std::string const &filePath, bool &hit) {
+    std::error_code error;
+    auto const writeTime = std::filesystem::last_write_time(filePath, error);
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto it = mLookup.find(filePath);
+      if (it != mLookup.end() && it->second->writeTime == writeTime) {
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        ++mHitCount;
+        hit = true;
+        return it->second->mesh;
+      }
+      ++mMissCount;
+    }
+
+    // loading happens outside the lock, two jobs missing on the same file both load it
+    hit            = false;
+    auto maybeMesh = Io::loadTriangleMesh<Mesh>(filePath);
+    if (maybeMesh == std::nullopt) {
+      return nullptr;
+    }
+    auto mesh         = std::make_shared<Mesh const>(std::move(maybeMesh.value()));
+    size_t const size = _meshBytes(*mesh);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    _erase(filePath);
+    if (size > mCapacityBytes) {
+      return mesh;
+    }
+    mEntries.push_front({filePath, writeTime, mesh, size});
+    mLookup[filePath] = mEntries.begin();
+    mBytes += size;
+    while (mBytes > mCapacityBytes) {
+      _erase(mEntries.back().filePath);
+      ++mEvictionCount;
+    }
+    return mesh;
+  }
+
+  Json::Value stats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Json::Value stats = Json::Value::object();
+    stats.set("meshes", mEntries.size());
+    stats.set("bytes", mBytes);
+    stats.set("capacityBytes", mCapacityBytes);
+    stats.set("hits", mHitCount);
+    stats.set("misses", mMissCount);
+    stats.set("evictions", mEvictionCount);
+    return stats;
+  }
+
+private:
+  struct Entry {
+    std::string filePath;
+    std::filesystem::file_time_type writeTime;
+    std::shared_ptr<Mesh const> mesh;
+    size_t bytes;
+  };
+
+  // callers hold the mutex, jobs still using the mesh keep it alive through their shared_ptr
+  void _erase(std::string const &filePath) {
+    auto it = mLookup.find(filePath);
+    if (it == mLookup.end()) {
+      return;
+    }
+    mBytes -= it->second->bytes;
+    mEntries.erase(it->second);
+    mLookup.erase(it);
+  }
+
+  mutable std::mutex mMutex;
+  // most recently used first
+  std::list<Entry> mEntries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> mLookup;
+
+  size_t mCapacityBytes;
+  size_t mBytes         = 0;
+  size_t mHitCount      = 0;
+  size_t mMissCount     = 0;
+  size_t mEvictionCount = 0;
+};
+
+// the most recent samples in a ring, percentiles are taken over those only
+class LatencyWindow {
+public:
+  void record(double seconds) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSamples.size() < kSampleCount) {
+      mSamples.push_back(seconds);
+    } else {
+      mSamples[mNext] = seconds;
+    }
+    mNext = (mNext + 1) % kSampleCount;
+    ++mTotalCount;
+  }
+
+  Json::Value stats() const {
+    std::vector<double> samples;
+    size_t totalCount = 0;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      samples    = mSamples;
+      totalCount = mTotalCount;
+    }
+
+    Json::Value stats = Json::Value::object();
+    stats.set("count", totalCount);
+    if (samples.empty()) {
+      return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto const percentile = [&samples](double fraction) {
+      return samples[std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()))];
+    };
+    stats.set("p50", percentile(0.50));
+    stats.set("p90", percentile(0.90));
+    stats.set("p99", percentile(0.99));
+    stats.set("max", samples.back());
+    return stats;
+  }
+
+private:
+  static size_t constexpr kSampleCount = 1024;
+
+  mutable std::mutex mMutex;
+  std::vector<double> mSamples;
+  size_t mNext       = 0;
+  size_t mTotalCount = 0;
+};
+
+// one mutex per output path, jobs writing the same file take turns, an entry lives as long as a
+// job holds it
+class PathLocks {
+public:
+  std::shared_ptr<std::mutex> get(std::string const &path) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::shared_ptr<std::mutex> pathMutex = mLocks[path].lock();
+    if (pathMutex == nullptr) {
+      for (auto it = mLocks.begin(); it != mLocks.end();) {
+        it = it->second.expired() ? mLocks.erase(it) : std::next(it);
+      }
+      pathMutex    = std::make_shared<std::mutex>();
+      mLocks[path] = pathMutex;
+    }
+    return pathMutex;
+  }
+
+private:
+  std::mutex mMutex;
+  std::unordered_map<std::string, std::weak_ptr<std::mutex>> mLocks;
+};
+
+struct State {
+  explicit State(Server::Options const &options)
+      : cache(options.cacheBytes), pool(options.threadCount) {}
+
+  HotMeshCache cache;
+  ThreadPool pool;
+
+  std::atomic<size_t> queuedCount{0};
+  std::atomic<size_t> runningCount{0};
+  std::atomic<size_t> failedCount{0};
+
+  // queue wait alone and submission to response
+  LatencyWindow waitLatencies;
+  LatencyWindow totalLatencies;
+
+  PathLocks outputLocks;
+
+  std::atomic<bool> stopping{false};
+  int listenSocket = -1;
+
+  // connection threads are detached, shutdown waits for the set to drain
+  std::mutex clientMutex;
+  std::condition_variable clientCondition;
+  std::unordered_set<int> clientSockets;
+};
+
+Json::Value _error(std::string const &message) {
+  Json::Value response = Json::Value::object();
+  response.set("ok", false);
+  response.set("error", message);
+  return response;
+}
+
+// the pipeline stage a job command stands for, empty for commands that aren't jobs
+std::string _stageOf(std::string const &command) {
+  if (command == "simplify") {
+    return "sim";
+  } else if (command == "remesh") {
+    return "rem";
+  } else if (command == "repair") {
+    return "rep";
+  } else if (command == "benchmark") {
+    return "ben";
+  }
+  return "";
+}
+
+std::string _stringField(Json::Value const &request, std::string const &key) {
+  Json::Value const *value = request.find(key);
+  return value != nullptr && value->isString() ? value->asString() : "";
+}
+
+Json::Value _runJob(State &state, Json::Value const &request, std::string const &stageSpec) {
+  Instrument::Zone zone("server.job");
+
+  std::string const filename = _stringField(request, "file");
+  if (filename.empty()) {
+    return _error("missing file");
+  }
+  auto stages = Pipeline::parseStages(stageSpec);
+  if (stages == std::nullopt) {
+    return _error("invalid stages (" + stageSpec + ")");
+  }
+
+  auto const start         = Clock::now();
+  Json::Value const *write = request.find("write");
+  bool const writeOutput   = write != nullptr && write->asBool();
+
+  // writing jobs for the same output run one at a time, from the cache check to the store, so
+  // they neither write over each other nor unlink a file another one just produced, the second
+  // one usually finds the first one's result in the cache
+  std::string const outputFilePath = Io::makeMeshOutputPath(filename);
+  std::shared_ptr<std::mutex> outputMutex;
+  std::unique_lock<std::mutex> outputLock;
+  if (writeOutput) {
+    outputMutex = state.outputLocks.get(outputFilePath);
+    outputLock  = std::unique_lock<std::mutex>(*outputMutex);
+  }
+
+  // a written result that was produced before is linked from disk without touching the mesh
+  std::optional<std::string> resultKey;
+  std::string const operation = Pipeline::cacheOperation(stages.value());
+  if (writeOutput && Io::isResultCacheEnabled() && !operation.empty()) {
+    resultKey = Io::ResultCache::global().key(Io::makeFullInputPath(filename), operation);
+    if (resultKey == std::nullopt) {
+      return _error("cannot read (" + filename + ")");
+    }
+    if (Io::ResultCache::global().fetch(resultKey.value(), outputFilePath)) {
+      std::chrono::duration<double> const elapsed = Clock::now() - start;
+      Json::Value response                        = Json::Value::object();
+      response.set("ok", true);
+      response.set("output", outputFilePath);
+      response.set("resultCached", true);
+      response.set("seconds", elapsed.count());
+      return response;
+    }
+  }
+
+  bool hit    = false;
+  auto source = state.cache.get(Io::makeFullInputPath(filename), hit);
+  if (source == nullptr) {
+    return _error("cannot read (" + filename + ")");
+  }
+  Instrument::count(hit ? "server.cacheHit" : "server.cacheMiss", 1);
+
+  Mesh mesh = *source;
+  Pipeline::run(mesh, stages.value(), "");
+
+  Json::Value response = Json::Value::object();
+  response.set("ok", true);
+  if (writeOutput) {
+    if (!Io::writeSurfaceMesh(outputFilePath, mesh)) {
+      return _error("cannot write (" + outputFilePath + ")");
+    }
+    if (resultKey != std::nullopt) {
+      Io::ResultCache::global().store(resultKey.value(), outputFilePath);
+    }
+    response.set("output", outputFilePath);
+  }
+  std::chrono::duration<double> const elapsed = Clock::now() - start;
+  response.set("cached", hit);
+  response.set("faces", num_faces(mesh));
+  response.set("seconds", elapsed.count());
+  return response;
+}
+
+Json::Value _stats(State &state) {
+  Json::Value stats = Json::Value::object();
+  stats.set("ok", true);
+  stats.set("queued", state.queuedCount.load());
+  stats.set("running", state.runningCount.load());
+  stats.set("failed", state.failedCount.load());
+  stats.set("waitSeconds", state.waitLatencies.stats());
+  stats.set("latencySeconds", state.totalLatencies.stats());
+  stats.set("cache", state.cache.stats());
+
+  Io::ResultCacheStats const results = Io::ResultCache::global().stats();
+  Json::Value resultCache            = Json::Value::object();
+  resultCache.set("hits", results.hits);
+  resultCache.set("misses", results.misses);
+  resultCache.set("stores", results.stores);
+  resultCache.set("evictions", results.evictions);
+  stats.set("resultCache", resultCache);
+  return stats;
+}
+
+#ifndef _WIN32
+
+void _stop(State &state) {
+  state.stopping = true;
+  // wakes accept and every recv, the sockets are closed by their owners
+  ::shutdown(state.listenSocket, SHUT_RDWR);
+  std::lock_guard<std::mutex> lock(state.clientMutex);
+  for (int client : state.clientSockets) {
+    ::shutdown(client, SHUT_RD);
+  }
+}
+
+Json::Value _handle(State &state, std::string const &line) {
+  auto request = Json::parse(line);
+  if (request == std::nullopt || !request->isObject()) {
+    return _error("malformed request");
+  }
+
+  std::string const command = _stringField(request.value(), "command");
+  Json::Value response;
+  if (command == "stats") {
+    response = _stats(state);
+  } else if (command == "shutdown") {
+    _stop(state);
+    response = Json::Value::object();
+    response.set("ok", true);
+  } else if (command == "run" || !_stageOf(command).empty()) {
+    std::string stageSpec = _stringField(request.value(), "stages");
+    if (command != "run") {
+      std::string const args = _stringField(request.value(), "args");
+      stageSpec              = _stageOf(command) + (args.empty() ? "" : ":" + args);
+    }
+
+    // the connection thread waits, the pool decides when the job starts
+    auto const submitted = Clock::now();
+    auto promise         = std::make_shared<std::promise<Json::Value>>();
+    state.queuedCount++;
+    state.pool.submit([&state, &request, stageSpec, submitted, promise]() {
+      state.queuedCount--;
+      state.runningCount++;
+      std::chrono::duration<double> const wait = Clock::now() - submitted;
+      state.waitLatencies.record(wait.count());
+      // CGAL reports broken preconditions by throwing, a bad mesh must not take the server down
+      try {
+        promise->set_value(_runJob(state, request.value(), stageSpec));
+      } catch (std::exception const &exception) {
+        promise->set_value(_error(exception.what()));
+      }
+      state.runningCount--;
+    });
+    response = promise->get_future().get();
+
+    std::chrono::duration<double> const total = Clock::now() - submitted;
+    state.totalLatencies.record(total.count());
+    if (!response.find("ok")->asBool()) {
+      state.failedCount++;
+    }
+  } else {
+    response = _error("unknown command (" + command + ")");
+  }
+
+  if (Json::Value const *id = request->find("id")) {
+    response.set("id", *id);
+  }
+  return response;
+}
+
+bool _sendAll(int socket, std::string const &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t const count = ::send(socket, data.data() + sent, data.size() - sent, 0);
+    if (count <= 0) {
+      return false;
+    }
+    sent += static_cast<size_t>(count);
+  }
+  return true;
+}
+
+void _serveClient(State &state, int client) {
+  std::string buffer;
+  char chunk[4096];
+  for (;;) {
+    ssize_t const count = ::recv(client, chunk, sizeof(chunk), 0);
+    if (count <= 0) {
+      break;
+    }
+    buffer.append(chunk, static_cast<size_t>(count));
+
+    size_t lineEnd = 0;
+    bool open      = true;
+    while (open && (lineEnd = buffer.find('\n')) != std::string::npos) {
+      std::string const line = buffer.substr(0, lineEnd);
+      buffer.erase(0, lineEnd + 1);
+      if (!line.empty()) {
+        open = _sendAll(client, Json::dump(_handle(state, line), 0) + '\n');
+      }
+    }
+    if (!open || buffer.size() > kMaxRequestBytes) {
+      break;
+    }
+  }
+
+  // out of the set before the close, once closed accept may reuse the number for a new connection
+  // and this erase would drop its entry, serve may return as soon as the lock is released
+  {
+    std::lock_guard<std::mutex> lock(state.clientMutex);
+    state.clientSockets.erase(client);
+    state.clientCondition.notify_all();
+  }
+  ::close(client);
+}
+
+#endif
+
+} // namespace
+
+namespace Server {
+
+#ifdef _WIN32
+
+bool serve(Options const &options) {
+  std::cerr << "Server mode needs Unix domain sockets, not available on this platform ("
+            << options.socketPath << ")" << std::endl;
+  return false;
+}
+
+#else
+
+bool serve(Options const &options) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (options.socketPath.empty() || options.socketPath.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Invalid socket path (" << options.socketPath << ")" << std::endl;
+    return false;
+  }
+  options.socketPath.copy(address.sun_path, options.socketPath.size());
+
+  // a client hanging up mid response must not kill the server
+  std::signal(SIGPIPE, SIG_IGN);
+
+  State state(options);
+  state.listenSocket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(options.socketPath.c_str());
+  if (state.listenSocket < 0 ||
+      ::bind(state.listenSocket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      ::listen(state.listenSocket, SOMAXCONN) != 0) {
+    std::cerr << "Cannot listen on socket (" << options.socketPath << ")" << std::endl;
+    if (state.listenSocket >= 0) {
+      ::close(state.listenSocket);
+    }
+    return false;
+  }
+  std::cout << "Listening on (" << options.socketPath << ") with "
+            << state.pool.getThreadCount() << " workers" << std::endl;
+
+  while (!state.stopping) {
+    int const client = ::accept(state.listenSocket, nullptr, nullptr);
+    if (client < 0) {
+      if (state.stopping || errno != EINTR) {
+        break;
+      }
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(state.clientMutex);
+      state.clientSockets.insert(client);
+    }
+    std::thread([&state, client]() { _serveClient(state, client); }).detach();
+  }
+
+  _stop(state);
+  {
+    std::unique_lock<std::mutex> lock(state.clientMutex);
+    state.clientCondition.wait(lock, [&state]() { return state.clientSockets.empty(); });
+  }
+  ::close(state.listenSocket);
+  ::unlink(options.socketPath.c_str());
+  std::cout << "Server stopped" << std::endl;
+  return true;
+}
+
+#endif
+
+} // namespace Server
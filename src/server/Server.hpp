@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Server {
+
+struct Options {
+  std::string socketPath = "mesh-server.sock";
+
+  // job workers, 0 means one per hardware thread
+  size_t threadCount = 0;
+
+  // loaded meshes are kept until their estimated size passes this, least recently used go first
+  size_t cacheBytes = size_t(1) << 30;
+};
+
+// listens on a Unix domain socket and answers one JSON line per request line, requests are
+//   {"id": 1, "command": "run", "file": "1.obj", "stages": "rep,sim:6050", "write": true}
+//   {"command": "simplify", "file": "1.obj", "args": "6050:cp"} and likewise remesh, repair
+//   and benchmark, args being the fields of the matching pipeline stage
+//   {"command": "stats"} for the queue depth, latency percentiles and cache usage
+//   {"command": "shutdown"} to stop once the running jobs finish
+// a connection handles its requests in order, clients open more connections to run jobs side by
+// side, blocks until shutdown and returns false if the socket cannot be opened
+bool serve(Options const &options);
+
+} // namespace Server
@@ -0,0 +1,294 @@
+#include "Synthetic.hpp"
+
+#include "common/Instrument.hpp"
+#include "io/SurfaceMeshIo.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+double constexpr kPi = 3.14159265358979323846;
+
+// a corner pulled this far from the opposite edge, relative to its distance before
+double constexpr kCapPull = 0.02;
+
+// splitmix64 of seed and index mapped to [0, 1), the value of an index does not depend on the
+// order it is asked in and the mesh is the same on every standard library
+double _unit(uint64_t seed, uint64_t index) {
+  uint64_t x = seed * 0x9e3779b97f4a7c15ull + index;
+  x          = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x          = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  x          = x ^ (x >> 31);
+  return static_cast<double>(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void _addTriangle(Io::MeshBuffer &buffer, uint32_t a, uint32_t b, uint32_t c) {
+  buffer.indices.insert(buffer.indices.end(), {a, b, c});
+  buffer.faceOffsets.push_back(static_cast<uint32_t>(buffer.indices.size()));
+}
+
+uint32_t _addPoint(Io::MeshBuffer &buffer, std::array<double, 3> const &p) {
+  buffer.positions.insert(buffer.positions.end(), p.begin(), p.end());
+  return static_cast<uint32_t>(buffer.vertexCount() - 1);
+}
+
+std::array<double, 3> _point(Io::MeshBuffer const &buffer, uint32_t v) {
+  double const *p = buffer.positions.data() + 3 * v;
+  return {p[0], p[1], p[2]};
+}
+
+Mesh _build(Io::MeshBuffer const &buffer) {
+  Mesh mesh;
+  Io::buildSurfaceMesh(buffer.view(), mesh);
+  return mesh;
+}
+
+// cells per side of the square grid, two triangles per cell
+size_t _gridSize(size_t faceCount) {
+  return std::max<size_t>(1, static_cast<size_t>(std::lround(std::sqrt(faceCount / 2.0))));
+}
+
+void _fillHeightField(size_t faceCount, uint32_t seed, Io::MeshBuffer &buffer) {
+  size_t const n        = _gridSize(faceCount);
+  double const cellSize = 1.0 / static_cast<double>(n);
+
+  buffer.clear();
+  buffer.positions.reserve(3 * (n + 1) * (n + 1));
+  for (size_t j = 0; j <= n; j++) {
+    for (size_t i = 0; i <= n; i++) {
+      double const x     = i * cellSize;
+      double const y     = j * cellSize;
+      double const noise = (_unit(seed, j * (n + 1) + i) - 0.5) * cellSize;
+      double const waves = 0.1 * std::sin(3.0 * kPi * x) * std::cos(2.0 * kPi * y) +
+                           0.05 * std::sin(7.0 * x + 5.0 * y);
+      _addPoint(buffer, {x, y, waves + noise});
+    }
+  }
+
+  buffer.indices.reserve(6 * n * n);
+  buffer.faceOffsets.reserve(2 * n * n + 1);
+  for (size_t j = 0; j < n; j++) {
+    for (size_t i = 0; i < n; i++) {
+      uint32_t const a = static_cast<uint32_t>(j * (n + 1) + i);
+      uint32_t const b = a + 1;
+      uint32_t const c = a + static_cast<uint32_t>(n + 1);
+      uint32_t const d = c + 1;
+      _addTriangle(buffer, a, b, d);
+      _addTriangle(buffer, a, d, c);
+    }
+  }
+}
+
+// faces are picked by hash, a face touching a vertex an earlier cap moved is skipped so every cap
+// keeps the shape it was given
+void _injectCaps(Io::MeshBuffer &buffer, size_t capCount, uint32_t seed) {
+  size_t const faceCount = buffer.faceCount();
+  std::vector<bool> moved(buffer.vertexCount(), false);
+  for (size_t attempt = 0, count = 0; count < capCount && attempt < 4 * capCount; attempt++) {
+    size_t const f           = static_cast<size_t>(_unit(seed + 1, attempt) * faceCount);
+    uint32_t const *triangle = buffer.indices.data() + buffer.faceOffsets[f];
+    if (moved[triangle[0]] || moved[triangle[1]] || moved[triangle[2]]) {
+      continue;
+    }
+
+    std::array<double, 3> const a = _point(buffer, triangle[0]);
+    std::array<double, 3> const b = _point(buffer, triangle[1]);
+    std::array<double, 3> const c = _point(buffer, triangle[2]);
+    double *p                     = buffer.positions.data() + 3 * triangle[0];
+    for (size_t axis = 0; axis < 3; axis++) {
+      double const middle = 0.5 * (b[axis] + c[axis]);
+      p[axis]             = middle + kCapPull * (a[axis] - middle);
+    }
+    moved[triangle[0]] = moved[triangle[1]] = moved[triangle[2]] = true;
+    count++;
+  }
+}
+
+// a loose triangle standing on the face, its two lower corners below and the top above the face
+// plane, the cut through that plane runs through the centroid so the two always intersect
+void _injectIntersections(Io::MeshBuffer &buffer, size_t intersectionCount, uint32_t seed) {
+  size_t const faceCount = buffer.faceCount();
+  for (size_t k = 0; k < intersectionCount; k++) {
+    size_t const f           = static_cast<size_t>(_unit(seed + 2, k) * faceCount);
+    uint32_t const *triangle = buffer.indices.data() + buffer.faceOffsets[f];
+
+    std::array<double, 3> const a = _point(buffer, triangle[0]);
+    std::array<double, 3> const b = _point(buffer, triangle[1]);
+    std::array<double, 3> const c = _point(buffer, triangle[2]);
+
+    std::array<double, 3> ab, ac, centroid;
+    for (size_t axis = 0; axis < 3; axis++) {
+      ab[axis]       = b[axis] - a[axis];
+      ac[axis]       = c[axis] - a[axis];
+      centroid[axis] = (a[axis] + b[axis] + c[axis]) / 3.0;
+    }
+    std::array<double, 3> const normal = {ab[1] * ac[2] - ab[2] * ac[1],
+                                          ab[2] * ac[0] - ab[0] * ac[2],
+                                          ab[0] * ac[1] - ab[1] * ac[0]};
+    double const normalLength =
+        std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    double const edgeLength = std::sqrt(ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2]);
+    if (normalLength == 0.0 || edgeLength == 0.0) {
+      continue;
+    }
+
+    // half an edge up and down, a quarter along the edge each way
+    double const size = 0.5 * edgeLength;
+    std::array<double, 3> top, left, right;
+    for (size_t axis = 0; axis < 3; axis++) {
+      double const up    = size * normal[axis] / normalLength;
+      double const along = 0.5 * size * ab[axis] / edgeLength;
+      top[axis]          = centroid[axis] + up;
+      left[axis]         = centroid[axis] - up - along;
+      right[axis]        = centroid[axis] - up + along;
+    }
+    uint32_t const first = _addPoint(buffer, top);
+    _addPoint(buffer, left);
+    _addPoint(buffer, right);
+    _addTriangle(buffer, first, first + 1, first + 2);
+  }
+}
+
+} // namespace
+
+namespace Synthetic {
+
+std::optional<Family> familyFromName(std::string const &name) {
+  if (name == "sphere") {
+    return Family::kSphere;
+  } else if (name == "terrain") {
+    return Family::kTerrain;
+  } else if (name == "defects") {
+    return Family::kDefects;
+  }
+  return std::nullopt;
+}
+
+std::string familyName(Family family) {
+  switch (family) {
+  case Family::kSphere:
+    return "sphere";
+  case Family::kTerrain:
+    return "terrain";
+  case Family::kDefects:
+    return "defects";
+  }
+  return "";
+}
+
+Mesh sphere(size_t faceCount) {
+  Instrument::Zone zone("synthetic.sphere");
+
+  // six faces of n by n cells, two triangles per cell
+  size_t const n = std::max<size_t>(
+      1, static_cast<size_t>(std::lround(std::sqrt(static_cast<double>(faceCount) / 12.0))));
+
+  // lattice points of the cube surface, the edges and corners are shared by several faces, so
+  // they are collected from all faces, sorted and deduplicated before any vertex is numbered
+  auto const latticeKey = [n](size_t i, size_t j, size_t k) {
+    return (static_cast<uint64_t>(i) * (n + 1) + j) * (n + 1) + k;
+  };
+  auto const cubePoint = [n](size_t axis, size_t side, size_t u, size_t v) {
+    std::array<size_t, 3> lattice;
+    lattice[axis]           = side * n;
+    lattice[(axis + 1) % 3] = u;
+    lattice[(axis + 2) % 3] = v;
+    return lattice;
+  };
+
+  std::vector<uint64_t> keys;
+  keys.reserve(6 * (n + 1) * (n + 1));
+  for (size_t axis = 0; axis < 3; axis++) {
+    for (size_t side = 0; side < 2; side++) {
+      for (size_t v = 0; v <= n; v++) {
+        for (size_t u = 0; u <= n; u++) {
+          std::array<size_t, 3> const l = cubePoint(axis, side, u, v);
+          keys.push_back(latticeKey(l[0], l[1], l[2]));
+        }
+      }
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  Io::MeshBuffer buffer;
+  buffer.positions.reserve(3 * keys.size());
+  for (uint64_t key : keys) {
+    size_t const lattice[3] = {key / ((n + 1) * (n + 1)), key / (n + 1) % (n + 1), key % (n + 1)};
+    std::array<double, 3> p;
+    for (size_t axis = 0; axis < 3; axis++) {
+      // the tangent warp evens out the cells, a plain projection squeezes them near the corners
+      p[axis] = std::tan(0.25 * kPi * (2.0 * lattice[axis] / static_cast<double>(n) - 1.0));
+    }
+    double const length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+    _addPoint(buffer, {p[0] / length, p[1] / length, p[2] / length});
+  }
+
+  auto const vertexOf = [&](size_t axis, size_t side, size_t u, size_t v) {
+    std::array<size_t, 3> const l = cubePoint(axis, side, u, v);
+    uint64_t const key            = latticeKey(l[0], l[1], l[2]);
+    return static_cast<uint32_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+  };
+
+  buffer.indices.reserve(36 * n * n);
+  buffer.faceOffsets.reserve(12 * n * n + 1);
+  for (size_t axis = 0; axis < 3; axis++) {
+    for (size_t side = 0; side < 2; side++) {
+      for (size_t v = 0; v < n; v++) {
+        for (size_t u = 0; u < n; u++) {
+          uint32_t const a = vertexOf(axis, side, u, v);
+          uint32_t const b = vertexOf(axis, side, u + 1, v);
+          uint32_t const c = vertexOf(axis, side, u + 1, v + 1);
+          uint32_t const d = vertexOf(axis, side, u, v + 1);
+          // u and v run along the next two axes, so a b c turns counterclockwise around the
+          // axis, the near side is flipped to face outward
+          if (side == 1) {
+            _addTriangle(buffer, a, b, c);
+            _addTriangle(buffer, a, c, d);
+          } else {
+            _addTriangle(buffer, a, c, b);
+            _addTriangle(buffer, a, d, c);
+          }
+        }
+      }
+    }
+  }
+  return _build(buffer);
+}
+
+Mesh heightField(size_t faceCount, uint32_t seed) {
+  Instrument::Zone zone("synthetic.heightField");
+
+  Io::MeshBuffer buffer;
+  _fillHeightField(faceCount, seed, buffer);
+  return _build(buffer);
+}
+
+Mesh defectiveHeightField(size_t faceCount, double capFraction, double intersectionFraction,
+                          uint32_t seed) {
+  Instrument::Zone zone("synthetic.defectiveHeightField");
+
+  Io::MeshBuffer buffer;
+  _fillHeightField(faceCount, seed, buffer);
+  size_t const gridFaceCount = buffer.faceCount();
+  _injectCaps(buffer, static_cast<size_t>(capFraction * gridFaceCount), seed);
+  _injectIntersections(buffer, static_cast<size_t>(intersectionFraction * gridFaceCount), seed);
+  return _build(buffer);
+}
+
+Mesh generate(Family family, size_t faceCount, uint32_t seed) {
+  switch (family) {
+  case Family::kSphere:
+    return sphere(faceCount);
+  case Family::kTerrain:
+    return heightField(faceCount, seed);
+  case Family::kDefects:
+    return defectiveHeightField(faceCount, 0.005, 0.0005, seed);
+  }
+  return Mesh();
+}
+
+} // namespace Synthetic
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common/Mesh.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace Synthetic {
+
+enum class Family {
+  kSphere,
+  kTerrain,
+  kDefects,
+};
+
+// "sphere", "terrain" or "defects"
+std::optional<Family> familyFromName(std::string const &name);
+std::string familyName(Family family);
+
+// a closed unit sphere of about faceCount triangles, a cube whose faces are split into a grid
+// and pushed out onto the sphere, the grid is warped so the triangles come out of similar size
+Mesh sphere(size_t faceCount);
+
+// an open unit square of about faceCount triangles lifted by a few smooth waves plus uniform noise
+// of half a grid cell
+Mesh heightField(size_t faceCount, uint32_t seed);
+
+// heightField with capFraction of its faces turned into caps by pulling a corner almost onto the
+// opposite edge, and for intersectionFraction of its faces a loose triangle that pierces the face
+// through its centroid
+Mesh defectiveHeightField(size_t faceCount, double capFraction, double intersectionFraction,
+                          uint32_t seed);
+
+// the same arguments always give the same mesh, kDefects uses 0.5% caps and 0.05% intersections
+Mesh generate(Family family, size_t faceCount, uint32_t seed = 1);
+
+} // namespace Synthetic